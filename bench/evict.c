@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Drops files from the page cache, so the next run reads them from
+ * disk. Works without root, unlike /proc/sys/vm/drop_caches, because
+ * only clean pages of the named files are dropped.
+ *
+ *   evict file...
+ */
+int main(int argc, char *argv[])
+{
+    int failed = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        int fd = open(argv[i], O_RDONLY);
+
+        if(fd == -1)
+        {
+            perror(argv[i]);
+            failed = 1;
+            continue;
+        }
+
+        /* Dirty pages can't be dropped, write them first */
+        fdatasync(fd);
+
+        if(posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) != 0)
+        {
+            fprintf(stderr, "%s: unable to drop from the page cache\n", argv[i]);
+            failed = 1;
+        }
+
+        close(fd);
+    }
+
+    return failed;
+}
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Writes a synthetic vault as ylva --batch commands:
+ *
+ *   gen-vault [-s seed] count | ylva --batch -
+ *
+ * The same seed always gives the same entries, so vaults built on
+ * different hosts and with different builds of Ylva are identical.
+ * Field lengths follow what real vaults look like: most titles are
+ * names of well known services, usernames are emails or handles, a few
+ * entries have no url or username, passwords are a mix of short human
+ * made ones and long generated ones, and most entries have no notes.
+ *
+ * Entry count / 2 + 1 is always the probe entry, title PROBE_TITLE, so
+ * the benchmark has a known entry to look up by name and by id.
+ */
+
+#define DEFAULT_SEED 20210101
+#define PROBE_TITLE "Ylva Bench Probe"
+
+static const char *services[] = {
+    "GitHub", "GitLab", "Gmail", "Outlook", "Amazon", "Netflix", "Spotify",
+    "Dropbox", "Slack", "Discord", "Twitter", "Facebook", "LinkedIn",
+    "Reddit", "Steam", "PayPal", "Apple ID", "Microsoft", "Adobe", "Zoom",
+    "Jira", "Confluence", "AWS Console", "DigitalOcean", "Hetzner",
+    "Nordea", "OP", "Bank", "Insurance", "Electricity", "Library", "VPN",
+    "Router", "NAS", "Wi-Fi", "Work laptop", "Mastodon", "Matrix", "IRC",
+    "Hacker News", "Stack Overflow", "npm", "PyPI", "Docker Hub", "Travis",
+    "Bitbucket", "Trello", "Notion", "Evernote", "Booking", "Airbnb", "Uber",
+    "eBay", "Etsy", "Twitch", "YouTube", "Instagram", "Pinterest", "Wikipedia"
+};
+
+static const char *suffixes[] = {
+    " (work)", " (personal)", " 2", " old", " test", " admin", " backup"
+};
+
+static const char *tlds[] = { "com", "org", "net", "io", "fi", "de", "co.uk" };
+
+static const char *syllables[] = {
+    "ka", "lo", "mi", "ne", "ru", "ta", "vi", "so", "ha", "ja", "pe", "ri",
+    "tu", "ko", "la", "ma", "ni", "sa", "te", "yl", "va", "ro", "se", "in"
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static uint64_t state;
+
+/* splitmix64, small and the same everywhere */
+static uint64_t next_random()
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+    return z ^ (z >> 31);
+}
+
+/* Random number between 0 and n - 1 */
+static unsigned below(unsigned n)
+{
+    return next_random() % n;
+}
+
+/* Random number between lo and hi, both included */
+static unsigned between(unsigned lo, unsigned hi)
+{
+    return lo + below(hi - lo + 1);
+}
+
+/* Appends a pronounceable word of syllable count to buf */
+static void word(char *buf, size_t size, int count, bool capital)
+{
+    size_t start = strlen(buf);
+
+    for(int i = 0; i < count; i++)
+        strncat(buf, syllables[below(COUNT(syllables))], size - strlen(buf) - 1);
+
+    if(capital && buf[start] != '\0')
+        buf[start] -= 'a' - 'A';
+}
+
+static void make_title(char *buf, size_t size)
+{
+    buf[0] = '\0';
+
+    if(below(100) < 70)
+    {
+        snprintf(buf, size, "%s", services[below(COUNT(services))]);
+
+        if(below(100) < 25)
+            strncat(buf, suffixes[below(COUNT(suffixes))], size - strlen(buf) - 1);
+    }
+    else
+    {
+        word(buf, size, between(2, 4), true);
+
+        if(below(100) < 40)
+        {
+            strncat(buf, " ", size - strlen(buf) - 1);
+            word(buf, size, between(1, 3), true);
+        }
+    }
+}
+
+static void make_user(char *buf, size_t size)
+{
+    unsigned kind = below(100);
+
+    buf[0] = '\0';
+
+    if(kind < 10)
+        return;
+
+    word(buf, size, between(2, 3), false);
+
+    if(kind < 65)
+    {
+        strncat(buf, ".", size - strlen(buf) - 1);
+        word(buf, size, between(2, 4), false);
+        strncat(buf, "@", size - strlen(buf) - 1);
+        word(buf, size, between(2, 3), false);
+        strncat(buf, ".", size - strlen(buf) - 1);
+        strncat(buf, tlds[below(COUNT(tlds))], size - strlen(buf) - 1);
+    }
+    else if(below(100) < 50)
+    {
+        size_t len = strlen(buf);
+
+        snprintf(buf + len, size - len, "%u", between(1, 9999));
+    }
+}
+
+static void make_url(char *buf, size_t size)
+{
+    buf[0] = '\0';
+
+    if(below(100) < 15)
+        return;
+
+    strncat(buf, below(100) < 90 ? "https://" : "http://", size - 1);
+
+    if(below(100) < 50)
+        strncat(buf, "www.", size - strlen(buf) - 1);
+
+    word(buf, size, between(2, 4), false);
+    strncat(buf, ".", size - strlen(buf) - 1);
+    strncat(buf, tlds[below(COUNT(tlds))], size - strlen(buf) - 1);
+
+    if(below(100) < 30)
+    {
+        strncat(buf, "/", size - strlen(buf) - 1);
+        word(buf, size, between(2, 3), false);
+
+        if(below(100) < 30)
+        {
+            size_t len = strlen(buf);
+
+            snprintf(buf + len, size - len, "?id=%u", between(1, 99999));
+        }
+    }
+}
+
+static void make_password(char *buf, size_t size)
+{
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz"
+                                "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                "0123456789?)(/%#!=-_.,;:*&@$";
+    unsigned kind = below(100);
+
+    buf[0] = '\0';
+
+    if(kind < 40)
+    {
+        /* Human made, a word and some digits */
+        word(buf, size, between(2, 4), below(2));
+
+        size_t len = strlen(buf);
+
+        snprintf(buf + len, size - len, "%u%s", between(0, 9999), below(3) ? "" : "!");
+        return;
+    }
+
+    unsigned length = kind < 85 ? between(16, 24) : between(32, 64);
+
+    if(length >= size)
+        length = size - 1;
+
+    for(unsigned i = 0; i < length; i++)
+        buf[i] = chars[below(sizeof(chars) - 1)];
+
+    buf[length] = '\0';
+}
+
+static void make_notes(char *buf, size_t size)
+{
+    unsigned kind = below(100);
+    unsigned words;
+
+    buf[0] = '\0';
+
+    if(kind < 75)
+        return;
+
+    words = kind < 95 ? between(2, 10) : between(40, 150);
+
+    for(unsigned i = 0; i < words; i++)
+    {
+        if(i > 0)
+            strncat(buf, " ", size - strlen(buf) - 1);
+
+        word(buf, size, between(1, 4), i == 0);
+    }
+}
+
+/* Writes name=value quoted for the batch parser */
+static void put_field(const char *name, const char *value)
+{
+    printf(" \"%s=", name);
+
+    for(const char *s = value; *s; s++)
+    {
+        if(*s == '"' || *s == '\\')
+            putchar('\\');
+
+        putchar(*s);
+    }
+
+    putchar('"');
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: gen-vault [-s seed] count\n");
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long long seed = DEFAULT_SEED;
+    char title[256];
+    char user[256];
+    char url[256];
+    char password[128];
+    char notes[2048];
+    int c;
+
+    while((c = getopt(argc, argv, "s:")) != -1)
+    {
+        switch(c)
+        {
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    if(optind != argc - 1)
+    {
+        usage();
+        return 1;
+    }
+
+    long count = atol(argv[optind]);
+
+    if(count < 1)
+    {
+        usage();
+        return 1;
+    }
+
+    state = seed;
+
+    for(long i = 1; i <= count; i++)
+    {
+        make_title(title, sizeof(title));
+        make_user(user, sizeof(user));
+        make_url(url, sizeof(url));
+        make_password(password, sizeof(password));
+        make_notes(notes, sizeof(notes));
+
+        if(i == count / 2 + 1)
+            snprintf(title, sizeof(title), "%s", PROBE_TITLE);
+
+        printf("add");
+        put_field("title", title);
+        put_field("user", user);
+        put_field("url", url);
+        put_field("password", password);
+        put_field("notes", notes);
+        putchar('\n');
+    }
+
+    return ferror(stdout) ? 1 : 0;
+}
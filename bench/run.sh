@@ -0,0 +1,170 @@
+#!/bin/sh
+#
+# Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+#
+# Times every command line path of Ylva against synthetic vaults and
+# writes the results as JSON, so builds can be compared run to run.
+#
+# Environment:
+#   YLVA   ylva binary to benchmark, default ../src/ylva
+#   SIZES  vault sizes, default "1000 10000 100000 1000000"
+#   RUNS   warm runs of each path, the median is reported, default 5
+#   SEED   seed of the generated vaults, default is gen-vault's own
+#   OUT    file to write the JSON to, default standard output
+#
+# Every path is first run cold, with the vault and the binary dropped
+# from the page cache, then RUNS times warm. Paths that change the vault
+# start each run from the same copy of it. Nothing outside a temporary
+# directory is touched; it is used as HOME, so the active database of
+# the user is left alone.
+
+set -e
+
+BENCH=$(cd "$(dirname "$0")" && pwd)
+YLVA=$(cd "$(dirname "${YLVA:-$BENCH/../src/ylva}")" && pwd)/$(basename "${YLVA:-ylva}")
+SIZES=${SIZES:-"1000 10000 100000 1000000"}
+RUNS=${RUNS:-5}
+PASS=bench
+
+for tool in "$YLVA" "$BENCH/gen-vault" "$BENCH/evict"; do
+    if [ ! -x "$tool" ]; then
+        echo "$tool not found, run make in src and bench first." >&2
+        exit 1
+    fi
+done
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/ylva-bench.XXXXXX")
+trap 'rm -rf "$WORK"' EXIT INT TERM
+
+export HOME="$WORK"
+unset YLVA_PROFILE YLVA_DEFAULT_USERNAME YLVA_COLOR
+VAULT="$WORK/vault.db"
+ACTIVE="$WORK/.ylva.open_db"
+
+now_ns() {
+    date +%s%N
+}
+
+# Drops the vault and the binary from the page cache
+evict() {
+    "$BENCH/evict" "$YLVA" "$@" 2>/dev/null || true
+}
+
+# Runs a path once and prints its time in milliseconds. The command is
+# given as a string so it can have input piped to it.
+time_once() {
+    start=$(now_ns)
+    if ! sh -c "$1" >/dev/null 2>"$WORK/stderr"; then
+        echo "Failed: $1" >&2
+        cat "$WORK/stderr" >&2
+        exit 1
+    fi
+    end=$(now_ns)
+    echo $(( (end - start) / 1000 ))
+}
+
+# Median of the numbers on standard input
+median() {
+    sort -n | awk '{ v[NR] = $1 } END { print (NR % 2) ? v[(NR + 1) / 2] : (v[NR / 2] + v[NR / 2 + 1]) / 2 }'
+}
+
+ms() {
+    awk -v us="$1" 'BEGIN { printf "%.3f", us / 1000 }'
+}
+
+FIRST=1
+
+# emit size path cold warm_median warm_min
+emit() {
+    [ $FIRST -eq 1 ] || printf ',\n'
+    FIRST=0
+    printf '    { "size": %s, "path": "%s", "cold_ms": %s, "warm_ms": %s, "warm_min_ms": %s }' \
+           "$1" "$2" "$(ms "$3")" "$(ms "$4")" "$(ms "$5")"
+}
+
+# bench size path prepare command
+#
+# prepare is run before every run and is not timed. It restores the
+# vault for paths that change it.
+bench() {
+    size=$1 path=$2 prepare=$3 cmd=$4
+
+    sh -c "$prepare"
+    evict "$VAULT" "$VAULT.pristine" "$VAULT.enc"
+    cold=$(time_once "$cmd")
+
+    : > "$WORK/warm"
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        sh -c "$prepare"
+        time_once "$cmd" >> "$WORK/warm"
+        i=$((i + 1))
+    done
+
+    emit "$size" "$path" "$cold" "$(median < "$WORK/warm")" "$(sort -n "$WORK/warm" | head -n 1)"
+}
+
+run_size() {
+    size=$1
+    probe=$((size / 2 + 1))
+
+    "$BENCH/gen-vault" ${SEED:+-s "$SEED"} "$size" > "$WORK/entries"
+
+    # Paths start from the vault of this size, decrypted and active
+    restore="rm -f '$VAULT-wal' '$VAULT-shm'; cp '$VAULT.pristine' '$VAULT'; printf %s '$VAULT' > '$ACTIVE'"
+
+    # Building the vault is timed as a path of its own
+    start=$(now_ns)
+    "$YLVA" -i "$VAULT" >/dev/null
+    "$YLVA" --batch "$WORK/entries" >/dev/null
+    end=$(now_ns)
+    load=$(( (end - start) / 1000 ))
+    emit "$size" "load" "$load" "$load" "$load"
+    cp "$VAULT" "$VAULT.pristine"
+
+    bench "$size" init "rm -f '$ACTIVE' '$WORK/new.db'" "'$YLVA' -i '$WORK/new.db'"
+    bench "$size" add "$restore" \
+          "printf 'Title\\nuser\\nhttps://example.com\\nnotes\\nsecret\\n' | '$YLVA' -a"
+    bench "$size" edit "$restore" \
+          "printf '\\n\\n\\n\\nchanged\\n' | '$YLVA' -e $probe"
+    bench "$size" get "$restore" "'$YLVA' --get 'Ylva Bench Probe'"
+    bench "$size" find "$restore" "'$YLVA' -f mail"
+    bench "$size" regex "$restore" "'$YLVA' -F '^Git.*work'"
+    bench "$size" list-all "$restore" "'$YLVA' -A"
+    bench "$size" show-latest "$restore" "'$YLVA' -t 10"
+    bench "$size" qr "$restore" "'$YLVA' --show-qrcode -l $probe"
+    bench "$size" encrypt "$restore" "printf '$PASS\\n$PASS\\n' | '$YLVA' -E"
+
+    # Decrypting needs an encrypted vault, made once and kept aside
+    sh -c "$restore"
+    printf '%s\n%s\n' "$PASS" "$PASS" | "$YLVA" -E >/dev/null
+    cp "$VAULT" "$VAULT.enc"
+
+    bench "$size" decrypt "cp '$VAULT.enc' '$VAULT'; rm -f '$ACTIVE'" \
+          "printf '$PASS\\n' | '$YLVA' -D '$VAULT'"
+
+    rm -f "$ACTIVE" "$VAULT" "$VAULT.pristine" "$VAULT.enc" "$WORK/new.db"
+}
+
+{
+    printf '{\n'
+    printf '  "version": "%s",\n' "$("$YLVA" -v | head -n 1)"
+    printf '  "commit": "%s",\n' "$(git -C "$BENCH" describe --always --dirty 2>/dev/null || echo unknown)"
+    printf '  "host": "%s",\n' "$(uname -srm)"
+    printf '  "seed": "%s",\n' "${SEED:-default}"
+    printf '  "runs": %s,\n' "$RUNS"
+    printf '  "results": [\n'
+
+    for size in $SIZES; do
+        echo "Benchmarking $size entries" >&2
+        run_size "$size"
+    done
+
+    printf '\n  ]\n}\n'
+} > "$WORK/result.json"
+
+if [ -n "$OUT" ]; then
+    cp "$WORK/result.json" "$OUT"
+else
+    cat "$WORK/result.json"
+fi
@@ -0,0 +1,874 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <openssl/sha.h>
+#include <openssl/crypto.h>
+#include "audit.h"
+#include "entry.h"
+#include "db.h"
+#include "utils.h"
+#include "strength.h"
+#include "securemem.h"
+
+/* Length of SHA1 as hex */
+#define SHA1_HEX_LEN 40
+
+/* Bloom filter sidecar of a breach corpus, written by build_bloom:
+ *
+ *   magic        8 bytes "YLVABLM1"
+ *   hashes       uint32, number of bits set per hash
+ *   reserved     uint32
+ *   bits         uint64, size of the bit array
+ *   bit array    bits / 8 bytes
+ *
+ * Integers are in host byte order, the file is not meant to be moved
+ * between machines.
+ */
+#define BLOOM_MAGIC "YLVABLM1"
+#define BLOOM_HEADER_SIZE 24
+#define BLOOM_BITS_PER_HASH 10
+#define BLOOM_HASHES 7
+
+/* Ranges smaller than this are bisected instead of interpolated */
+#define INTERPOLATE_MIN 4096
+
+/* Passwords are grouped by this many bytes of their SHA256 */
+#define REUSE_DIGEST_SIZE 16
+#define REUSE_INITIAL_SLOTS 1024
+
+#define STRENGTH_MAX_THREADS 32
+
+/* Passwords a strength worker takes at a time */
+#define STRENGTH_CHUNK 256
+
+typedef struct _mapped
+{
+    const char *data;
+    size_t size;
+
+} Mapped_t;
+
+typedef struct _bloom
+{
+    Mapped_t map;
+    const uint8_t *bits;
+    uint64_t nbits;
+    uint32_t hashes;
+
+} Bloom_t;
+
+typedef struct _breach_audit
+{
+    Mapped_t corpus;
+    Bloom_t bloom;
+    bool has_bloom;
+    long checked;
+    long found;
+
+} BreachAudit_t;
+
+/* Slot of the reuse hash table, one per distinct password */
+typedef struct _reuse_slot
+{
+    unsigned char digest[REUSE_DIGEST_SIZE];
+    int count;
+    int first;      /* First node, -1 if slot is empty */
+    int last;
+
+} ReuseSlot_t;
+
+/* Entries are nodes chained from the slot of their password */
+typedef struct _reuse_audit
+{
+    ReuseSlot_t *slots;
+    size_t nslots;
+    size_t used;
+    int *ids;
+    int *next;
+    size_t nodes;
+    size_t cap;
+    bool similar;
+
+} ReuseAudit_t;
+
+typedef struct _strength_item
+{
+    int id;
+    char *password;
+    Strength_t strength;
+
+} StrengthItem_t;
+
+typedef struct _strength_audit
+{
+    StrengthItem_t *items;
+    size_t count;
+    size_t cap;
+    size_t next;
+    pthread_mutex_t lock;
+
+} StrengthAudit_t;
+
+/* Maps whole file read only. Returns false on failure. */
+static bool map_file(const char *path, Mapped_t *map, bool quiet)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if(fd == -1)
+    {
+        if(!quiet)
+            fprintf(stderr, "Unable to open %s.\n", path);
+
+        return false;
+    }
+
+    if(fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        if(!quiet)
+            fprintf(stderr, "%s is empty.\n", path);
+
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if(data == MAP_FAILED)
+    {
+        fprintf(stderr, "Unable to map %s.\n", path);
+        return false;
+    }
+
+    map->data = data;
+    map->size = st.st_size;
+
+    return true;
+}
+
+static void unmap_file(Mapped_t *map)
+{
+    if(map->data)
+        munmap((void *)map->data, map->size);
+
+    map->data = NULL;
+}
+
+static char *bloom_path(const char *corpus_path)
+{
+    char *path = tmalloc(strlen(corpus_path) + 7);
+
+    sprintf(path, "%s.bloom", corpus_path);
+
+    return path;
+}
+
+static int hex_value(char c)
+{
+    if(c >= '0' && c <= '9')
+        return c - '0';
+
+    c = toupper(c);
+
+    if(c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    return -1;
+}
+
+/* First 16 hex digits of text as a number. Missing or invalid digits
+ * count as zero.
+ */
+static uint64_t hex_key(const char *text, size_t len)
+{
+    uint64_t key = 0;
+
+    for(size_t i = 0; i < 16; i++)
+    {
+        int v = i < len ? hex_value(text[i]) : -1;
+
+        key = (key << 4) | (v == -1 ? 0 : v);
+    }
+
+    return key;
+}
+
+static bool bloom_open(const char *corpus_path, Bloom_t *bloom)
+{
+    char *path = bloom_path(corpus_path);
+    bool ok = map_file(path, &bloom->map, true);
+
+    free(path);
+
+    if(!ok)
+        return false;
+
+    if(bloom->map.size < BLOOM_HEADER_SIZE ||
+       memcmp(bloom->map.data, BLOOM_MAGIC, 8) != 0)
+    {
+        fprintf(stderr, "Ignoring invalid bloom filter of %s.\n", corpus_path);
+        unmap_file(&bloom->map);
+        return false;
+    }
+
+    memcpy(&bloom->hashes, bloom->map.data + 8, sizeof(uint32_t));
+    memcpy(&bloom->nbits, bloom->map.data + 16, sizeof(uint64_t));
+    bloom->bits = (const uint8_t *)bloom->map.data + BLOOM_HEADER_SIZE;
+
+    if(bloom->nbits == 0 || bloom->map.size - BLOOM_HEADER_SIZE < bloom->nbits / 8)
+    {
+        fprintf(stderr, "Ignoring invalid bloom filter of %s.\n", corpus_path);
+        unmap_file(&bloom->map);
+        return false;
+    }
+
+    return true;
+}
+
+/* SHA1 is uniformly distributed already, so the bit positions are
+ * taken from the hash itself with double hashing, bit i being
+ * (h1 + i * h2) % bits.
+ */
+static void bloom_hashes(const char *hex, uint64_t *h1, uint64_t *h2)
+{
+    *h1 = hex_key(hex, SHA1_HEX_LEN);
+    *h2 = hex_key(hex + 16, SHA1_HEX_LEN - 16) | 1;
+}
+
+static bool bloom_may_contain(const Bloom_t *bloom, const char *hex)
+{
+    uint64_t h1, h2;
+
+    bloom_hashes(hex, &h1, &h2);
+
+    for(uint32_t i = 0; i < bloom->hashes; i++)
+    {
+        uint64_t bit = (h1 + i * h2) % bloom->nbits;
+
+        if(!(bloom->bits[bit / 8] & (1 << (bit % 8))))
+            return false;
+    }
+
+    return true;
+}
+
+static size_t line_start(const Mapped_t *map, size_t lo, size_t pos)
+{
+    while(pos > lo && map->data[pos - 1] != '\n')
+        pos--;
+
+    return pos;
+}
+
+/* Start of the next line */
+static size_t line_end(const Mapped_t *map, size_t pos)
+{
+    const char *nl = memchr(map->data + pos, '\n', map->size - pos);
+
+    return nl ? (size_t)(nl - map->data) + 1 : map->size;
+}
+
+/* Compares hash at the start of line to hex, which is upper case */
+static int compare_hash(const char *line, size_t len, const char *hex)
+{
+    for(size_t i = 0; i < SHA1_HEX_LEN; i++)
+    {
+        int c = i < len ? toupper(line[i]) : 0;
+
+        if(c != hex[i])
+            return c - hex[i];
+    }
+
+    return 0;
+}
+
+/* Looks hex up from a corpus sorted by hash, one "HASH[:COUNT]" per line.
+ * Steps alternate between interpolation, which finds the line in a few
+ * steps as hashes are uniformly distributed, and bisection, which keeps
+ * the worst case logarithmic. Returns the count, 1 if the line has none,
+ * or 0 if hex is not in the corpus.
+ */
+static long corpus_find(const Mapped_t *corpus, const char *hex)
+{
+    size_t lo = 0;
+    size_t hi = corpus->size;
+    uint64_t target = hex_key(hex, SHA1_HEX_LEN);
+    bool interpolate = true;
+
+    while(lo < hi)
+    {
+        size_t probe = lo + (hi - lo) / 2;
+
+        if(interpolate && hi - lo > INTERPOLATE_MIN)
+        {
+            uint64_t lo_key = hex_key(corpus->data + lo, hi - lo);
+            uint64_t hi_key = hi < corpus->size ?
+                              hex_key(corpus->data + hi, corpus->size - hi) : UINT64_MAX;
+
+            if(target <= lo_key)
+                probe = lo;
+            else if(target >= hi_key)
+                probe = hi - 1;
+            else
+                probe = lo + (size_t)((long double)(target - lo_key) /
+                                      (hi_key - lo_key) * (hi - lo));
+        }
+
+        interpolate = !interpolate;
+
+        size_t start = line_start(corpus, lo, probe);
+        size_t end = line_end(corpus, start);
+        int cmp = compare_hash(corpus->data + start, end - start, hex);
+
+        if(cmp == 0)
+        {
+            const char *p = corpus->data + start + SHA1_HEX_LEN;
+
+            if(p < corpus->data + end && *p == ':')
+                return strtol(p + 1, NULL, 10);
+
+            return 1;
+        }
+
+        if(cmp < 0)
+            lo = end;
+        else
+            hi = start;
+    }
+
+    return 0;
+}
+
+static void sha1_hex(const char *text, char *hex)
+{
+    unsigned char digest[SHA_DIGEST_LENGTH];
+
+    SHA1((const unsigned char *)text, strlen(text), digest);
+
+    static const char digits[] = "0123456789ABCDEF";
+
+    for(int i = 0; i < SHA_DIGEST_LENGTH; i++)
+    {
+        hex[i * 2] = digits[digest[i] >> 4];
+        hex[i * 2 + 1] = digits[digest[i] & 0x0F];
+    }
+
+    hex[SHA1_HEX_LEN] = '\0';
+
+    OPENSSL_cleanse(digest, sizeof(digest));
+}
+
+static bool cb_breached(Entry_t *entry, void *data)
+{
+    BreachAudit_t *audit = data;
+    char hex[SHA1_HEX_LEN + 1];
+
+    if(!entry->password || entry->password[0] == '\0')
+        return true;
+
+    audit->checked++;
+    sha1_hex(entry->password, hex);
+
+    if(audit->has_bloom && !bloom_may_contain(&audit->bloom, hex))
+        return true;
+
+    long count = corpus_find(&audit->corpus, hex);
+
+    if(count > 0)
+    {
+        fprintf(stdout, "%d %s: password seen %ld times in breaches\n",
+                entry->id, entry->title, count);
+        audit->found++;
+    }
+
+    return true;
+}
+
+/* Checks every password against a breach corpus of SHA1 hashes, sorted
+ * by hash, like the Pwned Passwords lists. The corpus is memory mapped
+ * and searched in place. If path.bloom exists, written by build_bloom,
+ * passwords it rules out are not searched at all.
+ */
+bool audit_breached(const char *path)
+{
+    BreachAudit_t audit;
+
+    memset(&audit, 0, sizeof(audit));
+
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return false;
+    }
+
+    if(!map_file(path, &audit.corpus, false))
+        return false;
+
+    posix_madvise((void *)audit.corpus.data, audit.corpus.size, POSIX_MADV_RANDOM);
+    audit.has_bloom = bloom_open(path, &audit.bloom);
+
+    bool ok = db_stream_list(-1, cb_breached, &audit);
+
+    if(ok)
+        fprintf(stdout, "%ld of %ld passwords found in breaches.\n",
+                audit.found, audit.checked);
+
+    unmap_file(&audit.corpus);
+
+    if(audit.has_bloom)
+        unmap_file(&audit.bloom.map);
+
+    return ok;
+}
+
+/* Writes bloom filter of the corpus to path.bloom for audit_breached.
+ * With 10 bits per hash about one lookup in a hundred gets through to
+ * the corpus for passwords that are not in it.
+ */
+bool build_bloom(const char *path)
+{
+    Mapped_t corpus;
+    uint64_t lines = 0;
+
+    if(!map_file(path, &corpus, false))
+        return false;
+
+    posix_madvise((void *)corpus.data, corpus.size, POSIX_MADV_SEQUENTIAL);
+
+    for(size_t pos = 0; pos < corpus.size; pos = line_end(&corpus, pos))
+        lines++;
+
+    uint64_t nbits = (lines * BLOOM_BITS_PER_HASH + 63) / 64 * 64;
+    size_t size = BLOOM_HEADER_SIZE + nbits / 8;
+    char *out_path = bloom_path(path);
+    int fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if(fd == -1 || ftruncate(fd, size) != 0)
+    {
+        fprintf(stderr, "Unable to write %s.\n", out_path);
+
+        if(fd != -1)
+            close(fd);
+
+        free(out_path);
+        unmap_file(&corpus);
+        return false;
+    }
+
+    /* Built in place, so the filter does not have to fit in memory */
+    uint8_t *out = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if(out == MAP_FAILED)
+    {
+        fprintf(stderr, "Unable to map %s.\n", out_path);
+        free(out_path);
+        unmap_file(&corpus);
+        return false;
+    }
+
+    uint32_t hashes = BLOOM_HASHES;
+
+    memcpy(out, BLOOM_MAGIC, 8);
+    memcpy(out + 8, &hashes, sizeof(hashes));
+    memcpy(out + 16, &nbits, sizeof(nbits));
+
+    uint8_t *bits = out + BLOOM_HEADER_SIZE;
+
+    for(size_t pos = 0; pos < corpus.size; pos = line_end(&corpus, pos))
+    {
+        const char *line = corpus.data + pos;
+
+        uint64_t h1, h2;
+
+        if(corpus.size - pos < SHA1_HEX_LEN || hex_value(line[0]) == -1)
+            continue;
+
+        bloom_hashes(line, &h1, &h2);
+
+        for(uint32_t i = 0; i < hashes; i++)
+        {
+            uint64_t bit = (h1 + i * h2) % nbits;
+
+            bits[bit / 8] |= 1 << (bit % 8);
+        }
+    }
+
+    bool ok = msync(out, size, MS_SYNC) == 0;
+
+    munmap(out, size);
+    unmap_file(&corpus);
+
+    if(ok)
+        fprintf(stdout, "Wrote bloom filter of %lu hashes to %s.\n",
+                (unsigned long)lines, out_path);
+    else
+        fprintf(stderr, "Unable to write %s.\n", out_path);
+
+    free(out_path);
+
+    return ok;
+}
+
+/* Form of password used to find similar ones. Trailing digits and
+ * symbols are dropped and the rest is lower cased with common letter
+ * substitutions undone, so P@ssw0rd1! and password match. Returns
+ * password as is if too little would be left. Caller must free the
+ * return value with secure_free.
+ */
+static char *normalize_password(const char *password)
+{
+    static const char leet_from[] = "013457@$!";
+    static const char leet_to[]   = "oieastasi";
+    size_t len = strlen(password);
+
+    while(len > 0 && !isalpha((unsigned char)password[len - 1]))
+        len--;
+
+    if(len < 4)
+        return secure_strdup(password);
+
+    char *norm = secure_alloc(len + 1);
+
+    for(size_t i = 0; i < len; i++)
+    {
+        const char *leet = strchr(leet_from, password[i]);
+
+        norm[i] = leet ? leet_to[leet - leet_from] :
+                  tolower((unsigned char)password[i]);
+    }
+
+    norm[len] = '\0';
+
+    return norm;
+}
+
+static ReuseSlot_t *reuse_slot(ReuseSlot_t *slots, size_t nslots,
+                               const unsigned char *digest)
+{
+    uint64_t h;
+
+    memcpy(&h, digest, sizeof(h));
+
+    for(size_t i = h & (nslots - 1); ; i = (i + 1) & (nslots - 1))
+    {
+        if(slots[i].first == -1 ||
+           memcmp(slots[i].digest, digest, REUSE_DIGEST_SIZE) == 0)
+            return &slots[i];
+    }
+}
+
+static ReuseSlot_t *reuse_new_slots(size_t nslots)
+{
+    ReuseSlot_t *slots = tmalloc(nslots * sizeof(ReuseSlot_t));
+
+    for(size_t i = 0; i < nslots; i++)
+        slots[i].first = -1;
+
+    return slots;
+}
+
+/* Doubles the table when it gets half full */
+static void reuse_grow(ReuseAudit_t *audit)
+{
+    size_t nslots = audit->nslots * 2;
+    ReuseSlot_t *slots = reuse_new_slots(nslots);
+
+    for(size_t i = 0; i < audit->nslots; i++)
+    {
+        if(audit->slots[i].first != -1)
+            *reuse_slot(slots, nslots, audit->slots[i].digest) = audit->slots[i];
+    }
+
+    free(audit->slots);
+    audit->slots = slots;
+    audit->nslots = nslots;
+}
+
+static bool cb_reuse(Entry_t *entry, void *data)
+{
+    ReuseAudit_t *audit = data;
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    char *norm = NULL;
+
+    if(!entry->password || entry->password[0] == '\0')
+        return true;
+
+    if(audit->similar)
+        norm = normalize_password(entry->password);
+
+    const char *text = norm ? norm : entry->password;
+
+    SHA256((const unsigned char *)text, strlen(text), digest);
+
+    secure_free(norm);
+
+    if(audit->nodes == audit->cap)
+    {
+        audit->cap = audit->cap ? audit->cap * 2 : 1024;
+        audit->ids = trealloc(audit->ids, audit->cap * sizeof(int));
+        audit->next = trealloc(audit->next, audit->cap * sizeof(int));
+    }
+
+    int node = audit->nodes++;
+
+    audit->ids[node] = entry->id;
+    audit->next[node] = -1;
+
+    ReuseSlot_t *slot = reuse_slot(audit->slots, audit->nslots, digest);
+
+    if(slot->first == -1)
+    {
+        memcpy(slot->digest, digest, REUSE_DIGEST_SIZE);
+        slot->count = 1;
+        slot->first = node;
+        slot->last = node;
+
+        if(++audit->used * 2 > audit->nslots)
+            reuse_grow(audit);
+    }
+    else
+    {
+        audit->next[slot->last] = node;
+        slot->last = node;
+        slot->count++;
+    }
+
+    OPENSSL_cleanse(digest, sizeof(digest));
+
+    return true;
+}
+
+/* Larger clusters first, then by the first id */
+static int compare_cluster(const void *a, const void *b)
+{
+    const ReuseSlot_t *x = *(ReuseSlot_t * const *)a;
+    const ReuseSlot_t *y = *(ReuseSlot_t * const *)b;
+
+    if(x->count != y->count)
+        return y->count - x->count;
+
+    return (x->first > y->first) - (x->first < y->first);
+}
+
+/* Finds passwords used by more than one entry in one pass over the
+ * database. Passwords are grouped in a hash table by their SHA256, only
+ * the digest and entry ids are kept in memory. With similar, passwords
+ * that differ only by case, trailing digits and symbols or common letter
+ * substitutions are grouped together.
+ */
+bool audit_reuse(bool similar)
+{
+    ReuseAudit_t audit;
+    size_t clusters = 0;
+
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return false;
+    }
+
+    memset(&audit, 0, sizeof(audit));
+    audit.nslots = REUSE_INITIAL_SLOTS;
+    audit.slots = reuse_new_slots(audit.nslots);
+    audit.similar = similar;
+
+    bool ok = db_stream_list(-1, cb_reuse, &audit);
+    ReuseSlot_t **found = tmalloc((audit.used + 1) * sizeof(ReuseSlot_t *));
+
+    for(size_t i = 0; ok && i < audit.nslots; i++)
+    {
+        if(audit.slots[i].first != -1 && audit.slots[i].count > 1)
+            found[clusters++] = &audit.slots[i];
+    }
+
+    qsort(found, clusters, sizeof(ReuseSlot_t *), compare_cluster);
+
+    for(size_t i = 0; i < clusters; i++)
+    {
+        fprintf(stdout, "%s password used by %d entries:\n",
+                similar ? "Similar" : "Same", found[i]->count);
+
+        for(int node = found[i]->first; node != -1; node = audit.next[node])
+        {
+            Entry_t *entry = db_get_entry_by_id(audit.ids[node]);
+
+            fprintf(stdout, "    %d %s\n", audit.ids[node],
+                    entry && entry->id != -1 ? entry->title : "");
+
+            if(entry)
+                entry_free(entry);
+        }
+    }
+
+    if(ok)
+        fprintf(stdout, "%lu of %lu distinct passwords are used by more than one entry.\n",
+                (unsigned long)clusters, (unsigned long)audit.used);
+
+    free(found);
+    memset(audit.slots, 0, audit.nslots * sizeof(ReuseSlot_t));
+    free(audit.slots);
+    free(audit.ids);
+    free(audit.next);
+
+    return ok;
+}
+
+static bool cb_strength(Entry_t *entry, void *data)
+{
+    StrengthAudit_t *audit = data;
+
+    if(!entry->password || entry->password[0] == '\0')
+        return true;
+
+    if(audit->count == audit->cap)
+    {
+        audit->cap = audit->cap ? audit->cap * 2 : 1024;
+        audit->items = trealloc(audit->items, audit->cap * sizeof(StrengthItem_t));
+    }
+
+    audit->items[audit->count].id = entry->id;
+    audit->items[audit->count].password = secure_strdup(entry->password);
+    audit->count++;
+
+    return true;
+}
+
+static void *strength_worker(void *arg)
+{
+    StrengthAudit_t *audit = arg;
+
+    while(true)
+    {
+        pthread_mutex_lock(&audit->lock);
+        size_t start = audit->next;
+        audit->next += STRENGTH_CHUNK;
+        pthread_mutex_unlock(&audit->lock);
+
+        if(start >= audit->count)
+            break;
+
+        size_t end = start + STRENGTH_CHUNK < audit->count ?
+                     start + STRENGTH_CHUNK : audit->count;
+
+        for(size_t i = start; i < end; i++)
+            audit->items[i].strength = password_strength(audit->items[i].password);
+    }
+
+    return NULL;
+}
+
+/* Weakest first */
+static int compare_strength(const void *a, const void *b)
+{
+    const StrengthItem_t *x = a;
+    const StrengthItem_t *y = b;
+
+    if(x->strength.score != y->strength.score)
+        return x->strength.score - y->strength.score;
+
+    if(x->strength.bits != y->strength.bits)
+        return x->strength.bits < y->strength.bits ? -1 : 1;
+
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+/* Scores every password from 0 to 4, see password_strength, and prints
+ * the ones scoring below min_score, weakest first. Passwords are read
+ * in one pass and scored in parallel, one worker per CPU.
+ */
+bool audit_strength(int min_score)
+{
+    StrengthAudit_t audit;
+    pthread_t threads[STRENGTH_MAX_THREADS];
+    size_t started = 0;
+    size_t weak = 0;
+
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return false;
+    }
+
+    memset(&audit, 0, sizeof(audit));
+
+    if(!db_stream_list(-1, cb_strength, &audit))
+    {
+        free(audit.items);
+        return false;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t nthreads = cpus > 0 ? (size_t)cpus : 1;
+
+    if(nthreads > STRENGTH_MAX_THREADS)
+        nthreads = STRENGTH_MAX_THREADS;
+
+    pthread_mutex_init(&audit.lock, NULL);
+
+    for(size_t i = 0; i < nthreads; i++)
+    {
+        if(pthread_create(&threads[i], NULL, strength_worker, &audit) != 0)
+            break;
+
+        started++;
+    }
+
+    /* Do the work here if no thread could be started */
+    if(started == 0)
+        strength_worker(&audit);
+
+    for(size_t i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_destroy(&audit.lock);
+
+    qsort(audit.items, audit.count, sizeof(StrengthItem_t), compare_strength);
+
+    for(size_t i = 0; i < audit.count; i++)
+    {
+        StrengthItem_t *item = &audit.items[i];
+
+        secure_free(item->password);
+
+        if(item->strength.score >= min_score)
+            continue;
+
+        Entry_t *entry = db_get_entry_by_id(item->id);
+        const char *weakness = strength_weakness_name(item->strength.weakness);
+
+        fprintf(stdout, "%d %s: score %d, %.0f bits%s%s\n", item->id,
+                entry && entry->id != -1 ? entry->title : "",
+                item->strength.score, item->strength.bits,
+                weakness[0] ? ", " : "", weakness);
+
+        if(entry)
+            entry_free(entry);
+
+        weak++;
+    }
+
+    fprintf(stdout, "%lu of %lu passwords score below %d.\n",
+            (unsigned long)weak, (unsigned long)audit.count, min_score);
+
+    free(audit.items);
+
+    return true;
+}
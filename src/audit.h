@@ -0,0 +1,15 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __AUDIT_H
+#define __AUDIT_H
+
+#include <stdbool.h>
+
+bool audit_breached(const char *path);
+bool build_bloom(const char *path);
+bool audit_reuse(bool similar);
+bool audit_strength(int min_score);
+
+#endif
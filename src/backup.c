@@ -0,0 +1,1184 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+#include "backup.h"
+#include "entry.h"
+#include "db.h"
+#include "query.h"
+#include "crypto.h"
+#include "utils.h"
+#include "securemem.h"
+
+/* Backups and snapshots are files of:
+ *
+ *   magic        8 bytes, "YLVABAK1" for backups, "YLVASNP1" for snapshots
+ *   info         snapshots only, see below
+ *   salt         SALT_SIZE bytes for the key derivation
+ *   iv           IV_SIZE bytes
+ *   data         records compressed with zlib and encrypted with AES-256-CTR
+ *   hmac         HMAC-SHA512 of everything before it
+ *
+ * A backup record is the id of the entry followed by title, user, url,
+ * password, notes and timestamp. The id and the length of each text are
+ * varints. A snapshot record starts with RECORD_PUT followed by the same,
+ * or RECORD_DELETE followed by the id.
+ *
+ * Separate keys for encryption and the HMAC are derived from the key of
+ * the passphrase. Everything is processed in chunks, so memory use does
+ * not depend on the size of the vault.
+ */
+#define BACKUP_MAGIC "YLVABAK1"
+#define SNAPSHOT_MAGIC "YLVASNP1"
+#define MAGIC_SIZE 8
+#define BACKUP_CHUNK (64 * 1024)
+#define BACKUP_FIELDS 6
+
+/* Longest text a record may have, anything longer is damage */
+#define BACKUP_FIELD_MAX (1 << 30)
+
+#define RECORD_PUT 1
+#define RECORD_DELETE 2
+
+/* Snapshot info: chain id, number of the snapshot in the chain starting
+ * from 1, flags, creation time as seconds since the epoch and a check
+ * value of the key, so a snapshot is never added to a chain with
+ * another password. Numbers are little endian.
+ */
+#define CHAIN_ID_SIZE 16
+#define KEY_CHECK_SIZE 32
+#define SNAPSHOT_INFO_SIZE (CHAIN_ID_SIZE + 4 + 4 + 8 + KEY_CHECK_SIZE)
+#define SNAPSHOT_FULL 1
+
+/* Snapshot files are named by their number, 00000001.snap and so on */
+#define SNAPSHOT_NAME "%08u.snap"
+
+typedef struct _backup_keys
+{
+    unsigned char enc[KEY_SIZE];
+    unsigned char mac[KEY_SIZE];
+
+} Backup_keys_t;
+
+/* Snapshots of a chain share the salt, so replaying a chain derives the
+ * key only once.
+ */
+typedef struct _key_cache
+{
+    bool valid;
+    unsigned char salt[SALT_SIZE];
+    Backup_keys_t keys;
+
+} Key_cache_t;
+
+typedef struct _header
+{
+    const char *magic;
+    size_t info_len;
+    unsigned char info[SNAPSHOT_INFO_SIZE];
+    unsigned char salt[SALT_SIZE];
+    unsigned char iv[IV_SIZE];
+
+} Header_t;
+
+typedef struct _snapshot_info
+{
+    unsigned char chain[CHAIN_ID_SIZE];
+    uint32_t number;
+    uint32_t flags;
+    int64_t created;
+    unsigned char check[KEY_CHECK_SIZE];
+
+} Snapshot_info_t;
+
+typedef struct _stream
+{
+    FILE *fp;
+    z_stream zs;
+    EVP_CIPHER_CTX *cipher;
+    EVP_MD_CTX *mac;
+    EVP_PKEY *mac_key;
+    uint8_t *plain;             /* Records waiting to be compressed */
+    size_t plain_len;
+    uint8_t *packed;            /* Compressed data */
+    uint8_t *sealed;            /* Encrypted data */
+    bool ops;                   /* Records start with RECORD_PUT or RECORD_DELETE */
+    long entries;
+    long restored;
+    long deleted;
+    uint64_t raw_bytes;         /* Size of the records */
+    uint64_t file_bytes;
+    const Query_t *query;
+    bool ok;
+
+} Stream_t;
+
+/* Writes the records of a file */
+typedef bool (*Records_cb)(Stream_t *st, void *data);
+
+static double now_seconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Derives the keys from passphrase and salt, or from a new salt if salt
+ * is NULL. The salt used is copied to salt_out.
+ */
+static bool derive_keys(const char *passphrase, char *salt, Backup_keys_t *keys,
+                        unsigned char *salt_out)
+{
+    Key_t *key = generate_key(passphrase, salt);
+    unsigned int len = 0;
+
+    if(!key)
+    {
+        fprintf(stderr, "Key derivation failed.\n");
+        return false;
+    }
+
+    memcpy(salt_out, key->salt, SALT_SIZE);
+
+    HMAC(EVP_sha256(), key->data, KEY_SIZE, (unsigned char *)"ylva backup encryption",
+         22, keys->enc, &len);
+    HMAC(EVP_sha256(), key->data, KEY_SIZE, (unsigned char *)"ylva backup authentication",
+         26, keys->mac, &len);
+
+    secure_free(key);
+
+    return true;
+}
+
+/* Returns keys for salt, deriving them only if salt differs from the
+ * previous call.
+ */
+static const Backup_keys_t *cached_keys(Key_cache_t *cache, const char *passphrase,
+                                        const unsigned char *salt)
+{
+    if(cache->valid && memcmp(cache->salt, salt, SALT_SIZE) == 0)
+        return &cache->keys;
+
+    cache->valid = derive_keys(passphrase, (char *)salt, &cache->keys, cache->salt);
+
+    return cache->valid ? &cache->keys : NULL;
+}
+
+static bool stream_init(Stream_t *st, FILE *fp, const Backup_keys_t *keys,
+                        const unsigned char *iv, bool encrypt)
+{
+    memset(st, 0, sizeof(Stream_t));
+
+    st->fp = fp;
+    st->ok = true;
+    st->plain = tmalloc(BACKUP_CHUNK);
+    st->packed = tmalloc(BACKUP_CHUNK);
+    st->sealed = tmalloc(BACKUP_CHUNK);
+    st->cipher = EVP_CIPHER_CTX_new();
+    st->mac = EVP_MD_CTX_new();
+    st->mac_key = EVP_PKEY_new_raw_private_key(EVP_PKEY_HMAC, NULL, keys->mac, KEY_SIZE);
+
+    if(!st->cipher || !st->mac || !st->mac_key ||
+       EVP_CipherInit_ex(st->cipher, EVP_aes_256_ctr(), NULL, keys->enc, iv, encrypt) != 1 ||
+       EVP_DigestSignInit(st->mac, NULL, EVP_sha512(), NULL, st->mac_key) != 1)
+    {
+        fprintf(stderr, "Unable to initialize encryption.\n");
+        return false;
+    }
+
+    int rc = encrypt ? deflateInit(&st->zs, Z_DEFAULT_COMPRESSION) : inflateInit(&st->zs);
+
+    if(rc != Z_OK)
+    {
+        fprintf(stderr, "Unable to initialize compression.\n");
+        return false;
+    }
+
+    return true;
+}
+
+static void stream_free(Stream_t *st, bool encrypt)
+{
+    if(!st->plain)
+        return;
+
+    if(encrypt)
+        deflateEnd(&st->zs);
+    else
+        inflateEnd(&st->zs);
+
+    EVP_CIPHER_CTX_free(st->cipher);
+    EVP_MD_CTX_free(st->mac);
+    EVP_PKEY_free(st->mac_key);
+
+    /* Plain and compressed data have the passwords */
+    OPENSSL_cleanse(st->plain, BACKUP_CHUNK);
+    OPENSSL_cleanse(st->packed, BACKUP_CHUNK);
+    free(st->plain);
+    free(st->packed);
+    free(st->sealed);
+
+    st->plain = NULL;
+}
+
+static size_t header_size(const Header_t *h)
+{
+    return MAGIC_SIZE + h->info_len + SALT_SIZE + IV_SIZE;
+}
+
+static void header_pack(const Header_t *h, unsigned char *out)
+{
+    memcpy(out, h->magic, MAGIC_SIZE);
+    memcpy(out + MAGIC_SIZE, h->info, h->info_len);
+    memcpy(out + MAGIC_SIZE + h->info_len, h->salt, SALT_SIZE);
+    memcpy(out + MAGIC_SIZE + h->info_len + SALT_SIZE, h->iv, IV_SIZE);
+}
+
+/* Reads header of the kind h->magic and h->info_len say */
+static bool header_read(FILE *fp, Header_t *h)
+{
+    unsigned char magic[MAGIC_SIZE];
+
+    return fread(magic, 1, MAGIC_SIZE, fp) == MAGIC_SIZE &&
+           memcmp(magic, h->magic, MAGIC_SIZE) == 0 &&
+           fread(h->info, 1, h->info_len, fp) == h->info_len &&
+           fread(h->salt, 1, SALT_SIZE, fp) == SALT_SIZE &&
+           fread(h->iv, 1, IV_SIZE, fp) == IV_SIZE;
+}
+
+/* Encrypts compressed data and writes it */
+static void seal(Stream_t *st, const uint8_t *data, size_t len)
+{
+    int out_len = 0;
+
+    if(!st->ok || len == 0)
+        return;
+
+    if(EVP_CipherUpdate(st->cipher, st->sealed, &out_len, data, len) != 1 ||
+       EVP_DigestSignUpdate(st->mac, st->sealed, out_len) != 1 ||
+       fwrite(st->sealed, 1, out_len, st->fp) != (size_t)out_len)
+    {
+        fprintf(stderr, "Unable to write the file.\n");
+        st->ok = false;
+        return;
+    }
+
+    st->file_bytes += out_len;
+}
+
+/* Compresses len bytes of data, flush is a zlib flush mode */
+static void pack(Stream_t *st, const uint8_t *data, size_t len, int flush)
+{
+    int rc;
+
+    st->zs.next_in = (uint8_t *)data;
+    st->zs.avail_in = len;
+
+    do
+    {
+        st->zs.next_out = st->packed;
+        st->zs.avail_out = BACKUP_CHUNK;
+
+        rc = deflate(&st->zs, flush);
+        seal(st, st->packed, BACKUP_CHUNK - st->zs.avail_out);
+    }
+    while(st->ok && (st->zs.avail_out == 0 || (flush == Z_FINISH && rc != Z_STREAM_END)));
+}
+
+static void put(Stream_t *st, const void *data, size_t len)
+{
+    st->raw_bytes += len;
+
+    if(st->plain_len + len > BACKUP_CHUNK)
+    {
+        pack(st, st->plain, st->plain_len, Z_NO_FLUSH);
+        st->plain_len = 0;
+    }
+
+    if(len > BACKUP_CHUNK)
+    {
+        pack(st, data, len, Z_NO_FLUSH);
+        return;
+    }
+
+    memcpy(st->plain + st->plain_len, data, len);
+    st->plain_len += len;
+}
+
+static void put_varint(Stream_t *st, uint64_t value)
+{
+    uint8_t bytes[10];
+    size_t len = 0;
+
+    do
+    {
+        bytes[len] = value & 0x7F;
+        value >>= 7;
+
+        if(value)
+            bytes[len] |= 0x80;
+
+        len++;
+    }
+    while(value);
+
+    put(st, bytes, len);
+}
+
+static void put_entry(Stream_t *st, const Entry_t *entry)
+{
+    const char *fields[BACKUP_FIELDS] = { entry->title, entry->user, entry->url,
+                                          entry->password, entry->notes, entry->stamp };
+
+    if(st->ops)
+        put_varint(st, RECORD_PUT);
+
+    put_varint(st, entry->id);
+
+    for(int i = 0; i < BACKUP_FIELDS; i++)
+    {
+        size_t len = strlen(fields[i]);
+
+        put_varint(st, len);
+        put(st, fields[i], len);
+    }
+
+    st->entries++;
+}
+
+static bool cb_put_entry(Entry_t *entry, void *data)
+{
+    Stream_t *st = data;
+
+    put_entry(st, entry);
+
+    return st->ok;
+}
+
+static bool cb_put_change(int id, Entry_t *entry, void *data)
+{
+    Stream_t *st = data;
+
+    if(entry)
+    {
+        put_entry(st, entry);
+    }
+    else
+    {
+        put_varint(st, RECORD_DELETE);
+        put_varint(st, id);
+        st->deleted++;
+    }
+
+    return st->ok;
+}
+
+/* Reports throughput and compression ratio */
+static void print_stats(uint64_t raw_bytes, uint64_t file_bytes, double seconds)
+{
+    double mb = raw_bytes / (1024.0 * 1024.0);
+
+    fprintf(stdout, "%.1f MB in %.2f s, %.1f MB/s, compressed to %.1f%% of the size.\n",
+            mb, seconds, seconds > 0 ? mb / seconds : 0.0,
+            raw_bytes ? 100.0 * file_bytes / raw_bytes : 100.0);
+}
+
+/* Writes header h and the records of cb to path, encrypted with keys.
+ * The file is written next to path and renamed over it when complete,
+ * so a failed write never replaces a good file.
+ */
+static bool write_file(const char *path, Header_t *h, const Backup_keys_t *keys,
+                       Records_cb cb, void *data, Stream_t *st)
+{
+    unsigned char header[MAGIC_SIZE + SNAPSHOT_INFO_SIZE + SALT_SIZE + IV_SIZE];
+    unsigned char hmac[HMAC_SHA512_SIZE];
+    size_t hmac_len = sizeof(hmac);
+    bool ops = st->ops;
+    bool ok;
+
+    char *tmp_path = tmalloc(strlen(path) + 5);
+
+    strcpy(tmp_path, path);
+    strcat(tmp_path, ".tmp");
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    FILE *fp = fd == -1 ? NULL : fdopen(fd, "w");
+
+    if(!fp)
+    {
+        fprintf(stderr, "Unable to create %s.\n", tmp_path);
+
+        if(fd != -1)
+            close(fd);
+
+        free(tmp_path);
+        return false;
+    }
+
+    ok = RAND_bytes(h->iv, IV_SIZE) == 1 && stream_init(st, fp, keys, h->iv, true);
+
+    if(ok)
+    {
+        st->ops = ops;
+        header_pack(h, header);
+
+        ok = fwrite(header, 1, header_size(h), fp) == header_size(h) &&
+             EVP_DigestSignUpdate(st->mac, header, header_size(h)) == 1;
+
+        st->file_bytes = header_size(h);
+
+        ok = ok && cb(st, data) && st->ok;
+
+        if(ok)
+        {
+            pack(st, st->plain, st->plain_len, Z_FINISH);
+            ok = st->ok && EVP_DigestSignFinal(st->mac, hmac, &hmac_len) == 1 &&
+                 fwrite(hmac, 1, HMAC_SHA512_SIZE, fp) == HMAC_SHA512_SIZE;
+            st->file_bytes += HMAC_SHA512_SIZE;
+        }
+    }
+
+    stream_free(st, true);
+
+    ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0 && ok;
+    fclose(fp);
+
+    if(!ok || rename(tmp_path, path) != 0)
+    {
+        fprintf(stderr, "Writing %s failed.\n", path);
+        unlink(tmp_path);
+        free(tmp_path);
+        return false;
+    }
+
+    free(tmp_path);
+
+    return true;
+}
+
+static bool backup_records(Stream_t *st, void *data)
+{
+    (void)data;
+
+    return db_stream_list(-1, cb_put_entry, st);
+}
+
+/* Writes all entries of the active database to path, encrypted with
+ * passphrase.
+ */
+bool backup_export(const char *path, const char *passphrase)
+{
+    Header_t h = { BACKUP_MAGIC, 0 };
+    Backup_keys_t *keys = secure_alloc(sizeof(Backup_keys_t));
+    Stream_t st = { 0 };
+
+    double start = now_seconds();
+
+    if(!derive_keys(passphrase, NULL, keys, h.salt))
+    {
+        secure_free(keys);
+        return false;
+    }
+
+    bool ok = write_file(path, &h, keys, backup_records, NULL, &st);
+
+    secure_free(keys);
+
+    if(!ok)
+        return false;
+
+    fprintf(stdout, "Backed up %ld entries to %s.\n", st.entries, path);
+    print_stats(st.raw_bytes, st.file_bytes, now_seconds() - start);
+
+    return true;
+}
+
+static bool read_varint(const uint8_t **p, const uint8_t *end, uint64_t *value)
+{
+    *value = 0;
+
+    for(int shift = 0; shift < 64 && *p < end; shift += 7)
+    {
+        uint8_t byte = *(*p)++;
+
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+
+        if(!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+/* Returns the size of the record at the start of data, 0 if it is not
+ * all there yet or -1 if it is damaged.
+ */
+static long record_size(const Stream_t *st, const uint8_t *data, size_t len)
+{
+    const uint8_t *p = data;
+    const uint8_t *end = data + len;
+    uint64_t op = RECORD_PUT;
+    uint64_t value;
+
+    if(st->ops && !read_varint(&p, end, &op))
+        return len >= 10 ? -1 : 0;
+
+    if(op != RECORD_PUT && op != RECORD_DELETE)
+        return -1;
+
+    if(!read_varint(&p, end, &value))
+        return end - p >= 10 ? -1 : 0;
+
+    for(int i = 0; op == RECORD_PUT && i < BACKUP_FIELDS; i++)
+    {
+        if(!read_varint(&p, end, &value))
+            return end - p >= 10 ? -1 : 0;
+
+        if(value > BACKUP_FIELD_MAX)
+            return -1;
+
+        if(value > (uint64_t)(end - p))
+            return 0;
+
+        p += value;
+    }
+
+    return p - data;
+}
+
+/* Decodes a complete record and applies it unless the query skips it */
+static bool restore_record(Stream_t *st, const uint8_t *data, size_t len)
+{
+    const uint8_t *p = data;
+    const uint8_t *end = data + len;
+    char *values[BACKUP_FIELDS];
+    uint64_t op = RECORD_PUT;
+    uint64_t id;
+    bool ok = true;
+    bool match = true;
+
+    if(st->ops)
+        read_varint(&p, end, &op);
+
+    read_varint(&p, end, &id);
+
+    if(op == RECORD_DELETE)
+    {
+        bool changes = false;
+
+        st->deleted++;
+
+        return db_delete_entry(id, &changes);
+    }
+
+    char *text = tmalloc(len + BACKUP_FIELDS);
+    char *out = text;
+
+    for(int i = 0; i < BACKUP_FIELDS; i++)
+    {
+        uint64_t size;
+
+        read_varint(&p, end, &size);
+        memcpy(out, p, size);
+        out[size] = '\0';
+        values[i] = out;
+        out += size + 1;
+        p += size;
+    }
+
+    Entry_t entry;
+
+    entry.id = id;
+    entry.title = values[0];
+    entry.user = values[1];
+    entry.url = values[2];
+    entry.password = values[3];
+    entry.notes = values[4];
+    entry.stamp = values[5];
+    entry.next = NULL;
+
+    st->entries++;
+
+    if(st->query)
+        ok = db_entry_matches(st->query, &entry, &match);
+
+    if(ok && match)
+    {
+        ok = db_restore_entry(&entry);
+        st->restored++;
+    }
+
+    OPENSSL_cleanse(text, len + BACKUP_FIELDS);
+    free(text);
+
+    return ok;
+}
+
+/* Checks the HMAC of the whole file before anything is restored.
+ * Leaves fp at the start of the data.
+ */
+static bool verify_file(Stream_t *st, uint64_t data_end, size_t header_len)
+{
+    unsigned char stored[HMAC_SHA512_SIZE];
+    unsigned char hmac[HMAC_SHA512_SIZE];
+    size_t hmac_len = sizeof(hmac);
+    uint64_t left = data_end;
+
+    rewind(st->fp);
+
+    while(left > 0)
+    {
+        size_t n = left < BACKUP_CHUNK ? left : BACKUP_CHUNK;
+
+        if(fread(st->sealed, 1, n, st->fp) != n ||
+           EVP_DigestSignUpdate(st->mac, st->sealed, n) != 1)
+            return false;
+
+        left -= n;
+    }
+
+    if(fread(stored, 1, HMAC_SHA512_SIZE, st->fp) != HMAC_SHA512_SIZE ||
+       EVP_DigestSignFinal(st->mac, hmac, &hmac_len) != 1 ||
+       CRYPTO_memcmp(stored, hmac, HMAC_SHA512_SIZE) != 0)
+        return false;
+
+    return fseek(st->fp, header_len, SEEK_SET) == 0;
+}
+
+/* Decrypts, decompresses and applies the data */
+static bool restore_data(Stream_t *st, uint64_t data_len)
+{
+    uint64_t left = data_len;
+    uint8_t *pending = NULL;
+    size_t pending_len = 0;
+    size_t pending_cap = 0;
+    int rc = Z_OK;
+    bool ok = true;
+
+    while(ok && left > 0 && rc != Z_STREAM_END)
+    {
+        size_t n = left < BACKUP_CHUNK ? left : BACKUP_CHUNK;
+        int plain_len = 0;
+
+        if(fread(st->sealed, 1, n, st->fp) != n ||
+           EVP_CipherUpdate(st->cipher, st->packed, &plain_len, st->sealed, n) != 1)
+        {
+            ok = false;
+            break;
+        }
+
+        left -= n;
+        st->file_bytes += n;
+        st->zs.next_in = st->packed;
+        st->zs.avail_in = plain_len;
+
+        while(ok && st->zs.avail_in > 0 && rc != Z_STREAM_END)
+        {
+            st->zs.next_out = st->plain;
+            st->zs.avail_out = BACKUP_CHUNK;
+
+            rc = inflate(&st->zs, Z_NO_FLUSH);
+
+            if(rc != Z_OK && rc != Z_STREAM_END)
+            {
+                ok = false;
+                break;
+            }
+
+            size_t out_len = BACKUP_CHUNK - st->zs.avail_out;
+
+            if(pending_len + out_len > pending_cap)
+            {
+                /* Grow by copying, so the old buffer is wiped and not left behind */
+                uint8_t *grown = secure_alloc((pending_len + out_len) * 2);
+
+                if(pending)
+                    memcpy(grown, pending, pending_len);
+
+                secure_free(pending);
+                pending = grown;
+                pending_cap = (pending_len + out_len) * 2;
+            }
+
+            memcpy(pending + pending_len, st->plain, out_len);
+            pending_len += out_len;
+            st->raw_bytes += out_len;
+
+            size_t used = 0;
+            long size = 0;
+
+            while(ok && (size = record_size(st, pending + used, pending_len - used)) > 0)
+            {
+                ok = restore_record(st, pending + used, size);
+                used += size;
+            }
+
+            if(size == -1)
+                ok = false;
+
+            memmove(pending, pending + used, pending_len - used);
+            pending_len -= used;
+        }
+    }
+
+    /* Stream must end exactly with the data, with no record left over */
+    if(rc != Z_STREAM_END || left > 0 || st->zs.avail_in > 0 || pending_len > 0)
+        ok = false;
+
+    secure_free(pending);
+
+    return ok;
+}
+
+/* Verifies file path of the kind h says and applies its records. Counts
+ * are added to totals.
+ */
+static bool read_file(const char *path, Header_t *h, const char *passphrase,
+                      Key_cache_t *cache, Stream_t *totals)
+{
+    const Backup_keys_t *keys;
+    Stream_t st = { 0 };
+    struct stat sb;
+    bool ok;
+
+    FILE *fp = fopen(path, "r");
+
+    if(!fp)
+    {
+        fprintf(stderr, "Unable to open %s.\n", path);
+        return false;
+    }
+
+    if(fstat(fileno(fp), &sb) != 0 ||
+       (uint64_t)sb.st_size < header_size(h) + HMAC_SHA512_SIZE || !header_read(fp, h))
+    {
+        fprintf(stderr, "%s is not a Ylva %s.\n", path,
+                h->info_len ? "snapshot" : "backup");
+        fclose(fp);
+        return false;
+    }
+
+    uint64_t data_end = sb.st_size - HMAC_SHA512_SIZE;
+
+    ok = (keys = cached_keys(cache, passphrase, h->salt)) != NULL &&
+         stream_init(&st, fp, keys, h->iv, false);
+
+    st.ops = totals->ops;
+    st.query = totals->query;
+
+    if(!ok)
+    {
+        /* Error was already told */
+    }
+    else if(!verify_file(&st, data_end, header_size(h)))
+    {
+        fprintf(stderr, "Wrong password or damaged file %s.\n", path);
+        ok = false;
+    }
+    else if(!restore_data(&st, data_end - header_size(h)))
+    {
+        fprintf(stderr, "Unable to restore %s.\n", path);
+        ok = false;
+    }
+
+    totals->entries += st.entries;
+    totals->restored += st.restored;
+    totals->deleted += st.deleted;
+    totals->raw_bytes += st.raw_bytes;
+    totals->file_bytes += st.file_bytes + header_size(h) + HMAC_SHA512_SIZE;
+
+    stream_free(&st, false);
+    fclose(fp);
+
+    return ok;
+}
+
+/* Restores entries from backup in path to the active database. Entries
+ * keep their ids, an entry with the same id is replaced. With query only
+ * the matching entries are restored. The HMAC of the file is verified
+ * before anything is written.
+ */
+bool backup_restore(const char *path, const char *passphrase, const char *query_text)
+{
+    Header_t h = { BACKUP_MAGIC, 0 };
+    Key_cache_t *cache;
+    Stream_t totals = { 0 };
+    Query_t *query = NULL;
+
+    double start = now_seconds();
+
+    if(query_text && !(query = query_compile(query_text)))
+        return false;
+
+    totals.query = query;
+    cache = secure_alloc(sizeof(Key_cache_t));
+
+    bool ok = read_file(path, &h, passphrase, cache, &totals);
+
+    secure_free(cache);
+    query_free(query);
+
+    if(!ok)
+        return false;
+
+    fprintf(stdout, "Restored %ld of %ld entries from %s.\n",
+            totals.restored, totals.entries, path);
+    print_stats(totals.raw_bytes, totals.file_bytes, now_seconds() - start);
+
+    return true;
+}
+
+static void put_le(unsigned char *out, uint64_t value, int bytes)
+{
+    for(int i = 0; i < bytes; i++)
+        out[i] = value >> (8 * i);
+}
+
+static uint64_t get_le(const unsigned char *in, int bytes)
+{
+    uint64_t value = 0;
+
+    for(int i = 0; i < bytes; i++)
+        value |= (uint64_t)in[i] << (8 * i);
+
+    return value;
+}
+
+static void info_pack(const Snapshot_info_t *info, unsigned char *out)
+{
+    memcpy(out, info->chain, CHAIN_ID_SIZE);
+    put_le(out + CHAIN_ID_SIZE, info->number, 4);
+    put_le(out + CHAIN_ID_SIZE + 4, info->flags, 4);
+    put_le(out + CHAIN_ID_SIZE + 8, info->created, 8);
+    memcpy(out + CHAIN_ID_SIZE + 16, info->check, KEY_CHECK_SIZE);
+}
+
+static void info_unpack(const unsigned char *in, Snapshot_info_t *info)
+{
+    memcpy(info->chain, in, CHAIN_ID_SIZE);
+    info->number = get_le(in + CHAIN_ID_SIZE, 4);
+    info->flags = get_le(in + CHAIN_ID_SIZE + 4, 4);
+    info->created = get_le(in + CHAIN_ID_SIZE + 8, 8);
+    memcpy(info->check, in + CHAIN_ID_SIZE + 16, KEY_CHECK_SIZE);
+}
+
+static void key_check(const Backup_keys_t *keys, const unsigned char *chain,
+                      unsigned char *check)
+{
+    unsigned int len = 0;
+
+    HMAC(EVP_sha256(), keys->mac, KEY_SIZE, chain, CHAIN_ID_SIZE, check, &len);
+}
+
+/* Returns path of snapshot number in dir. Caller must free the return value */
+static char *snapshot_path(const char *dir, uint32_t number)
+{
+    size_t len = strlen(dir) + 16;
+    char *path = tmalloc(len);
+
+    snprintf(path, len, "%s/" SNAPSHOT_NAME, dir, number);
+
+    return path;
+}
+
+/* Returns the number of the newest snapshot in dir, 0 if there are none */
+static uint32_t snapshot_last(const char *dir)
+{
+    DIR *d = opendir(dir);
+    struct dirent *ent;
+    uint32_t last = 0;
+
+    if(!d)
+        return 0;
+
+    while((ent = readdir(d)) != NULL)
+    {
+        unsigned int number;
+        char rest[2];
+
+        if(strlen(ent->d_name) == 13 &&
+           sscanf(ent->d_name, "%8u.sna%1[p]", &number, rest) == 2 && number > last)
+            last = number;
+    }
+
+    closedir(d);
+
+    return last;
+}
+
+/* Reads the header of snapshot number in dir without decrypting it */
+static bool snapshot_header(const char *dir, uint32_t number, Header_t *h,
+                            Snapshot_info_t *info)
+{
+    char *path = snapshot_path(dir, number);
+    FILE *fp = fopen(path, "r");
+
+    h->magic = SNAPSHOT_MAGIC;
+    h->info_len = SNAPSHOT_INFO_SIZE;
+
+    bool ok = fp && header_read(fp, h);
+
+    if(fp)
+        fclose(fp);
+
+    if(ok)
+        info_unpack(h->info, info);
+
+    if(!ok || info->number != number)
+    {
+        fprintf(stderr, "%s is missing or not a Ylva snapshot.\n", path);
+        ok = false;
+    }
+
+    free(path);
+
+    return ok;
+}
+
+static void chain_hex(const unsigned char *chain, char *hex)
+{
+    for(int i = 0; i < CHAIN_ID_SIZE; i++)
+        sprintf(hex + i * 2, "%02x", chain[i]);
+}
+
+bool snapshot_exists(const char *dir)
+{
+    return snapshot_last(dir) > 0;
+}
+
+typedef struct _snapshot_job
+{
+    bool full;
+    long long since;
+
+} Snapshot_job_t;
+
+static bool snapshot_records(Stream_t *st, void *data)
+{
+    Snapshot_job_t *job = data;
+
+    if(job->full)
+        return db_stream_list(-1, cb_put_entry, st);
+
+    return db_stream_changes(job->since, cb_put_change, st);
+}
+
+/* Writes the entries added, changed or removed since the previous
+ * snapshot in dir as the next snapshot. The database keeps a log of
+ * changed ids for each chain of snapshots, so the cost depends on the
+ * number of changes. The first snapshot of a chain, or one taken with a
+ * database that does not know the chain, has all entries.
+ */
+bool snapshot_write(const char *dir, const char *passphrase)
+{
+    Header_t h = { SNAPSHOT_MAGIC, SNAPSHOT_INFO_SIZE };
+    Snapshot_info_t info = { { 0 } };
+    Snapshot_job_t job = { false, 0 };
+    Key_cache_t *cache;
+    const Backup_keys_t *keys;
+    Stream_t st = { 0 };
+    char hex[CHAIN_ID_SIZE * 2 + 1];
+    long long current = 0;
+
+    double start = now_seconds();
+
+    if(mkdir(dir, S_IRWXU) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Unable to create %s.\n", dir);
+        return false;
+    }
+
+    uint32_t last = snapshot_last(dir);
+
+    if(last > 0 && !snapshot_header(dir, last, &h, &info))
+        return false;
+
+    if(last == 0 && RAND_bytes(info.chain, CHAIN_ID_SIZE) != 1)
+        return false;
+
+    cache = secure_alloc(sizeof(Key_cache_t));
+
+    if(last > 0)
+    {
+
+        /* Same salt for the whole chain */
+        keys = cached_keys(cache, passphrase, h.salt);
+    }
+    else
+    {
+        cache->valid = derive_keys(passphrase, NULL, &cache->keys, cache->salt);
+        keys = cache->valid ? &cache->keys : NULL;
+        memcpy(h.salt, cache->salt, SALT_SIZE);
+    }
+
+    if(!keys)
+    {
+        secure_free(cache);
+        return false;
+    }
+
+    unsigned char check[KEY_CHECK_SIZE];
+
+    key_check(keys, info.chain, check);
+
+    if(last > 0 && CRYPTO_memcmp(check, info.check, KEY_CHECK_SIZE) != 0)
+    {
+        fprintf(stderr, "Wrong password for the snapshots in %s.\n", dir);
+        secure_free(cache);
+        return false;
+    }
+
+    memcpy(info.check, check, KEY_CHECK_SIZE);
+    chain_hex(info.chain, hex);
+
+    if(!db_snapshot_state(hex, &job.since, &current))
+    {
+        secure_free(cache);
+        return false;
+    }
+
+    job.full = job.since == -1;
+
+    if(!job.full && job.since == current)
+    {
+        fprintf(stdout, "No changes since snapshot %u.\n", last);
+        secure_free(cache);
+        return true;
+    }
+
+    info.number = last + 1;
+    info.flags = job.full ? SNAPSHOT_FULL : 0;
+    info.created = time(NULL);
+    info_pack(&info, h.info);
+
+    char *path = snapshot_path(dir, info.number);
+
+    st.ops = true;
+
+    bool ok = write_file(path, &h, keys, snapshot_records, &job, &st) &&
+              db_snapshot_done(hex, current);
+
+    secure_free(cache);
+
+    if(ok)
+    {
+        if(job.full)
+            fprintf(stdout, "Wrote full snapshot %s with %ld entries.\n", path, st.entries);
+        else
+            fprintf(stdout, "Wrote snapshot %s with %ld changed and %ld removed entries.\n",
+                    path, st.entries, st.deleted);
+
+        print_stats(st.raw_bytes, st.file_bytes, now_seconds() - start);
+    }
+
+    free(path);
+
+    return ok;
+}
+
+/* Makes the active database what it was at the newest snapshot in dir
+ * taken at or before at, or the newest snapshot if at is -1. Replay
+ * starts from the newest full snapshot before it. Every file is verified
+ * before its changes are applied, and all of it is one transaction.
+ */
+bool snapshot_restore(const char *dir, const char *passphrase, long long at)
+{
+    Header_t h;
+    Snapshot_info_t info;
+    Key_cache_t *cache;
+    Stream_t totals = { 0 };
+    unsigned char chain[CHAIN_ID_SIZE];
+    uint32_t target = 0;
+    uint32_t first = 1;
+    int64_t created = 0;
+
+    double start = now_seconds();
+    uint32_t last = snapshot_last(dir);
+
+    if(last == 0)
+    {
+        fprintf(stderr, "No snapshots in %s.\n", dir);
+        return false;
+    }
+
+    /* Headers are not encrypted, so the replay can be planned first */
+    for(uint32_t i = 1; i <= last; i++)
+    {
+        if(!snapshot_header(dir, i, &h, &info))
+            return false;
+
+        if(i == 1)
+            memcpy(chain, info.chain, CHAIN_ID_SIZE);
+
+        if(memcmp(chain, info.chain, CHAIN_ID_SIZE) != 0)
+        {
+            fprintf(stderr, "Snapshot %u in %s is from another chain.\n", i, dir);
+            return false;
+        }
+
+        if(at != -1 && info.created > at)
+            break;
+
+        if(info.flags & SNAPSHOT_FULL)
+            first = i;
+
+        target = i;
+        created = info.created;
+    }
+
+    if(target == 0)
+    {
+        fprintf(stderr, "No snapshot in %s is that old.\n", dir);
+        return false;
+    }
+
+    bool ok = db_clear_entries();
+
+    totals.ops = true;
+    cache = secure_alloc(sizeof(Key_cache_t));
+
+    for(uint32_t i = first; ok && i <= target; i++)
+    {
+        char *path = snapshot_path(dir, i);
+
+        h.magic = SNAPSHOT_MAGIC;
+        h.info_len = SNAPSHOT_INFO_SIZE;
+        ok = read_file(path, &h, passphrase, cache, &totals);
+        free(path);
+    }
+
+    secure_free(cache);
+
+    if(!ok)
+        return false;
+
+    char stamp[32];
+    time_t t = created;
+
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    fprintf(stdout, "Restored snapshot %u of %s from %s, replayed %u files.\n",
+            target, dir, stamp, target - first + 1);
+    print_stats(totals.raw_bytes, totals.file_bytes, now_seconds() - start);
+
+    return true;
+}
@@ -0,0 +1,16 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __BACKUP_H
+#define __BACKUP_H
+
+#include <stdbool.h>
+
+bool backup_export(const char *path, const char *passphrase);
+bool backup_restore(const char *path, const char *passphrase, const char *query_text);
+bool snapshot_exists(const char *dir);
+bool snapshot_write(const char *dir, const char *passphrase);
+bool snapshot_restore(const char *dir, const char *passphrase, long long at);
+
+#endif
@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "batch.h"
+#include "entry.h"
+#include "db.h"
+#include "utils.h"
+#include "render.h"
+#include "pwd-gen.h"
+#include "cmd_ui.h"
+#include "securemem.h"
+
+/* Batch file syntax, one command per line:
+ *
+ *   add title=GitHub user=me url=https://github.com "notes=two words"
+ *   edit 12 password=secret
+ *   remove 12
+ *   get 12
+ *   find github
+ *
+ * Arguments are separated by spaces. Double quotes group words and
+ * allow \" and \\ escapes, single quotes are taken literally. Empty lines
+ * and lines starting with # are skipped. add generates a password if
+ * none is given, like --add does.
+ */
+
+#define BATCH_ARGS_MAX 16
+
+typedef struct _batch
+{
+    Render_t *render;
+    int line;
+
+} Batch_t;
+
+/* Splits line to arguments in place. Returns the number of arguments
+ * or -1 on unbalanced quotes.
+ */
+static int split_args(char *line, char **args, int max)
+{
+    char *s = line;
+    int count = 0;
+
+    while(true)
+    {
+        while(*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r')
+            s++;
+
+        if(*s == '\0')
+            break;
+
+        if(count == max)
+            return -1;
+
+        char *out = s;
+        args[count++] = out;
+
+        while(*s != '\0' && *s != ' ' && *s != '\t' && *s != '\n' && *s != '\r')
+        {
+            if(*s == '"' || *s == '\'')
+            {
+                char quote = *s++;
+
+                while(*s != quote)
+                {
+                    if(*s == '\0')
+                        return -1;
+
+                    if(quote == '"' && *s == '\\' && (s[1] == '"' || s[1] == '\\'))
+                        s++;
+
+                    *out++ = *s++;
+                }
+
+                s++;
+            }
+            else
+            {
+                *out++ = *s++;
+            }
+        }
+
+        /* Terminate after the loop, out never passes s */
+        bool end = *s == '\0';
+
+        *out = '\0';
+
+        if(end)
+            break;
+
+        s++;
+    }
+
+    return count;
+}
+
+static void batch_error(Batch_t *batch, const char *error)
+{
+    fprintf(stderr, "Line %d: %s\n", batch->line, error);
+}
+
+/* Sets fields of entry from key=value arguments */
+static bool set_fields(Batch_t *batch, Entry_t *entry, char **args, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        char *value = strchr(args[i], '=');
+        char **field = NULL;
+
+        if(!value)
+        {
+            batch_error(batch, "Expected field=value.");
+            return false;
+        }
+
+        *value++ = '\0';
+
+        if(strcmp(args[i], "title") == 0)
+            field = &entry->title;
+        else if(strcmp(args[i], "user") == 0)
+            field = &entry->user;
+        else if(strcmp(args[i], "url") == 0)
+            field = &entry->url;
+        else if(strcmp(args[i], "password") == 0)
+            field = &entry->password;
+        else if(strcmp(args[i], "notes") == 0)
+            field = &entry->notes;
+
+        if(!field)
+        {
+            batch_error(batch, "Unknown field.");
+            return false;
+        }
+
+        if(field == &entry->password)
+        {
+            secure_free(*field);
+            *field = secure_strdup(value);
+        }
+        else
+        {
+            free(*field);
+            *field = strdup(value);
+        }
+    }
+
+    return true;
+}
+
+static bool parse_id(Batch_t *batch, const char *arg, int *id)
+{
+    char *end = NULL;
+
+    *id = strtol(arg, &end, 10);
+
+    if(*end != '\0' || end == arg)
+    {
+        batch_error(batch, "Invalid id.");
+        return false;
+    }
+
+    return true;
+}
+
+static bool batch_add(Batch_t *batch, char **args, int count)
+{
+    char *user = get_default_username();
+    Entry_t *entry = entry_new("", user ? user : "", "", "", "");
+
+    if(!set_fields(batch, entry, args + 1, count - 1))
+    {
+        entry_free(entry);
+        return false;
+    }
+
+    if(entry->password[0] == '\0')
+    {
+        char *pass = generate_password(20);
+
+        if(!pass)
+        {
+            batch_error(batch, "Unable to generate new password.");
+            entry_free(entry);
+            return false;
+        }
+
+        secure_free(entry->password);
+        entry->password = pass;
+    }
+
+    bool ok = db_insert_entry(entry);
+
+    entry_free(entry);
+
+    return ok;
+}
+
+static bool batch_edit(Batch_t *batch, char **args, int count)
+{
+    int id;
+
+    if(count < 3)
+    {
+        batch_error(batch, "Expected an id and fields to change.");
+        return false;
+    }
+
+    if(!parse_id(batch, args[1], &id))
+        return false;
+
+    Entry_t *entry = db_get_entry_by_id(id);
+
+    if(!entry)
+        return false;
+
+    if(entry->id == -1)
+    {
+        batch_error(batch, "No entry with the id.");
+        entry_free(entry);
+        return false;
+    }
+
+    bool ok = set_fields(batch, entry, args + 2, count - 2) &&
+              db_update_entry(id, entry);
+
+    entry_free(entry);
+
+    return ok;
+}
+
+static bool batch_remove(Batch_t *batch, char **args, int count)
+{
+    bool changes = false;
+    int id;
+
+    if(count != 2)
+    {
+        batch_error(batch, "Expected an id.");
+        return false;
+    }
+
+    if(!parse_id(batch, args[1], &id))
+        return false;
+
+    if(!db_delete_entry(id, &changes))
+        return false;
+
+    if(!changes)
+    {
+        batch_error(batch, "No entry with the id.");
+        return false;
+    }
+
+    return true;
+}
+
+static bool batch_get(Batch_t *batch, char **args, int count)
+{
+    int id;
+
+    if(count != 2)
+    {
+        batch_error(batch, "Expected an id.");
+        return false;
+    }
+
+    if(!parse_id(batch, args[1], &id))
+        return false;
+
+    Entry_t *entry = db_get_entry_by_id(id);
+
+    if(!entry)
+        return false;
+
+    if(entry->id == -1)
+    {
+        batch_error(batch, "No entry with the id.");
+        entry_free(entry);
+        return false;
+    }
+
+    render_entry(batch->render, entry);
+    entry_free(entry);
+
+    return true;
+}
+
+static bool cb_render(Entry_t *entry, void *render)
+{
+    render_entry(render, entry);
+
+    return true;
+}
+
+static bool batch_find(Batch_t *batch, char **args, int count)
+{
+    if(count != 2)
+    {
+        batch_error(batch, "Expected one search term.");
+        return false;
+    }
+
+    return db_stream_find(args[1], cb_render, batch->render);
+}
+
+static bool run_command(Batch_t *batch, char *line)
+{
+    char *args[BATCH_ARGS_MAX];
+
+    if(line[strspn(line, " \t")] == '#')
+        return true;
+
+    int count = split_args(line, args, BATCH_ARGS_MAX);
+
+    if(count == -1)
+    {
+        batch_error(batch, "Missing closing quote or too many arguments.");
+        return false;
+    }
+
+    if(count == 0)
+        return true;
+
+    if(strcmp(args[0], "add") == 0)
+        return batch_add(batch, args, count);
+    else if(strcmp(args[0], "edit") == 0)
+        return batch_edit(batch, args, count);
+    else if(strcmp(args[0], "remove") == 0)
+        return batch_remove(batch, args, count);
+    else if(strcmp(args[0], "get") == 0)
+        return batch_get(batch, args, count);
+    else if(strcmp(args[0], "find") == 0)
+        return batch_find(batch, args, count);
+
+    batch_error(batch, "Unknown command.");
+
+    return false;
+}
+
+/* Runs commands read from path, or from stdin if path is "-". All
+ * commands share one connection and one transaction. If any of them
+ * fails, nothing is written and the rest are not run.
+ */
+bool run_batch(const char *path, int show_password, int format)
+{
+    FILE *fp = NULL;
+    char *line = NULL;
+    size_t len = 0;
+    bool ok = true;
+    bool from_stdin = strcmp(path, "-") == 0;
+    Batch_t batch;
+
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return false;
+    }
+
+    fp = from_stdin ? stdin : fopen(path, "r");
+
+    if(!fp)
+    {
+        fprintf(stderr, "Unable to open %s.\n", path);
+        return false;
+    }
+
+    if(!db_begin())
+    {
+        if(!from_stdin)
+            fclose(fp);
+
+        return false;
+    }
+
+    batch.render = render_new(stdout, format, show_password, 0);
+    batch.line = 0;
+
+    while(ok && getline(&line, &len, fp) != -1)
+    {
+        batch.line++;
+        ok = run_command(&batch, line);
+    }
+
+    free(line);
+
+    if(!from_stdin)
+        fclose(fp);
+
+    render_free(batch.render);
+
+    ok = db_end(ok);
+
+    if(!ok)
+    {
+        fprintf(stderr, "Batch failed, no changes were made.\n");
+        return false;
+    }
+
+    return true;
+}
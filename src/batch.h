@@ -0,0 +1,12 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __BATCH_H
+#define __BATCH_H
+
+#include <stdbool.h>
+
+bool run_batch(const char *path, int show_password, int format);
+
+#endif
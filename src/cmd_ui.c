@@ -10,13 +10,24 @@
 #include <string.h>
 #include <termios.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <time.h>
 #include "cmd_ui.h"
 #include "entry.h"
 #include "db.h"
 #include "utils.h"
 #include "crypto.h"
 #include "pwd-gen.h"
-#include "regexfind.h"
+#include "scan.h"
+#include "pick.h"
+#include "query.h"
+#include "render.h"
+#include "qr.h"
+#include "qrexport.h"
+#include "lock.h"
+#include "backup.h"
+#include "sync.h"
+#include "securemem.h"
 
 /*Removes new line character from a string.*/
 static void strip_newline_str(char *str)
@@ -50,59 +61,78 @@ static void generate_new_password(char *in_buffer)
     }
     else
     {
+        fprintf(stdout, "%s\n", new_pass);
         strcpy(in_buffer, new_pass);
-        free(new_pass);
+        secure_free(new_pass);
     }
 }
 
 /*Turns echo of from the terminal and asks for a passphrase.
  *Usually stream is stdin. Returns length of the passphrase,
- *passphrase is stored to lineptr. Lineptr must be allocated beforehand.
+ *passphrase is stored to buf which holds n bytes. The line is read
+ *straight to buf, so a secure buffer is never copied or reallocated.
  */
-static size_t my_getpass(char *prompt, char **lineptr, size_t *n,
+static size_t my_getpass(char *prompt, char *buf, size_t n,
                          FILE *stream)
 {
     struct termios old, new;
-    int nread;
+    int nread = -1;
 
-    /*Turn terminal echoing off.*/
-    if(tcgetattr(fileno(stream), &old) != 0)
-        return -1;
+    /*Turn terminal echoing off. Input that is not a terminal,
+     *like commands piped to the shell, is read as is.
+     */
+    bool tty = tcgetattr(fileno(stream), &old) == 0;
 
-    new = old;
-    new.c_lflag &= ~ECHO;
+    if(tty)
+    {
+        new = old;
+        new.c_lflag &= ~ECHO;
 
-    if(tcsetattr(fileno(stream), TCSAFLUSH, &new) != 0)
-        return -1;
+        if(tcsetattr(fileno(stream), TCSAFLUSH, &new) != 0)
+            return -1;
+    }
 
     if(prompt)
         printf("%s", prompt);
 
     /*Read the password.*/
-    nread = getline(lineptr, n, stream);
+    buf[0] = '\0';
 
-    if(nread >= 1 && (*lineptr)[nread - 1] == '\n')
+    if(fgets(buf, n, stream))
+        nread = strlen(buf);
+
+    if(nread >= 1 && buf[nread - 1] == '\n')
     {
-        (*lineptr)[nread - 1] = 0;
+        buf[nread - 1] = 0;
         nread--;
     }
 
     printf("\n");
 
     /*Restore terminal echo.*/
-    tcsetattr(fileno(stream), TCSAFLUSH, &old);
+    if(tty)
+        tcsetattr(fileno(stream), TCSAFLUSH, &old);
 
     return nread;
 }
 
-static void auto_enc()
+/* Entry_cb for the db_stream_* functions, every row is rendered
+ * as soon as it is read instead of collecting a list first.
+ */
+static bool cb_render(Entry_t *entry, void *render)
 {
-    fprintf(stdout, "Auto encrypt enabled, type password to encrypt.\n");
-    encrypt_database();
+    render_entry(render, entry);
+
+    return true;
 }
 
-void init_database(const char *path, int force, int auto_encrypt)
+void init_database(const char *path, int force)
 {
+    int lock = vault_lock(VAULT_EXCLUSIVE);
+
+    if(lock == -1)
+        return;
+
     if(!has_active_database() || force == 1)
     {
         //If forced, delete any existing file
@@ -113,12 +143,7 @@ void init_database(const char *path, int force, int auto_encrypt)
         }
 
         if(db_init_new(path))
-        {
             write_active_database_path(path);
-
-            if(auto_encrypt == 1)
-                auto_enc();
-        }
     }
     else
     {
@@ -126,6 +151,39 @@ void init_database(const char *path, int force, int auto_encrypt)
                 "Encrypt it before creating a new one.\n");
     }
 
+    vault_unlock(lock);
+}
+
+/* Asks a password with echo turned off. With confirm the password
+ * is asked twice. Returns NULL if the passwords don't match.
+ * Caller must free the return value with secure_free.
+ */
+char *read_password(const char *prompt, bool confirm)
+{
+    size_t pwdlen = 1024;
+    char *pass = secure_alloc(pwdlen);
+
+    my_getpass((char *)prompt, pass, pwdlen, stdin);
+
+    if(confirm)
+    {
+        char *pass2 = secure_alloc(pwdlen);
+
+        my_getpass("Password again: ", pass2, pwdlen, stdin);
+
+        bool match = strcmp(pass, pass2) == 0;
+
+        secure_free(pass2);
+
+        if(!match)
+        {
+            fprintf(stderr, "Password mismatch.\n");
+            secure_free(pass);
+            return NULL;
+        }
+    }
+
+    return pass;
 }
 
 bool decrypt_database(const char *path)
@@ -138,19 +196,31 @@ bool decrypt_database(const char *path)
         return false;
     }
 
-    size_t pwdlen = 1024;
-    char pass[pwdlen];
-    char *ptr = pass;
+    char *pass = read_password("Password: ", false);
+    bool ok = decrypt_database_with(path, pass);
 
-    my_getpass("Password: ", &ptr, &pwdlen, stdin);
+    secure_free(pass);
+
+    return ok;
+}
+
+/* Decrypts path with pass and makes it the active database */
+bool decrypt_database_with(const char *path, const char *pass)
+{
+    int lock = vault_lock(VAULT_EXCLUSIVE);
+
+    if(lock == -1)
+        return false;
 
     if(!decrypt_file(pass, path))
     {
         fprintf(stderr, "Failed to decrypt %s.\n", path);
+        vault_unlock(lock);
         return false;
     }
 
     write_active_database_path(path);
+    vault_unlock(lock);
 
     return true;
 }
@@ -163,36 +233,46 @@ bool encrypt_database()
         return false;
     }
 
-    size_t pwdlen = 1024;
-    char pass[pwdlen];
-    char *ptr = pass;
-    char pass2[pwdlen];
-    char *ptr2 = pass2;
+    char *pass = read_password("Password: ", true);
+
+    if(!pass)
+        return false;
+
+    bool ok = encrypt_database_with(pass);
+
+    secure_free(pass);
+
+    return ok;
+}
+
+/* Encrypts the active database with pass. Afterwards there is
+ * no active database.
+ */
+bool encrypt_database_with(const char *pass)
+{
     char *path = NULL;
     char *open_db_holder_path = NULL;
 
-    path = read_active_database_path();
+    /* Waits until no other process has the database open */
+    int lock = vault_lock(VAULT_EXCLUSIVE);
 
-    if(!path)
-    {
-        fprintf(stderr, "Unable to read activate database path.\n");
+    if(lock == -1)
         return false;
-    }
 
-    my_getpass("Password: ", &ptr, &pwdlen, stdin);
-    my_getpass("Password again: ", &ptr2, &pwdlen, stdin);
+    path = read_active_database_path();
 
-    if(strcmp(pass, pass2) != 0)
+    if(!path)
     {
-        fprintf(stderr, "Password mismatch.\n");
-        free(path);
+        fprintf(stderr, "Unable to read activate database path.\n");
+        vault_unlock(lock);
         return false;
     }
 
-    if(!encrypt_file(pass, path))
+    if(!db_checkpoint(path) || !encrypt_file(pass, path))
     {
         fprintf(stderr, "Encryption of %s failed.\n", path);
         free(path);
+        vault_unlock(lock);
         return false;
     }
 
@@ -203,6 +283,7 @@ bool encrypt_database()
     if(!open_db_holder_path)
     {
         fprintf(stderr, "Unable to retrieve the ylva.open_db file path.\n");
+        vault_unlock(lock);
         return false;
     }
 
@@ -210,12 +291,13 @@ bool encrypt_database()
     //This way we allow Ylva to create a new database or open another one.
     unlink(open_db_holder_path);
     free(open_db_holder_path);
+    vault_unlock(lock);
 
     return true;
 }
 
 /* Interactively adds a new entry to the database */
-bool add_new_entry(int auto_encrypt)
+bool add_new_entry()
 {
     if(!has_active_database())
     {
@@ -229,8 +311,7 @@ bool add_new_entry(int auto_encrypt)
     char url[1024] = {0};
     char notes[1024] = {0};
     size_t pwdlen = 1024;
-    char pass[pwdlen];
-    char *ptr = pass;
+    char *pass = secure_alloc(pwdlen);
 
     fprintf(stdout, "Title: ");
     fgets(title, 1024, stdin);
@@ -251,7 +332,7 @@ bool add_new_entry(int auto_encrypt)
     fprintf(stdout, "Notes: ");
     fgets(notes, 1024, stdin);
 
-    my_getpass("Password (empty to generate new): ", &ptr, &pwdlen, stdin);
+    my_getpass("Password (empty to generate new): ", pass, pwdlen, stdin);
 
     if(strcmp(pass, "") == 0)
         generate_new_password(pass);
@@ -264,6 +345,8 @@ bool add_new_entry(int auto_encrypt)
     Entry_t *entry = entry_new(title, user, url, pass,
                                notes);
 
+    secure_free(pass);
+
     if(!entry)
         return false;
 
@@ -275,13 +358,10 @@ bool add_new_entry(int auto_encrypt)
 
     entry_free(entry);
 
-    if(auto_encrypt == 1)
-        auto_enc();
-
     return true;
 }
 
-bool edit_entry(int id, int auto_encrypt)
+bool edit_entry(int id)
 {
     if(!has_active_database())
     {
@@ -306,8 +386,7 @@ bool edit_entry(int id, int auto_encrypt)
     char url[1024] = {0};
     char notes[1024] = {0};
     size_t pwdlen = 1024;
-    char pass[pwdlen];
-    char *ptr = pass;
+    char *pass = secure_alloc(pwdlen);
     bool update = false;
 
     fprintf(stdout, "Current title %s\n", entry->title);
@@ -323,7 +402,7 @@ bool edit_entry(int id, int auto_encrypt)
     fprintf(stdout, "New note: ");
     fgets(notes, 1024, stdin);
     fprintf(stdout, "Current password %s\n", entry->password);
-    my_getpass("New password (empty to generate new): ", &ptr, &pwdlen,
+    my_getpass("New password (empty to generate new): ", pass, pwdlen,
             stdin);
 
     if (strcmp(pass, "") == 0) {
@@ -335,10 +414,8 @@ bool edit_entry(int id, int auto_encrypt)
     strip_newline_str(url);
     strip_newline_str(notes);
 
-    //We need to manually free the entry field to avoid dublicate allocation
-    //caused by the database query. Password field will be always allocated, other
-    //are freed if necessary below
-    free(entry->password);
+    //We need to manually free the entry fields to avoid dublicate allocation
+    //caused by the database query. Fields are freed if necessary below
 
     if(title[0] != '\0')
     {
@@ -366,19 +443,18 @@ bool edit_entry(int id, int auto_encrypt)
     }
     if(pass[0] != '\0')
     {
-        entry->password = strdup(pass);
+        secure_free(entry->password);
+        entry->password = secure_strdup(pass);
         update = true;
     }
 
-    if(update)
-        db_update_entry(entry->id, entry);
+    secure_free(pass);
 
-    entry_free(entry);
+    bool ok = !update || db_update_entry(entry->id, entry);
 
-    if(auto_encrypt == 1)
-        auto_enc();
+    entry_free(entry);
 
-    return true;
+    return ok;
 }
 
 bool copy_entry(int id)
@@ -417,7 +493,7 @@ bool copy_entry(int id)
     return true;
 }
 
-bool remove_entry(int id, int auto_encrypt)
+bool remove_entry(int id)
 {
     if(!has_active_database())
     {
@@ -437,13 +513,53 @@ bool remove_entry(int id, int auto_encrypt)
         return true;
     }
 
-    if(auto_encrypt == 1)
-        auto_enc();
-
     return false;
 }
 
-void list_by_id(int id, int show_password, int auto_encrypt, int as_qrcode)
+/* Prints only the raw value of field of the entry found with name, which
+ * is an exact title or an url of the site. Made for scripts, so nothing
+ * else goes to stdout and more than one match is an error.
+ */
+bool get_field(const char *name, const char *field)
+{
+    Lookup_t lookup;
+
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return false;
+    }
+
+    if(!db_lookup_field(name, field, &lookup))
+        return false;
+
+    if(lookup.matches == 0)
+    {
+        fprintf(stderr, "Nothing found with %s.\n", name);
+        return false;
+    }
+
+    if(lookup.matches > 1)
+    {
+        fprintf(stderr, "%d entries match %s, ids", lookup.matches, name);
+
+        for(int i = 0; i < lookup.matches && i < LOOKUP_MAX_IDS; i++)
+            fprintf(stderr, "%s %d", i > 0 ? "," : "", lookup.ids[i]);
+
+        fprintf(stderr, "%s. Use --list-entry with an id.\n",
+                lookup.matches > LOOKUP_MAX_IDS ? ", ..." : "");
+        return false;
+    }
+
+    fputs(lookup.value, stdout);
+    fputc('\n', stdout);
+
+    secure_free(lookup.value);
+
+    return true;
+}
+
+void list_by_id(int id, int show_password, int as_qrcode, int format)
 {
     if(!has_active_database())
     {
@@ -458,23 +574,25 @@ void list_by_id(int id, int show_password, int auto_encrypt, int as_qrcode)
 
     if(entry->id == -1)
     {
-        printf("Nothing found with id %d.\n", id);
+        /* Keep machine readable output clean */
+        fprintf(format == OUTPUT_HUMAN ? stdout : stderr,
+                "Nothing found with id %d.\n", id);
         entry_free(entry);
         return;
     }
 
-    print_entry(entry, show_password, as_qrcode);
-    entry_free(entry);
+    Render_t *render = render_new(stdout, format, show_password, as_qrcode);
 
-    if(auto_encrypt == 1)
-        auto_enc();
+    render_entry(render, entry);
+    render_free(render);
+    entry_free(entry);
 }
 
 /* Loop through all entries in the database and output them to stdout.
  * Latest count points out how many latest items we may want to show.
  * If latest_count if -1, display all items.
  */
-void list_all(int show_password, int auto_encrypt, int latest_count)
+void list_all(int show_password, int latest_count, int format)
 {
     if(!has_active_database())
     {
@@ -482,34 +600,44 @@ void list_all(int show_password, int auto_encrypt, int latest_count)
         return;
     }
 
-    Entry_t *entry = db_get_list(latest_count);
+    Render_t *render = render_new(stdout, format, show_password, 0);
+    db_stream_list(latest_count, cb_render, render);
+    render_free(render);
+}
 
-    if(!entry)
+/* Uses sqlite "like" query and prints results to stdout.
+ * This is ok for the command line version of Ylva. However
+ * better design is needed _if_ GUI version will be developed.
+ */
+void find(const char *search, int show_password, int format)
+{
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
         return;
+    }
 
-    /* Because of how sqlite callbacks work, we need to initialize
-     * the list with dummy data.
-     * Skip the dummy data to the next entry in the list
-     */
-    Entry_t *head = entry->next;
+    Render_t *render = render_new(stdout, format, show_password, 0);
+    db_stream_find(search, cb_render, render);
+    render_free(render);
+}
 
-    while(head != NULL)
+void find_regex(const char *regex, int show_password, int ignore_case, int format)
+{
+    if(!has_active_database())
     {
-        print_entry(head, show_password, 0);
-        head = head->next;
+        fprintf(stderr, "No decrypted database found.\n");
+        return;
     }
 
-    if(auto_encrypt == 1)
-        auto_enc();
+    Render_t *render = render_new(stdout, format, show_password, 0);
 
-    entry_free(entry);
+    db_stream_regex(regex, ignore_case == 1, cb_render, render);
+    render_free(render);
 }
 
-/* Uses sqlite "like" query and prints results to stdout.
- * This is ok for the command line version of Ylva. However
- * better design is needed _if_ GUI version will be developed.
- */
-void find(const char *search, int show_password, int auto_encrypt)
+/* Search with field scoped query, see query.c for the syntax */
+void find_query(const char *text, int show_password, int format)
 {
     if(!has_active_database())
     {
@@ -517,32 +645,160 @@ void find(const char *search, int show_password, int auto_encrypt)
         return;
     }
 
-    Entry_t *list = db_find(search);
+    Query_t *query = query_compile(text);
 
-    if(!list)
+    if(!query)
         return;
 
-    Entry_t *head = list->next;
+    Render_t *render = render_new(stdout, format, show_password, 0);
+
+    db_stream_query(query, cb_render, render);
+    render_free(render);
+    query_free(query);
+}
+
+/* Writes QR codes of all entries or the ones matching query to dir.
+ * format, ecc and fields are given as names, see qrexport.c.
+ */
+bool export_qr(const char *dir, const char *text, const char *format,
+               const char *ecc, const char *fields)
+{
+    QrExport_t options;
+    Entry_t *list = NULL;
+
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return false;
+    }
+
+    options.dir = dir;
+    options.format = qr_export_parse_format(format);
+    options.ecc = qr_export_parse_ecc(ecc);
+    options.fields = qr_parse_fields(fields);
+
+    if(options.format == -1)
+    {
+        fprintf(stderr, "Unknown QR file format %s.\n", format);
+        return false;
+    }
 
-    while(head != NULL)
+    if(options.ecc == -1)
     {
-        print_entry(head, show_password, 0);
-        head = head->next;
+        fprintf(stderr, "Unknown QR error correction level %s.\n", ecc);
+        return false;
     }
 
-    if(auto_encrypt == 1)
-        auto_enc();
+    if(options.fields == -1)
+    {
+        fprintf(stderr, "Invalid QR fields %s.\n", fields);
+        return false;
+    }
+
+    if(text)
+    {
+        Query_t *query = query_compile(text);
+
+        if(!query)
+            return false;
+
+        list = db_find_query(query);
+        query_free(query);
+    }
+    else
+    {
+        list = db_get_list(-1);
+    }
+
+    if(!list)
+        return false;
+
+    size_t count = 0;
 
+    for(Entry_t *head = list->next; head != NULL; head = head->next)
+        count++;
+
+    Entry_t **entries = tmalloc((count + 1) * sizeof(Entry_t *));
+
+    count = 0;
+
+    for(Entry_t *head = list->next; head != NULL; head = head->next)
+        entries[count++] = head;
+
+    bool ok = qr_export(entries, count, &options);
+
+    free(entries);
     entry_free(list);
+
+    return ok;
+}
+
+static int compare_entry_id(const void *a, const void *b)
+{
+    const Entry_t *x = *(Entry_t * const *)a;
+    const Entry_t *y = *(Entry_t * const *)b;
+
+    return (x->id > y->id) - (x->id < y->id);
 }
 
-void find_regex(const char *regex, int show_password)
+/* Loads searchable fields once and lets the user filter them
+ * interactively. Chosen entry is printed like with --list-entry.
+ */
+void pick_entry(int show_password, int as_qrcode)
 {
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return;
+    }
+
     Entry_t *list = db_get_list(-1);
-    Entry_t *head = list->next;
 
-    regex_find(head, regex, show_password);
+    if(!list)
+        return;
+
+    Scan_t *scan = db_get_scan();
 
+    if(!scan)
+    {
+        entry_free(list);
+        return;
+    }
+
+    size_t count = 0;
+
+    for(Entry_t *head = list->next; head != NULL; head = head->next)
+        count++;
+
+    Entry_t **by_id = tmalloc((count + 1) * sizeof(Entry_t *));
+    Entry_t **entries = tmalloc((scan->count + 1) * sizeof(Entry_t *));
+
+    count = 0;
+
+    for(Entry_t *head = list->next; head != NULL; head = head->next)
+        by_id[count++] = head;
+
+    qsort(by_id, count, sizeof(Entry_t *), compare_entry_id);
+
+    /* Map rows of the scan to their entries */
+    for(size_t i = 0; i < scan->count; i++)
+    {
+        Entry_t key = { .id = scan->ids[i] };
+        Entry_t *keyptr = &key;
+        Entry_t **found = bsearch(&keyptr, by_id, count, sizeof(Entry_t *),
+                                  compare_entry_id);
+
+        entries[i] = found ? *found : NULL;
+    }
+
+    int chosen = pick_run(scan, entries);
+
+    if(chosen >= 0 && entries[chosen] != NULL)
+        print_entry(entries[chosen], show_password, as_qrcode);
+
+    free(entries);
+    free(by_id);
+    scan_free(scan);
     entry_free(list);
 }
 
@@ -565,13 +821,21 @@ void show_current_db_path()
 
 void set_use_db(const char *path)
 {
+    int lock = vault_lock(VAULT_EXCLUSIVE);
+
+    if(lock == -1)
+        return;
+
     if(has_active_database())
     {
         fprintf(stdout,
             "Type password to encrypt existing active database.\n");
 
         if(!encrypt_database())
+        {
+            vault_unlock(lock);
             return;
+        }
     }
 
     if(is_file_encrypted(path))
@@ -579,13 +843,273 @@ void set_use_db(const char *path)
         fprintf(stdout, "Decrypt %s.\n", path);
 
         if(!decrypt_database(path))
+        {
+            vault_unlock(lock);
             return;
+        }
     }
 
     write_active_database_path(path);
+    vault_unlock(lock);
+}
+
+/* Writes an encrypted backup of the active database to path */
+bool backup_database(const char *path)
+{
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return false;
+    }
+
+    char *pass = read_password("Backup password: ", true);
+
+    if(!pass)
+        return false;
+
+    bool ok = backup_export(path, pass);
+
+    secure_free(pass);
+
+    return ok;
+}
+
+/* Restores entries from backup in path to the active database. If
+ * query is not NULL, only the matching entries are restored.
+ */
+bool restore_database(const char *path, const char *query)
+{
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return false;
+    }
+
+    char *pass = read_password("Backup password: ", false);
+    bool ok = backup_restore(path, pass, query);
+
+    secure_free(pass);
+
+    return ok;
+}
+
+/* Writes the changes since the previous snapshot in dir as the next
+ * snapshot. The password is confirmed only when a new chain is started.
+ */
+bool snapshot_database(const char *dir)
+{
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return false;
+    }
+
+    char *pass = read_password("Snapshot password: ", !snapshot_exists(dir));
+
+    if(!pass)
+        return false;
+
+    bool ok = snapshot_write(dir, pass);
+
+    secure_free(pass);
+
+    return ok;
+}
+
+/* Parses local time "YYYY-MM-DD HH:MM:SS", "YYYY-MM-DD HH:MM" or
+ * "YYYY-MM-DD", which means the end of the day. Returns -1 on error.
+ */
+static long long parse_time(const char *text)
+{
+    const char *formats[] = { "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%d" };
+
+    for(int i = 0; i < 3; i++)
+    {
+        struct tm tm;
+
+        memset(&tm, 0, sizeof(tm));
+
+        char *end = strptime(text, formats[i], &tm);
+
+        if(!end || *end != '\0')
+            continue;
+
+        if(i == 2)
+        {
+            tm.tm_hour = 23;
+            tm.tm_min = 59;
+            tm.tm_sec = 59;
+        }
+
+        tm.tm_isdst = -1;
+
+        return mktime(&tm);
+    }
+
+    return -1;
+}
+
+/* Makes the active database what it was at the newest snapshot in dir
+ * taken at or before at_text, or at the newest snapshot if at_text is
+ * NULL.
+ */
+bool restore_snapshot(const char *dir, const char *at_text)
+{
+    long long at = -1;
+
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return false;
+    }
+
+    if(at_text && (at = parse_time(at_text)) == -1)
+    {
+        fprintf(stderr, "Invalid time %s. Use YYYY-MM-DD [HH:MM[:SS]].\n", at_text);
+        return false;
+    }
+
+    char *pass = read_password("Snapshot password: ", false);
+    bool ok = snapshot_restore(dir, pass, at);
+
+    secure_free(pass);
+
+    return ok;
+}
+
+/* Merges the active database and the encrypted vault in path */
+bool sync_database(const char *path)
+{
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return false;
+    }
+
+    fprintf(stdout, "Password of %s.\n", path);
+
+    char *pass = read_password("Password: ", false);
+    bool ok = sync_vault(path, pass);
+
+    secure_free(pass);
+
+    return ok;
+}
+
+/* Switches to profile name. Profiles have their own active database,
+ * so nothing is encrypted or decrypted.
+ */
+bool use_profile(const char *name)
+{
+    if(!set_profile(name))
+    {
+        fprintf(stderr, "Invalid profile name %s. Use letters, digits, - and _.\n", name);
+        return false;
+    }
+
+    vault_close();
+
+    return true;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Lists profiles that have an active database, current one marked with * */
+void list_profiles()
+{
+    const char *prefix = ".ylva.open_db";
+    size_t prefix_len = strlen(prefix);
+    char *home = getenv("HOME");
+    char **names = NULL;
+    int count = 0;
+    struct dirent *ent;
+    DIR *dir;
+
+    if(!home || !(dir = opendir(home)))
+    {
+        fprintf(stderr, "Unable to read home directory.\n");
+        return;
+    }
+
+    while((ent = readdir(dir)) != NULL)
+    {
+        const char *suffix = ent->d_name + prefix_len;
+
+        if(strncmp(ent->d_name, prefix, prefix_len) != 0 ||
+           (suffix[0] != '\0' && suffix[0] != '.'))
+            continue;
+
+        names = trealloc(names, (count + 1) * sizeof(char *));
+        names[count++] = strdup(suffix[0] ? suffix + 1 : "default");
+    }
+
+    closedir(dir);
+    qsort(names, count, sizeof(char *), compare_names);
+
+    char *current = strdup(get_profile());
+
+    for(int i = 0; i < count; i++)
+    {
+        set_profile(names[i]);
+
+        char *holder = get_open_db_path_holder_filepath();
+        char *path = holder ? read_database_path_from(holder) : NULL;
+
+        if(path)
+            printf("%c %-16s %s\n", strcmp(names[i], current) == 0 ? '*' : ' ',
+                   names[i], path);
+
+        free(path);
+        free(holder);
+        free(names[i]);
+    }
+
+    set_profile(current);
+    free(current);
+    free(names);
+}
+
+typedef struct _history
+{
+    Render_t *render;
+    int count;
+
+} History_t;
+
+static bool cb_history(Entry_t *entry, void *data)
+{
+    History_t *history = data;
+
+    history->count++;
+    render_entry(history->render, entry);
+
+    return true;
+}
+
+/* Shows earlier values of the entry, newest change first */
+void show_history(int id, int show_password, int format)
+{
+    History_t history = { NULL, 0 };
+
+    if(!has_active_database())
+    {
+        fprintf(stderr, "No decrypted database found.\n");
+        return;
+    }
+
+    history.render = render_new(stdout, format, show_password, 0);
+
+    if(db_stream_history(id, cb_history, &history) && history.count == 0 &&
+       format == OUTPUT_HUMAN)
+        printf("No history for entry %d.\n", id);
+
+    render_free(history.render);
 }
 
-void show_latest_entries(int show_password, int auto_encrypt, int count)
+void show_latest_entries(int show_password, int count, int format)
 {
-    list_all(show_password, auto_encrypt, count);
+    list_all(show_password, count, format);
 }
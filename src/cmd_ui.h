@@ -5,21 +5,37 @@
 #ifndef __CMD_UI_H
 #define __CMD_UI_H
 
-void init_database(const char *path, int force, int auto_encrypt);
-bool add_new_entry(int auto_encrypt);
-bool edit_entry(int id, int auto_encrypt);
-bool remove_entry(int id, int auto_encrypt);
+void init_database(const char *path, int force);
+bool add_new_entry();
+bool edit_entry(int id);
+bool remove_entry(int id);
 bool copy_entry(int id);
-void list_by_id(int id, int show_password, int auto_encrypt, int as_qrcode);
-void list_all(int show_password, int auto_encrypt, int latest_count);
-void find(const char *search, int show_password, int auto_encrypt);
-void find_regex(const char *regex, int show_password);
+void list_by_id(int id, int show_password, int as_qrcode, int format);
+bool get_field(const char *name, const char *field);
+void list_all(int show_password, int latest_count, int format);
+void find(const char *search, int show_password, int format);
+void find_regex(const char *regex, int show_password, int ignore_case, int format);
+void find_query(const char *text, int show_password, int format);
+void pick_entry(int show_password, int as_qrcode);
+bool export_qr(const char *dir, const char *text, const char *format,
+               const char *ecc, const char *fields);
 void show_current_db_path();
 void set_use_db(const char *path);
+bool use_profile(const char *name);
+bool backup_database(const char *path);
+bool restore_database(const char *path, const char *query);
+bool snapshot_database(const char *dir);
+bool restore_snapshot(const char *dir, const char *at_text);
+bool sync_database(const char *path);
+void list_profiles();
 
-void show_latest_entries(int show_password, int auto_encrypt, int count);
+void show_latest_entries(int show_password, int count, int format);
+void show_history(int id, int show_password, int format);
 
+char *read_password(const char *prompt, bool confirm);
 bool decrypt_database(const char *path);
+bool decrypt_database_with(const char *path, const char *pass);
 bool encrypt_database();
+bool encrypt_database_with(const char *pass);
 
 #endif
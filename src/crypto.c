@@ -8,10 +8,15 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <openssl/evp.h>
+#include <openssl/crypto.h>
 #include <openssl/hmac.h>
 #include "crypto.h"
 #include "utils.h"
+#include "securemem.h"
 
 //Our magic number that's written into the
 //encrypted file. Used to determine if the file
@@ -45,15 +50,13 @@ static char *generate_random_data(int size)
 }
 
 //Generate key from passphrase. If oldsalt is NULL, new salt is created.
-//ok is set to true on success, false on failure
-static Key_t generate_key(const char *passphrase, char *old_salt,
-                          bool *ok)
+//The key is in secure memory, free it with secure_free.
+//Returns NULL on failure.
+Key_t *generate_key(const char *passphrase, const char *old_salt)
 {
     char *salt = NULL;
     int iterations = 200000;
-    Key_t key = { {0} };
     int success;
-    char *resultbytes[KEY_SIZE];
 
     if(old_salt == NULL)
         salt = generate_random_data(SALT_SIZE);
@@ -64,27 +67,24 @@ static Key_t generate_key(const char *passphrase, char *old_salt,
     }
 
     if(!salt)
-    {
-        *ok = false;
-        return key;
-    }
+        return NULL;
 
+    Key_t *key = secure_alloc(sizeof(Key_t));
+
+    //Derived straight to secure memory, no copies of the key elsewhere
     success = PKCS5_PBKDF2_HMAC(passphrase, strlen(passphrase), (unsigned char*)salt,
                                 SALT_SIZE, iterations, EVP_sha256(),
-                                KEY_SIZE, (unsigned char*)resultbytes);
+                                KEY_SIZE, (unsigned char*)key->data);
 
     if(success == 0)
     {
         free(salt);
-        *ok = false;
-        return key;
+        secure_free(key);
+        return NULL;
     }
 
-    memmove(key.data, resultbytes, KEY_SIZE);
-    memmove(key.salt, salt, SALT_SIZE);
-
+    memmove(key->salt, salt, SALT_SIZE);
     free(salt);
-    *ok = true;
 
     return key;
 }
@@ -264,7 +264,6 @@ bool is_file_encrypted(const char *path)
 
 bool encrypt_file(const char *passphrase, const char *path)
 {
-    bool ok;
     char *iv = NULL;
     FILE *plain = NULL;
     FILE *cipher_fp = NULL;
@@ -277,9 +276,9 @@ bool encrypt_file(const char *passphrase, const char *path)
         return false;
     }
 
-    Key_t key = generate_key(passphrase, NULL, &ok);
+    Key_t *key = generate_key(passphrase, NULL);
 
-    if(!ok)
+    if(!key)
     {
         fprintf(stderr, "Key derivation failed.\n");
         return false;
@@ -290,6 +289,7 @@ bool encrypt_file(const char *passphrase, const char *path)
     if(!iv)
     {
         fprintf(stderr, "Initialization vector generation failed.\n");
+        secure_free(key);
         return false;
     }
 
@@ -299,6 +299,7 @@ bool encrypt_file(const char *passphrase, const char *path)
     {
         fprintf(stderr, "Unable to open %s\n", path);
         free(iv);
+        secure_free(key);
         return false;
     }
 
@@ -318,6 +319,7 @@ bool encrypt_file(const char *passphrase, const char *path)
         fprintf(stderr, "Unable to create output filename.\n");
         free(iv);
         free(plain_data);
+        secure_free(key);
         return false;
     }
 
@@ -329,18 +331,19 @@ bool encrypt_file(const char *passphrase, const char *path)
         free(iv);
         free(output_filename);
         free(plain_data);
+        secure_free(key);
         return false;
     }
 
     //perform the actual encryption
     encrypt_decrypt((unsigned char*)plain_data, plain_len, cipher_fp,
-                    (unsigned char *)key.data, (unsigned char *)iv,
+                    (unsigned char *)key->data, (unsigned char *)iv,
                     YLVA_MODE_ENCRYPT);
 
     //write iv etc. into the end of the file
     fwrite((void*)&MAGIC_HEADER, sizeof(MAGIC_HEADER), 1, cipher_fp);
     fwrite(iv, 1, IV_SIZE, cipher_fp);
-    fwrite(key.salt, 1, SALT_SIZE, cipher_fp);
+    fwrite(key->salt, 1, SALT_SIZE, cipher_fp);
 
     //Close the file pointer, to sync the data, before reading it again
     //for the hmac calculation
@@ -349,13 +352,14 @@ bool encrypt_file(const char *passphrase, const char *path)
     //Open the file again for reading and writing
     cipher_fp = fopen(output_filename, "r+");
 
-    if(!calculate_and_write_hmac(cipher_fp, key.data))
+    if(!calculate_and_write_hmac(cipher_fp, key->data))
     {
         free(iv);
         free(output_filename);
         free(plain_data);
         fclose(cipher_fp);
 
+        secure_free(key);
         return false;
     }
 
@@ -369,13 +373,13 @@ bool encrypt_file(const char *passphrase, const char *path)
     free(plain_data);
     free(iv);
     fclose(cipher_fp);
+    secure_free(key);
 
     return true;
 }
 
 bool decrypt_file(const char *passphrase, const char *path)
 {
-    bool ok;
     char *iv = NULL;
     char *salt = NULL;
     FILE *plain = NULL;
@@ -419,9 +423,9 @@ bool decrypt_file(const char *passphrase, const char *path)
     fread(salt, SALT_SIZE, 1, cipher);
     fread(hmac, HMAC_SHA512_SIZE, 1, cipher);
 
-    Key_t key = generate_key(passphrase, salt, &ok);
+    Key_t *key = generate_key(passphrase, salt);
 
-    if(!ok)
+    if(!key)
     {
         fprintf(stderr, "Key derivation failed.\n");
         free(iv);
@@ -433,13 +437,14 @@ bool decrypt_file(const char *passphrase, const char *path)
 
     fclose(cipher);
 
-    if(!read_and_verify_hmac(path, hmac, key.data))
+    if(!read_and_verify_hmac(path, hmac, key->data))
     {
         fprintf(stderr, "Invalid password or tampered data. Aborted.\n");
         free(iv);
         free(salt);
         free(hmac);
 
+        secure_free(key);
         return false;
     }
 
@@ -460,6 +465,7 @@ bool decrypt_file(const char *passphrase, const char *path)
         free(cipher_data);
         free(hmac);
 
+        secure_free(key);
         return false;
     }
 
@@ -474,11 +480,12 @@ bool decrypt_file(const char *passphrase, const char *path)
         free(cipher_data);
         free(hmac);
 
+        secure_free(key);
         return false;
     }
 
     encrypt_decrypt((unsigned char*)cipher_data, offset, plain,
-                    (unsigned char *)key.data, (unsigned char *)iv,
+                    (unsigned char *)key->data, (unsigned char *)iv,
                     YLVA_MODE_DECRYPT);
 
     //Finally remove the cipher file
@@ -498,6 +505,164 @@ bool decrypt_file(const char *passphrase, const char *path)
     fclose(plain);
     free(cipher_data);
     free(hmac);
+    secure_free(key);
 
     return true;
 }
+
+//Reads encrypted file path to memory and decrypts it. key is set to the
+//key of the file, so the data can be written back with write_encrypted
+//without deriving the key again. Returns NULL on failure. Caller must
+//free the return value, and the key with secure_free.
+unsigned char *read_encrypted(const char *passphrase, const char *path,
+                              Key_t **key, size_t *len)
+{
+    unsigned char *data = NULL;
+    unsigned char *plain = NULL;
+    FILE *fp = NULL;
+
+    if(!is_file_encrypted(path))
+    {
+        fprintf(stderr, "%s is not an encrypted database.\n", path);
+        return NULL;
+    }
+
+    fp = fopen(path, "r");
+
+    if(!fp)
+    {
+        fprintf(stderr, "Unable to open %s for reading.\n", path);
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long file_len = ftell(fp);
+    long trailer = sizeof(MAGIC_HEADER) + IV_SIZE + SALT_SIZE + HMAC_SHA512_SIZE;
+    rewind(fp);
+
+    data = tmalloc(file_len);
+
+    if(fread(data, 1, file_len, fp) != (size_t)file_len)
+    {
+        fprintf(stderr, "Unable to read %s.\n", path);
+        fclose(fp);
+        free(data);
+        return NULL;
+    }
+
+    fclose(fp);
+
+    size_t cipher_len = file_len - trailer;
+    unsigned char *iv = data + cipher_len + sizeof(MAGIC_HEADER);
+    unsigned char *salt = iv + IV_SIZE;
+    unsigned char *hmac = salt + SALT_SIZE;
+    unsigned char new_hmac[HMAC_SHA512_SIZE];
+    int hmac_len = 0;
+
+    *key = generate_key(passphrase, (char *)salt);
+
+    if(!*key)
+    {
+        fprintf(stderr, "Key derivation failed.\n");
+        free(data);
+        return NULL;
+    }
+
+    hmac_data((*key)->data, KEY_SIZE, data, file_len - HMAC_SHA512_SIZE, new_hmac, &hmac_len);
+
+    if(CRYPTO_memcmp(hmac, new_hmac, HMAC_SHA512_SIZE) != 0)
+    {
+        fprintf(stderr, "Invalid password or tampered data. Aborted.\n");
+        free(data);
+        secure_free(*key);
+        return NULL;
+    }
+
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int out_len = 0;
+
+    plain = tmalloc(cipher_len + 1);
+
+    bool ok = ctx && EVP_CipherInit(ctx, EVP_aes_256_ctr(), (unsigned char *)(*key)->data,
+                                    iv, YLVA_MODE_DECRYPT) == 1 &&
+         EVP_CipherUpdate(ctx, plain, &out_len, data, cipher_len) == 1;
+
+    EVP_CIPHER_CTX_free(ctx);
+    free(data);
+
+    if(!ok)
+    {
+        fprintf(stderr, "Unable to decrypt %s.\n", path);
+        free(plain);
+        secure_free(*key);
+        return NULL;
+    }
+
+    *len = cipher_len;
+
+    return plain;
+}
+
+//Encrypts data with key and a new iv and writes it to path in the format
+//encrypt_file uses. The file is written next to path and renamed over
+//it when complete, so a failure never leaves a damaged vault behind.
+bool write_encrypted(const Key_t *key, const unsigned char *data, size_t len,
+                     const char *path)
+{
+    unsigned char hmac[HMAC_SHA512_SIZE];
+    int hmac_len = 0;
+    int out_len = 0;
+    bool ok;
+
+    char *iv = generate_random_data(IV_SIZE);
+
+    if(!iv)
+    {
+        fprintf(stderr, "Initialization vector generation failed.\n");
+        return false;
+    }
+
+    size_t total = len + sizeof(MAGIC_HEADER) + IV_SIZE + SALT_SIZE;
+    unsigned char *out = tmalloc(total + HMAC_SHA512_SIZE);
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+
+    ok = ctx && EVP_CipherInit(ctx, EVP_aes_256_ctr(), (unsigned char *)key->data,
+                               (unsigned char *)iv, YLVA_MODE_ENCRYPT) == 1 &&
+         EVP_CipherUpdate(ctx, out, &out_len, data, len) == 1;
+
+    EVP_CIPHER_CTX_free(ctx);
+
+    memcpy(out + len, &MAGIC_HEADER, sizeof(MAGIC_HEADER));
+    memcpy(out + len + sizeof(MAGIC_HEADER), iv, IV_SIZE);
+    memcpy(out + len + sizeof(MAGIC_HEADER) + IV_SIZE, key->salt, SALT_SIZE);
+    hmac_data(key->data, KEY_SIZE, out, total, hmac, &hmac_len);
+    memcpy(out + total, hmac, HMAC_SHA512_SIZE);
+    free(iv);
+
+    char *tmp_path = get_output_filename(path, ".tmp");
+    int fd = ok ? open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR) : -1;
+
+    if(fd == -1)
+    {
+        fprintf(stderr, "Unable to write %s.\n", tmp_path);
+        free(tmp_path);
+        free(out);
+        return false;
+    }
+
+    ok = write(fd, out, total + HMAC_SHA512_SIZE) == (ssize_t)(total + HMAC_SHA512_SIZE) &&
+         fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+
+    if(!ok || rename(tmp_path, path) != 0)
+    {
+        fprintf(stderr, "Unable to write %s.\n", path);
+        unlink(tmp_path);
+        ok = false;
+    }
+
+    free(tmp_path);
+    free(out);
+
+    return ok;
+}
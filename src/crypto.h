@@ -5,6 +5,9 @@
 #ifndef __CRYPTO_H
 #define __CRYPTO_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #define KEY_SIZE (32)  //256 bits
 #define IV_SIZE (16)   //128 bits
 #define SALT_SIZE (64) //512 bits
@@ -20,8 +23,13 @@ typedef struct Key
 
 } Key_t;
 
+Key_t *generate_key(const char *passphrase, const char *old_salt);
 bool encrypt_file(const char *passphrase, const char *path);
 bool decrypt_file(const char *passphrase, const char *path);
 bool is_file_encrypted(const char *path);
+unsigned char *read_encrypted(const char *passphrase, const char *path,
+                              Key_t **key, size_t *len);
+bool write_encrypted(const Key_t *key, const unsigned char *data, size_t len,
+                     const char *path);
 
 #endif
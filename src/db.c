@@ -8,16 +8,64 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdint.h>
 #include <sqlite3.h>
+#include <zlib.h>
+#include <openssl/evp.h>
 #include "entry.h"
 #include "db.h"
 #include "utils.h"
+#include "fold.h"
+#include "regexfind.h"
+#include "scan.h"
+#include "query.h"
+#include "lock.h"
+#include "securemem.h"
+
+/* Columns of the entries table in the order callbacks expect them */
+#define ENTRY_COLUMNS "id,title,user,url,password,notes,timestamp"
+
+/* Fields of an entry in history records, in this order */
+#define HISTORY_FIELDS 5
+
+/* Number of history records kept per entry unless YLVA_HISTORY_SIZE
+ * says otherwise. 0 turns history off.
+ */
+#define HISTORY_DEFAULT_SIZE 10
+
+/* History records at least this large are compressed */
+#define HISTORY_COMPRESS_MIN 128
+
+/* Growing buffer for building history records. It holds old passwords,
+ * so it lives in secure memory and is freed with secure_free.
+ */
+typedef struct _blob
+{
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+
+} Blob_t;
 
 /* sqlite callbacks */
 static int cb_check_integrity(void *notused, int argc, char **argv, char **column_name);
+static int cb_user_version(void *version, int argc, char **argv, char **column_name);
 static int cb_get_by_id(void *entry, int argc, char **argv, char **column_name);
-static int cb_list_all(void *entry, int argc, char **argv, char **column_name);
-static int cb_find(void *entry, int argc, char **argv, char **column_name);
+
+/* Connection shared by everything between db_session_open and
+ * db_session_close, and the statements prepared for it.
+ */
+#define STMT_CACHE_SIZE 16
+
+static sqlite3 *session_db = NULL;
+static int session_refs = 0;
+static sqlite3_stmt *stmt_cache[STMT_CACHE_SIZE];
+static int stmt_cache_next = 0;
+
+/* See db_unit_begin */
+static bool unit_of_work = false;
+static bool unit_open = false;
+static bool unit_write = false;     /* Transaction holds the write lock */
 
 /*Run integrity check for the database to detect
  *malformed and corrupted databases. Returns true
@@ -38,6 +86,8 @@ static bool db_check_integrity(const char *path)
         return false;
     }
 
+    sqlite3_busy_handler(db, lock_busy_handler, NULL);
+
     sql = "pragma integrity_check;";
 
     retval = sqlite3_exec(db, sql, cb_check_integrity, 0, &err);
@@ -55,175 +105,319 @@ static bool db_check_integrity(const char *path)
     return true;
 }
 
-bool db_init_new(const char *path)
+/* Schema migrations. Index of the migration is the schema version it
+ * upgrades from, pragma user_version holds the current version.
+ * Only append to the end of this list.
+ */
+static const char *migrations[] =
 {
-    sqlite3 *db;
-    char *err = NULL;
+    /* 0 -> 1: Case and accent folded shadow columns for searching. The
+     * indexes serve exact and prefix terms of --query, see query.c.
+     * --find looks for substrings and always scans the columns.
+     */
+    "alter table entries add column title_fold text;"
+    "alter table entries add column user_fold text;"
+    "alter table entries add column url_fold text;"
+    "alter table entries add column notes_fold text;"
+    "update entries set title_fold=ylva_fold(title),user_fold=ylva_fold(user),"
+    "url_fold=ylva_fold(url),notes_fold=ylva_fold(notes);"
+    "create index entries_title_fold on entries(title_fold);"
+    "create index entries_user_fold on entries(user_fold);"
+    "create index entries_url_fold on entries(url_fold);",
+
+    /* 1 -> 2: Queries can filter by modification time */
+    "create index entries_timestamp on entries(timestamp);",
+
+    /* 2 -> 3: Previous values of changed fields, see db_save_history */
+    "create table history(id integer primary key, entry_id integer not null,"
+    "changed text not null, fields integer not null, size integer not null,"
+    "data blob not null);"
+    "create index history_entry on history(entry_id, id);",
+
+    /* 3 -> 4: Exact lookups by title or site, see db_lookup_field */
+    "alter table entries add column url_key text;"
+    "update entries set url_key=ylva_url_key(url);"
+    "create index entries_title on entries(title);"
+    "create index entries_url_key on entries(url_key);",
+
+    /* 4 -> 5: Log of changed entries for incremental snapshots. Nothing
+     * is logged until the first snapshot, see db_snapshot_done.
+     */
+    "create table changes(seq integer primary key autoincrement,"
+    "entry_id integer not null);"
+    "create table snapshots(chain text primary key, seq integer not null);"
+    "create trigger entries_log_insert after insert on entries "
+    "when exists(select 1 from snapshots) begin "
+    "insert into changes(entry_id) values(new.id); end;"
+    "create trigger entries_log_update after update on entries "
+    "when exists(select 1 from snapshots) begin "
+    "insert into changes(entry_id) values(new.id); end;"
+    "create trigger entries_log_delete after delete on entries "
+    "when exists(select 1 from snapshots) begin "
+    "insert into changes(entry_id) values(old.id); end;",
+
+    /* 5 -> 6: Stable ids and a hash tree for --sync, see sync.c. Node
+     * of the tree is the xor of ylva_hash of the entries whose uuid
+     * starts with the prefix of the node. Existing entries get uuids
+     * from their id, title and time, so copies of one vault upgraded
+     * separately still agree on them. --sync compares modified_utc,
+     * timestamp stays in local time for showing, and existing times are
+     * taken to be in the local time of this host. The log trigger is
+     * left out of filling the new columns, so the next snapshot does not
+     * hold every entry.
+     */
+    "alter table entries add column uuid text;"
+    "alter table entries add column modified_utc text;"
+    "create table sync_tree(prefix text primary key, hash integer not null) without rowid;"
+    "create table sync_levels(n integer primary key);"
+    "insert into sync_levels values(0),(1),(2),(3);"
+    "create table tombstones(uuid text primary key, deleted text not null) without rowid;"
+    "create table sync_peers(peer text primary key, synced text not null);"
+    "create trigger entries_uuid after insert on entries when new.uuid is null begin "
+    "update entries set uuid=lower(hex(randomblob(16))) where id=new.id; end;"
+    "create trigger entries_tree_insert after insert on entries "
+    "when new.uuid is not null begin "
+    "delete from tombstones where uuid=new.uuid;"
+    "insert into sync_tree(prefix, hash) select substr(new.uuid, 1, n),"
+    "ylva_hash(new.uuid, new.title, new.user, new.url, new.password, new.notes,"
+    "new.timestamp) from sync_levels where true "
+    "on conflict(prefix) do update set hash=ylva_xor(hash, excluded.hash); end;"
+    "create trigger entries_tree_update after update of uuid, title, user, url,"
+    "password, notes, timestamp on entries begin "
+    "insert into sync_tree(prefix, hash) select substr(old.uuid, 1, n),"
+    "ylva_hash(old.uuid, old.title, old.user, old.url, old.password, old.notes,"
+    "old.timestamp) from sync_levels where old.uuid is not null "
+    "on conflict(prefix) do update set hash=ylva_xor(hash, excluded.hash);"
+    "insert into sync_tree(prefix, hash) select substr(new.uuid, 1, n),"
+    "ylva_hash(new.uuid, new.title, new.user, new.url, new.password, new.notes,"
+    "new.timestamp) from sync_levels where new.uuid is not null "
+    "on conflict(prefix) do update set hash=ylva_xor(hash, excluded.hash); end;"
+    "create trigger entries_tree_delete after delete on entries "
+    "when old.uuid is not null begin "
+    "insert into sync_tree(prefix, hash) select substr(old.uuid, 1, n),"
+    "ylva_hash(old.uuid, old.title, old.user, old.url, old.password, old.notes,"
+    "old.timestamp) from sync_levels where true "
+    "on conflict(prefix) do update set hash=ylva_xor(hash, excluded.hash);"
+    "insert or replace into tombstones values(old.uuid, datetime('now')); end;"
+    "drop trigger entries_log_update;"
+    "update entries set uuid=printf('%016x%016x', ylva_hash('uuid', id, title, timestamp),"
+    "ylva_hash('uuid', timestamp, title, id)), modified_utc=datetime(timestamp, 'utc');"
+    "create trigger entries_log_update after update on entries "
+    "when exists(select 1 from snapshots) begin "
+    "insert into changes(entry_id) values(new.id); end;"
+    "create unique index entries_uuid on entries(uuid);"
+};
+
+/* NULL columns are treated as empty strings */
+static const char *column_text(sqlite3_stmt *stmt, int col)
+{
+    const char *text = (const char *)sqlite3_column_text(stmt, col);
 
-    int rc = sqlite3_open(path, &db);
+    return text ? text : "";
+}
 
-    if(rc != SQLITE_OK)
-    {
-        fprintf(stderr, "Failed to initialize database: %s\n", sqlite3_errmsg(db));
-        sqlite3_close(db);
+/* Implements sql function ylva_fold(text) */
+static void sql_fold(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    const char *text = (const char *)sqlite3_value_text(argv[0]);
 
-        return false;
+    if(!text)
+    {
+        sqlite3_result_null(ctx);
+        return;
     }
 
-    char *query = "create table entries"
-        "(id integer primary key, title text, user text, url text,"
-        "password text, notes text,"
-        "timestamp date default (datetime('now','localtime')));";
+    sqlite3_result_text(ctx, fold_text(text), -1, free);
+}
 
-    rc = sqlite3_exec(db, query, 0, 0, &err);
+/* Implements sql function ylva_url_key(url), see fold_url */
+static void sql_url_key(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    const char *url = (const char *)sqlite3_value_text(argv[0]);
+    char *key = url ? fold_url(url) : NULL;
 
-    if(rc != SQLITE_OK)
+    if(!key)
     {
-        fprintf(stderr, "Error: %s\n", err);
-        sqlite3_free(err);
-        sqlite3_close(db);
-
-        return false;
+        sqlite3_result_null(ctx);
+        return;
     }
 
-    sqlite3_close(db);
-    set_file_owner_rw(path);
-
-    return true;
+    sqlite3_result_text(ctx, key, -1, free);
 }
 
-bool db_insert_entry(Entry_t *entry)
+/* Implements sql function ylva_hash(value, ...). Returns 64 bits of
+ * SHA-256 over the values, NULL and empty text hash differently.
+ */
+static void sql_hash(sqlite3_context *ctx, int argc, sqlite3_value **argv)
 {
-    sqlite3 *db;
-    char *err = NULL;
-    char *path = NULL;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    EVP_MD_CTX *md = EVP_MD_CTX_new();
+    uint64_t hash = 0;
 
-    path = read_active_database_path();
+    EVP_DigestInit_ex(md, EVP_sha256(), NULL);
 
-    if(!path)
+    for(int i = 0; i < argc; i++)
     {
-        fprintf(stderr, "Error getting database path\n");
-        return false;
-    }
+        const unsigned char *text = sqlite3_value_text(argv[i]);
+        uint32_t len = text ? sqlite3_value_bytes(argv[i]) : UINT32_MAX;
+        unsigned char len_bytes[4] = { len, len >> 8, len >> 16, len >> 24 };
 
-    if(!db_check_integrity(path))
-    {
-        fprintf(stderr, "Corrupted database. Abort.\n");
-        free(path);
-        return 0;
+        EVP_DigestUpdate(md, len_bytes, 4);
+
+        if(text)
+            EVP_DigestUpdate(md, text, len);
     }
 
-    int rc = sqlite3_open(path, &db);
+    EVP_DigestFinal_ex(md, digest, NULL);
+    EVP_MD_CTX_free(md);
 
-    if(rc != SQLITE_OK)
-    {
-        fprintf(stderr, "Failed to initialize database: %s\n", sqlite3_errmsg(db));
-        sqlite3_close(db);
-        free(path);
+    for(int i = 0; i < 8; i++)
+        hash = (hash << 8) | digest[i];
 
-        return false;
-    }
+    sqlite3_result_int64(ctx, (sqlite3_int64)hash);
+}
 
-    char *query = sqlite3_mprintf("insert into entries(title, user, url, password, notes)"
-                                  "values('%q','%q','%q','%q','%q')",
-                                  entry->title, entry->user, entry->url, entry->password,
-                                  entry->notes);
+/* Implements sql function ylva_xor(a, b) */
+static void sql_xor(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    sqlite3_result_int64(ctx, sqlite3_value_int64(argv[0]) ^ sqlite3_value_int64(argv[1]));
+}
 
-    rc = sqlite3_exec(db, query, NULL, 0, &err);
+static bool db_upgrade_schema(sqlite3 *db)
+{
+    char *err = NULL;
+    int version = 0;
+    int count = sizeof(migrations) / sizeof(migrations[0]);
+    int rc;
+
+    rc = sqlite3_exec(db, "pragma user_version;", cb_user_version, &version, &err);
 
     if(rc != SQLITE_OK)
     {
         fprintf(stderr, "Error: %s\n", err);
         sqlite3_free(err);
-        sqlite3_free(query);
-        sqlite3_close(db);
-        free(path);
-
         return false;
     }
 
-    sqlite3_free(query);
-    sqlite3_close(db);
-    free(path);
+    while(version < count)
+    {
+        /* Another process may be upgrading at the same time, so the
+         * version is read again once we hold the write lock.
+         */
+        rc = sqlite3_exec(db, "begin immediate;", NULL, 0, &err);
+
+        if(rc == SQLITE_OK)
+            rc = sqlite3_exec(db, "pragma user_version;", cb_user_version, &version, &err);
+
+        if(rc == SQLITE_OK && version < count)
+        {
+            char *query = sqlite3_mprintf("%s pragma user_version=%d;",
+                                          migrations[version], version + 1);
+
+            rc = sqlite3_exec(db, query, NULL, 0, &err);
+            sqlite3_free(query);
+        }
+
+        if(rc == SQLITE_OK)
+            rc = sqlite3_exec(db, "commit;", NULL, 0, &err);
+
+        if(rc != SQLITE_OK)
+        {
+            fprintf(stderr, "Unable to upgrade database: %s\n", err);
+            sqlite3_free(err);
+            sqlite3_exec(db, "rollback;", NULL, 0, NULL);
+            return false;
+        }
+    }
 
     return true;
 }
 
-bool db_update_entry(int id, Entry_t *new_entry)
+/* Implements sql function ylva_contains(needle, text, ...). Returns 1 if
+ * any of the texts contains needle. Substring search can't use an index,
+ * and one vectorized scan per row is cheaper than a LIKE per column.
+ */
+static void sql_contains(sqlite3_context *ctx, int argc, sqlite3_value **argv)
 {
-    sqlite3 *db;
-    char *err = NULL;
-    char *path = NULL;
-
-    path = read_active_database_path();
+    const char *needle = (const char *)sqlite3_value_text(argv[0]);
+    int needle_len = sqlite3_value_bytes(argv[0]);
 
-    if(!path)
+    for(int i = 1; needle && i < argc; i++)
     {
-        fprintf(stderr, "Error getting database path\n");
-        return false;
+        const char *text = (const char *)sqlite3_value_text(argv[i]);
+
+        if(text && scan_memmem(text, sqlite3_value_bytes(argv[i]), needle, needle_len))
+        {
+            sqlite3_result_int(ctx, 1);
+            return;
+        }
     }
 
-    if(!db_check_integrity(path))
-    {
-        fprintf(stderr, "Corrupted database. Abort.\n");
-        free(path);
+    sqlite3_result_int(ctx, 0);
+}
 
-        return 0;
-    }
+/* Registers our sql functions for the connection and
+ * brings the schema up to date.
+ */
+static bool db_prepare(sqlite3 *db)
+{
+    sqlite3_busy_handler(db, lock_busy_handler, NULL);
 
-    int rc = sqlite3_open(path, &db);
+    /* With write-ahead logging readers don't block each other or the
+     * writer. The mode is stored in the file, so this costs nothing
+     * after the first time. If it can't be set the default journal works.
+     */
+    sqlite3_exec(db, "pragma journal_mode=wal;", NULL, 0, NULL);
 
-    if(rc != SQLITE_OK)
-    {
-        fprintf(stderr, "Failed to initialize database: %s\n", sqlite3_errmsg(db));
-        sqlite3_close(db);
-        free(path);
+    /* Default 2 MB cache spills large transactions like a restore to the
+     * log page by page. Pages are allocated only when used.
+     */
+    sqlite3_exec(db, "pragma cache_size=-16384;", NULL, 0, NULL);
 
-        return false;
-    }
+    int rc = sqlite3_create_function(db, "ylva_fold", 1,
+                                     SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                     NULL, sql_fold, NULL, NULL);
 
-    char *query = sqlite3_mprintf("update entries set title='%q',"
-                                  "user='%q',"
-                                  "url='%q',"
-                                  "password='%q',"
-                                  "notes='%q',timestamp=datetime('now','localtime') where id=%d;",
-                                  new_entry->title,
-                                  new_entry->user,
-                                  new_entry->url,
-                                  new_entry->password,
-                                  new_entry->notes,id);
+    if(rc == SQLITE_OK)
+        rc = sqlite3_create_function(db, "ylva_url_key", 1,
+                                     SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                     NULL, sql_url_key, NULL, NULL);
 
-    rc = sqlite3_exec(db, query, NULL, 0, &err);
+    if(rc == SQLITE_OK)
+        rc = sqlite3_create_function(db, "ylva_contains", -1,
+                                     SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                     NULL, sql_contains, NULL, NULL);
 
-    if(rc != SQLITE_OK)
-    {
-        fprintf(stderr, "Error: %s\n", err);
-        sqlite3_free(err);
-        sqlite3_free(query);
-        sqlite3_close(db);
-        free(path);
+    if(rc == SQLITE_OK)
+        rc = sqlite3_create_function(db, "ylva_hash", -1,
+                                     SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                     NULL, sql_hash, NULL, NULL);
+
+    if(rc == SQLITE_OK)
+        rc = sqlite3_create_function(db, "ylva_xor", 2,
+                                     SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                     NULL, sql_xor, NULL, NULL);
 
+    if(rc != SQLITE_OK || !regex_register(db))
+    {
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
         return false;
     }
 
-    sqlite3_free(query);
-    sqlite3_close(db);
-    free(path);
-
-    return true;
+    return db_upgrade_schema(db);
 }
 
-/*Get entry which has the wanted id.
- * Caller must free the return value.
+/* Opens the currently active database. Database is checked for
+ * corruption and upgraded to the current schema if needed.
+ * Returns NULL on failure.
  */
-Entry_t *db_get_entry_by_id(int id)
+static sqlite3 *db_open_file()
 {
-    char *path = NULL;
     sqlite3 *db;
-    int rc;
-    char *query;
-    char *err = NULL;
-    Entry_t *entry = NULL;
+    char *path = NULL;
+
+    if(vault_lock(VAULT_SHARED) == -1)
+        return NULL;
 
     path = read_active_database_path();
 
@@ -241,279 +435,1624 @@ Entry_t *db_get_entry_by_id(int id)
         return NULL;
     }
 
-    rc = sqlite3_open(path, &db);
+    int rc = sqlite3_open(path, &db);
+
+    free(path);
 
     if(rc != SQLITE_OK)
     {
-        fprintf(stderr, "Error %s\n", sqlite3_errmsg(db));
-        free(path);
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
 
         return NULL;
     }
 
-    entry = entry_new_empty();
-   
-    query = sqlite3_mprintf("select id,title,user,url,password,notes,"
-                            "timestamp from entries where id=%d;", id);
+    if(!db_prepare(db))
+    {
+        sqlite3_close(db);
+        return NULL;
+    }
 
-    /* Set id to minus one by default. If query finds data
-     * we set the id back to the original one in the callback.
-     * We can uses this to easily check if we have valid data in the structure.
-     */
-    entry->id = -1;
+    return db;
+}
 
-    rc = sqlite3_exec(db, query, cb_get_by_id, entry, &err);
+/* Returns connection to the active database, caller must close it with
+ * db_close. Inside a session the session's connection is returned.
+ * Inside a unit of work the first call opens the connection and starts
+ * a transaction that lasts until db_unit_end.
+ */
+static sqlite3 *db_open_active()
+{
+    char *err = NULL;
 
-    if(rc != SQLITE_OK)
+    if(session_db)
+        return session_db;
+
+    sqlite3 *db = db_open_file();
+
+    if(!db || !unit_of_work)
+        return db;
+
+    if(sqlite3_exec(db, unit_write ? "begin immediate;" : "begin;",
+                    NULL, 0, &err) != SQLITE_OK)
     {
         fprintf(stderr, "Error: %s\n", err);
         sqlite3_free(err);
-        sqlite3_free(query);
-        free(path);
+        sqlite3_close(db);
 
         return NULL;
     }
 
-    sqlite3_free(query);
-    sqlite3_close(db);
-    free(path);
+    session_db = db;
+    session_refs = 1;
+    unit_open = true;
 
-    return entry;
+    return db;
 }
 
-/* Returns true on success, false on failure.
- * Parameter changes is set to true if entry with given
- * id was found and deleted.
+/* Closes connection returned by db_open_active, unless it is
+ * the connection of the current session.
  */
-bool db_delete_entry(int id, bool *changes)
+static void db_close(sqlite3 *db)
 {
-    char *path = NULL;
-    sqlite3 *db;
-    int rc;
-    char *query;
-    char *err = NULL;
-    int count;
+    if(db != session_db)
+        sqlite3_close(db);
+}
 
-    path = read_active_database_path();
+/* Returns prepared statement for sql. Statements of the session are
+ * kept and reused, so repeated commands skip parsing and planning.
+ * Release the statement with db_release.
+ */
+static sqlite3_stmt *db_statement(sqlite3 *db, const char *sql)
+{
+    sqlite3_stmt *stmt = NULL;
 
-    if(!path)
+    if(db == session_db)
     {
-        fprintf(stderr, "Error getting database path\n");
-        return false;
+        for(int i = 0; i < STMT_CACHE_SIZE; i++)
+        {
+            if(stmt_cache[i] && strcmp(sqlite3_sql(stmt_cache[i]), sql) == 0)
+                return stmt_cache[i];
+        }
     }
 
-    if(!db_check_integrity(path))
+    if(sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
     {
-        fprintf(stderr, "Corrupted database. Abort.\n");
-        free(path);
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+        return NULL;
+    }
 
-        return false;
+    if(db == session_db)
+    {
+        sqlite3_finalize(stmt_cache[stmt_cache_next]);
+        stmt_cache[stmt_cache_next] = stmt;
+        stmt_cache_next = (stmt_cache_next + 1) % STMT_CACHE_SIZE;
     }
 
-    rc = sqlite3_open(path, &db);
+    return stmt;
+}
 
-    if(rc != SQLITE_OK)
+static void db_release(sqlite3_stmt *stmt)
+{
+    for(int i = 0; i < STMT_CACHE_SIZE; i++)
     {
-        fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(db));
-        free(path);
-        return false;
+        if(stmt_cache[i] == stmt)
+        {
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+            return;
+        }
     }
 
-    query = sqlite3_mprintf("delete from entries where id=%d;", id);
-    rc = sqlite3_exec(db, query, NULL, 0, &err);
+    sqlite3_finalize(stmt);
+}
 
-    if(rc != SQLITE_OK)
+/* Opens the active database and keeps it open until db_session_close.
+ * Meanwhile all functions use the same connection, so the database is
+ * opened and checked only once. Sessions can be nested, connection is
+ * closed by the last db_session_close.
+ */
+bool db_session_open()
+{
+    if(!session_db)
     {
-        fprintf(stderr, "Error: %s\n", err);
-        sqlite3_free(err);
-        sqlite3_free(query);
-        sqlite3_close(db);
-        free(path);
+        session_db = db_open_file();
 
-        return false;
+        if(!session_db)
+            return false;
     }
 
-    count = sqlite3_changes(db);
+    session_refs++;
 
-    if(count > 0)
-        *changes = true;
+    return true;
+}
 
-    sqlite3_free(query);
-    sqlite3_close(db);
+void db_session_close()
+{
+    if(!session_db || --session_refs > 0)
+        return;
 
-    free(path);
+    for(int i = 0; i < STMT_CACHE_SIZE; i++)
+    {
+        sqlite3_finalize(stmt_cache[i]);
+        stmt_cache[i] = NULL;
+    }
 
-    return true;
+    /* Anything not committed is rolled back */
+    sqlite3_close(session_db);
+    session_db = NULL;
+}
+
+/* Starts a transaction in the session, opening it if needed. Savepoint
+ * is used so that this works inside a unit of work too. Changes are
+ * written together by db_end.
+ */
+bool db_begin()
+{
+    char *err = NULL;
+
+    if(!db_session_open())
+        return false;
+
+    if(sqlite3_exec(session_db, "savepoint ylva_begin;", NULL, 0, &err) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
+        db_session_close();
+
+        return false;
+    }
+
+    return true;
+}
+
+/* Commits or rolls back the changes made after db_begin and closes the
+ * session opened by it. Returns false if nothing was committed.
+ */
+bool db_end(bool commit)
+{
+    char *err = NULL;
+    bool ok = commit;
+
+    if(!session_db)
+        return false;
+
+    if(!commit)
+        sqlite3_exec(session_db, "rollback to ylva_begin;", NULL, 0, NULL);
+
+    if(sqlite3_exec(session_db, "release ylva_begin;", NULL, 0, &err) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
+        ok = false;
+    }
+
+    db_session_close();
+
+    return ok;
+}
+
+/* Everything after db_unit_begin runs in one transaction on one
+ * connection, opened on first use, so that the options of one
+ * invocation are written together. Sessions opened meanwhile are not
+ * part of the unit and commit their changes themselves.
+ */
+void db_unit_begin()
+{
+    unit_of_work = true;
+}
+
+/* Called before an option that changes the database reads anything.
+ * A deferred transaction keeps the snapshot of its first read, and if
+ * another process commits before the write, like while --edit waits
+ * for input, the write fails with SQLITE_BUSY_SNAPSHOT without the busy
+ * handler ever being called. So the rest of the unit runs in an
+ * immediate transaction, which waits for the write lock up front. A
+ * transaction that has only read so far is ended first.
+ */
+bool db_unit_write()
+{
+    char *err = NULL;
+
+    if(!unit_of_work || unit_write)
+        return true;
+
+    unit_write = true;
+
+    if(!unit_open)
+        return true;
+
+    if(sqlite3_exec(session_db, "commit; begin immediate;", NULL, 0, &err) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
+        sqlite3_exec(session_db, "rollback;", NULL, 0, NULL);
+        unit_open = false;
+        db_session_close();
+        return false;
+    }
+
+    return true;
+}
+
+/* Commits or rolls back the work done so far and closes the database.
+ * The unit goes on, the next use of the database starts a new
+ * transaction. Returns false if commit failed.
+ */
+bool db_unit_end(bool commit)
+{
+    char *err = NULL;
+    bool ok = true;
+
+    unit_write = false;
+
+    if(!unit_open)
+        return true;
+
+    if(sqlite3_exec(session_db, commit ? "commit;" : "rollback;",
+                    NULL, 0, &err) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
+        sqlite3_exec(session_db, "rollback;", NULL, 0, NULL);
+        ok = false;
+    }
+
+    unit_open = false;
+    db_session_close();
+
+    return ok;
+}
+
+/* Moves everything from the write-ahead log to the database file and
+ * removes the log, so that path alone holds the whole database. Called
+ * with the vault lock held exclusively before the file is encrypted.
+ */
+bool db_checkpoint(const char *path)
+{
+    sqlite3 *db;
+    char *err = NULL;
+
+    if(sqlite3_open_v2(path, &db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+
+        return false;
+    }
+
+    sqlite3_busy_handler(db, lock_busy_handler, NULL);
+
+    if(sqlite3_exec(db, "pragma journal_mode=delete;", NULL, 0, &err) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
+        sqlite3_close(db);
+
+        return false;
+    }
+
+    return sqlite3_close(db) == SQLITE_OK;
+}
+
+bool db_init_new(const char *path)
+{
+    sqlite3 *db;
+    char *err = NULL;
+
+    int rc = sqlite3_open(path, &db);
+
+    if(rc != SQLITE_OK)
+    {
+        fprintf(stderr, "Failed to initialize database: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+
+        return false;
+    }
+
+    char *query = "create table entries"
+        "(id integer primary key, title text, user text, url text,"
+        "password text, notes text,"
+        "timestamp date default (datetime('now','localtime')));";
+
+    rc = sqlite3_exec(db, query, 0, 0, &err);
+
+    if(rc != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
+        sqlite3_close(db);
+
+        return false;
+    }
+
+    /* New databases go through the same migrations as old ones */
+    if(!db_prepare(db))
+    {
+        sqlite3_close(db);
+        return false;
+    }
+
+    sqlite3_close(db);
+    set_file_owner_rw(path);
+
+    return true;
+}
+
+bool db_insert_entry(Entry_t *entry)
+{
+    sqlite3 *db;
+    char *err = NULL;
+
+    db = db_open_active();
+
+    if(!db)
+        return false;
+
+    char *query = sqlite3_mprintf("insert into entries(title, user, url, password, notes,"
+                                  "title_fold, user_fold, url_fold, notes_fold, url_key,"
+                                  "modified_utc)"
+                                  "values('%q','%q','%q','%q','%q',"
+                                  "ylva_fold('%q'),ylva_fold('%q'),ylva_fold('%q'),ylva_fold('%q'),"
+                                  "ylva_url_key('%q'),datetime('now'))",
+                                  entry->title, entry->user, entry->url, entry->password,
+                                  entry->notes, entry->title, entry->user, entry->url,
+                                  entry->notes, entry->url);
+
+    int rc = sqlite3_exec(db, query, NULL, 0, &err);
+
+    if(rc != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
+        sqlite3_free(query);
+        db_close(db);
+
+        return false;
+    }
+
+    entry->id = sqlite3_last_insert_rowid(db);
+
+    sqlite3_free(query);
+    db_close(db);
+
+    return true;
+}
+
+static int history_size()
+{
+    char *size = getenv("YLVA_HISTORY_SIZE");
+
+    if(size == NULL || size[0] == '\0')
+        return HISTORY_DEFAULT_SIZE;
+
+    return atoi(size) > 0 ? atoi(size) : 0;
+}
+
+static void blob_append(Blob_t *blob, const void *data, size_t len)
+{
+    if(blob->len + len > blob->cap)
+    {
+        while(blob->len + len > blob->cap)
+            blob->cap = blob->cap ? blob->cap * 2 : 256;
+
+        /* Grow by copying, so the old buffer is wiped and not left behind */
+        uint8_t *grown = secure_alloc(blob->cap);
+
+        if(blob->data)
+            memcpy(grown, blob->data, blob->len);
+
+        secure_free(blob->data);
+        blob->data = grown;
+    }
+
+    memcpy(blob->data + blob->len, data, len);
+    blob->len += len;
+}
+
+/* Seven bits at a time, high bit set on all but the last byte */
+static void blob_append_varint(Blob_t *blob, size_t value)
+{
+    do
+    {
+        uint8_t byte = (value & 0x7F) | (value > 0x7F ? 0x80 : 0);
+
+        blob_append(blob, &byte, 1);
+        value >>= 7;
+
+    } while(value);
+}
+
+/* Saves values of the fields new_entry changes as a history record of
+ * the entry and drops the records past the retention count. The record
+ * has a bit in fields for every changed field, in the order of
+ * HISTORY_FIELDS, and data holds their old values in the same order,
+ * each as a varint length and the bytes. Larger records are compressed
+ * with zlib, size is then the uncompressed size and otherwise 0.
+ */
+static bool db_save_history(sqlite3 *db, int id, Entry_t *new_entry, int keep)
+{
+    const char *new_values[HISTORY_FIELDS] =
+    {
+        new_entry->title, new_entry->user, new_entry->url,
+        new_entry->password, new_entry->notes
+    };
+    sqlite3_stmt *stmt;
+    Blob_t raw = { NULL, 0, 0 };
+    int fields = 0;
+    bool ok = true;
+
+    stmt = db_statement(db, "select title,user,url,password,notes from entries where id=?;");
+
+    if(!stmt)
+        return false;
+
+    sqlite3_bind_int(stmt, 1, id);
+
+    if(sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        for(int i = 0; i < HISTORY_FIELDS; i++)
+        {
+            const char *old = column_text(stmt, i);
+            size_t len = strlen(old);
+
+            if(strcmp(old, new_values[i] ? new_values[i] : "") == 0)
+                continue;
+
+            fields |= 1 << i;
+            blob_append_varint(&raw, len);
+            blob_append(&raw, old, len);
+        }
+    }
+
+    db_release(stmt);
+
+    if(fields == 0)
+        return true;
+
+    const uint8_t *data = raw.data;
+    size_t data_len = raw.len;
+    size_t size = 0;
+    uLongf packed_len = compressBound(raw.len);
+    uint8_t *packed = secure_alloc(packed_len);
+
+    if(raw.len >= HISTORY_COMPRESS_MIN &&
+       compress2(packed, &packed_len, raw.data, raw.len, Z_BEST_COMPRESSION) == Z_OK &&
+       packed_len < raw.len)
+    {
+        data = packed;
+        data_len = packed_len;
+        size = raw.len;
+    }
+
+    stmt = db_statement(db, "insert into history(entry_id, changed, fields, size, data) "
+                            "values(?, datetime('now','localtime'), ?, ?, ?);");
+
+    if(stmt)
+    {
+        sqlite3_bind_int(stmt, 1, id);
+        sqlite3_bind_int(stmt, 2, fields);
+        sqlite3_bind_int64(stmt, 3, size);
+        sqlite3_bind_blob(stmt, 4, data, data_len, SQLITE_STATIC);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        db_release(stmt);
+    }
+    else
+    {
+        ok = false;
+    }
+
+    secure_free(raw.data);
+    secure_free(packed);
+
+    if(!ok)
+        return false;
+
+    /* Keep the newest records, found through the index */
+    stmt = db_statement(db, "delete from history where entry_id=?1 and id <= "
+                            "(select id from history where entry_id=?1 "
+                            "order by id desc limit 1 offset ?2);");
+
+    if(!stmt)
+        return false;
+
+    sqlite3_bind_int(stmt, 1, id);
+    sqlite3_bind_int(stmt, 2, keep);
+    ok = sqlite3_step(stmt) == SQLITE_DONE;
+    db_release(stmt);
+
+    return ok;
+}
+
+/* Writes entry with its id and timestamp, replacing an entry that has
+ * the same id. Used by restore. The replaced entry keeps its uuid. The
+ * time in UTC is taken from the timestamp, as backups don't have it.
+ */
+bool db_restore_entry(const Entry_t *entry)
+{
+    sqlite3 *db = db_open_active();
+    sqlite3_stmt *stmt;
+    const char *values[] = { entry->title, entry->user, entry->url, entry->password,
+                             entry->notes, entry->stamp };
+
+    if(!db)
+        return false;
+
+    /* An update rather than a replace, so triggers see the old values */
+    stmt = db_statement(db, "insert into entries(id, title, user, url, password,"
+                            "notes, timestamp, title_fold, user_fold, url_fold, notes_fold,"
+                            "url_key, modified_utc) values(?1, ?2, ?3, ?4, ?5, ?6, ?7,"
+                            "ylva_fold(?2), ylva_fold(?3), ylva_fold(?4), ylva_fold(?6),"
+                            "ylva_url_key(?4), datetime(?7, 'utc')) "
+                            "on conflict(id) do update set title=excluded.title,"
+                            "user=excluded.user, url=excluded.url, password=excluded.password,"
+                            "notes=excluded.notes, timestamp=excluded.timestamp,"
+                            "title_fold=excluded.title_fold, user_fold=excluded.user_fold,"
+                            "url_fold=excluded.url_fold, notes_fold=excluded.notes_fold,"
+                            "url_key=excluded.url_key, modified_utc=excluded.modified_utc;");
+
+    if(!stmt)
+    {
+        db_close(db);
+        return false;
+    }
+
+    sqlite3_bind_int(stmt, 1, entry->id);
+
+    for(int i = 0; i < 6; i++)
+        sqlite3_bind_text(stmt, i + 2, values[i], -1, SQLITE_STATIC);
+
+    int rc = sqlite3_step(stmt);
+
+    if(rc != SQLITE_DONE)
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+
+    db_release(stmt);
+    db_close(db);
+
+    return rc == SQLITE_DONE;
+}
+
+/* Sets match to whether entry, which does not need to be in the
+ * database, matches query. Returns false on error.
+ */
+bool db_entry_matches(const Query_t *query, const Entry_t *entry, bool *match)
+{
+    sqlite3 *db = db_open_active();
+    sqlite3_stmt *stmt;
+
+    if(!db)
+        return false;
+
+    /* The values come first, so they are ?1 to ?5 and the parameters of
+     * the query follow them.
+     */
+    char *sql = sqlite3_mprintf("with entries(title_fold, user_fold, url_fold, notes_fold,"
+                                "timestamp) as (values(ylva_fold(?1), ylva_fold(?2),"
+                                "ylva_fold(?3), ylva_fold(?4), ?5)) "
+                                "select 1 from entries where %s;", query->where);
+
+    stmt = db_statement(db, sql);
+    sqlite3_free(sql);
+
+    if(!stmt)
+    {
+        db_close(db);
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, entry->title, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, entry->user, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, entry->url, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, entry->notes, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 5, entry->stamp, -1, SQLITE_STATIC);
+
+    for(int i = 0; i < query->count; i++)
+        sqlite3_bind_text(stmt, i + 6, query->params[i], -1, SQLITE_STATIC);
+
+    int rc = sqlite3_step(stmt);
+
+    *match = rc == SQLITE_ROW;
+
+    if(rc != SQLITE_ROW && rc != SQLITE_DONE)
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+
+    db_release(stmt);
+    db_close(db);
+
+    return rc == SQLITE_ROW || rc == SQLITE_DONE;
+}
+
+/* Updates the entry. Old values of the changed fields are saved to
+ * history in the same transaction.
+ */
+bool db_update_entry(int id, Entry_t *new_entry)
+{
+    sqlite3 *db;
+    char *err = NULL;
+    int keep = history_size();
+
+    db = db_open_active();
+
+    if(!db)
+        return false;
+
+    if(sqlite3_exec(db, "savepoint ylva_update;", NULL, 0, &err) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
+        db_close(db);
+
+        return false;
+    }
+
+    if(keep > 0 && !db_save_history(db, id, new_entry, keep))
+    {
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+        sqlite3_exec(db, "rollback to ylva_update; release ylva_update;", NULL, 0, NULL);
+        db_close(db);
+
+        return false;
+    }
+
+    char *query = sqlite3_mprintf("update entries set title='%q',"
+                                  "user='%q',"
+                                  "url='%q',"
+                                  "password='%q',"
+                                  "notes='%q',"
+                                  "title_fold=ylva_fold('%q'),"
+                                  "user_fold=ylva_fold('%q'),"
+                                  "url_fold=ylva_fold('%q'),"
+                                  "notes_fold=ylva_fold('%q'),"
+                                  "url_key=ylva_url_key('%q'),"
+                                  "timestamp=datetime('now','localtime'),"
+                                  "modified_utc=datetime('now') where id=%d;",
+                                  new_entry->title,
+                                  new_entry->user,
+                                  new_entry->url,
+                                  new_entry->password,
+                                  new_entry->notes,
+                                  new_entry->title,
+                                  new_entry->user,
+                                  new_entry->url,
+                                  new_entry->notes,
+                                  new_entry->url,id);
+
+    int rc = sqlite3_exec(db, query, NULL, 0, &err);
+
+    if(rc != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
+        sqlite3_free(query);
+        sqlite3_exec(db, "rollback to ylva_update; release ylva_update;", NULL, 0, NULL);
+        db_close(db);
+
+        return false;
+    }
+
+    sqlite3_free(query);
+    rc = sqlite3_exec(db, "release ylva_update;", NULL, 0, &err);
+
+    if(rc != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
+    }
+
+    db_close(db);
+
+    return rc == SQLITE_OK;
+}
+
+/*Get entry which has the wanted id.
+ * Caller must free the return value.
+ */
+Entry_t *db_get_entry_by_id(int id)
+{
+    sqlite3 *db;
+    int rc;
+    char *query;
+    char *err = NULL;
+    Entry_t *entry = NULL;
+
+    db = db_open_active();
+
+    if(!db)
+        return NULL;
+
+    entry = entry_new_empty();
+
+    query = sqlite3_mprintf("select " ENTRY_COLUMNS " from entries where id=%d;", id);
+
+    /* Set id to minus one by default. If query finds data
+     * we set the id back to the original one in the callback.
+     * We can uses this to easily check if we have valid data in the structure.
+     */
+    entry->id = -1;
+
+    rc = sqlite3_exec(db, query, cb_get_by_id, entry, &err);
+
+    if(rc != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
+        sqlite3_free(query);
+        db_close(db);
+
+        return NULL;
+    }
+
+    sqlite3_free(query);
+    db_close(db);
+
+    return entry;
+}
+
+/* Opens the active database read only for a single lookup. The integrity
+ * check and function registration of db_open_file are skipped, they cost
+ * more than the lookup itself and sqlite still reports damaged pages it
+ * reads. Databases that need an upgrade take the normal path.
+ */
+static sqlite3 *db_open_lookup()
+{
+    sqlite3 *db = NULL;
+    int version = 0;
+
+    if(session_db)
+        return session_db;
+
+    if(vault_lock(VAULT_SHARED) == -1)
+        return NULL;
+
+    char *path = read_active_database_path();
+
+    if(!path)
+    {
+        fprintf(stderr, "Error getting database path\n");
+        return NULL;
+    }
+
+    int rc = sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, NULL);
+
+    free(path);
+
+    if(rc == SQLITE_OK)
+        rc = sqlite3_busy_handler(db, lock_busy_handler, NULL);
+
+    if(rc == SQLITE_OK)
+        rc = sqlite3_exec(db, "pragma user_version;", cb_user_version, &version, NULL);
+
+    if(rc != SQLITE_OK || version != sizeof(migrations) / sizeof(migrations[0]))
+    {
+        sqlite3_close(db);
+        return db_open_active();
+    }
+
+    return db;
+}
+
+/* Finds entries whose title is exactly name, or if there are none, whose
+ * url points to the same site as name, see fold_url. Both are index
+ * lookups. Value of field is copied to lookup when exactly one entry
+ * matches. Returns false on error.
+ */
+bool db_lookup_field(const char *name, const char *field, Lookup_t *lookup)
+{
+    static const char *fields[] = { "title", "user", "url", "password", "notes" };
+    const char *where[] = { "title", "url_key" };
+    char *key = fold_url(name);
+    const char *column = NULL;
+    bool ok = true;
+
+    lookup->value = NULL;
+    lookup->matches = 0;
+
+    for(size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+    {
+        if(strcmp(field, fields[i]) == 0)
+            column = fields[i];
+    }
+
+    if(!column)
+    {
+        fprintf(stderr, "Unknown field %s.\n", field);
+        free(key);
+        return false;
+    }
+
+    sqlite3 *db = db_open_lookup();
+
+    if(!db)
+    {
+        free(key);
+        return false;
+    }
+
+    for(int i = 0; ok && i < 2 && lookup->matches == 0; i++)
+    {
+        const char *value = i == 0 ? name : key;
+
+        if(!value)
+            break;
+
+        char *sql = sqlite3_mprintf("select id, %s from entries where %s=?;",
+                                    column, where[i]);
+        sqlite3_stmt *stmt = db_statement(db, sql);
+        int rc;
+
+        sqlite3_free(sql);
+
+        if(!stmt)
+        {
+            ok = false;
+            break;
+        }
+
+        sqlite3_bind_text(stmt, 1, value, -1, SQLITE_STATIC);
+
+        while((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            if(lookup->matches < LOOKUP_MAX_IDS)
+                lookup->ids[lookup->matches] = sqlite3_column_int(stmt, 0);
+
+            if(lookup->matches == 0)
+                lookup->value = secure_strdup(column_text(stmt, 1));
+
+            lookup->matches++;
+        }
+
+        if(rc != SQLITE_DONE)
+        {
+            fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+            ok = false;
+        }
+
+        db_release(stmt);
+    }
+
+    if(lookup->value && (!ok || lookup->matches != 1))
+    {
+        secure_free(lookup->value);
+        lookup->value = NULL;
+    }
+
+    free(key);
+    db_close(db);
+
+    return ok;
+}
+
+/* Returns true on success, false on failure.
+ * Parameter changes is set to true if entry with given
+ * id was found and deleted.
+ */
+bool db_delete_entry(int id, bool *changes)
+{
+    sqlite3 *db;
+    int rc;
+    char *query;
+    char *err = NULL;
+    int count;
+
+    db = db_open_active();
+
+    if(!db)
+        return false;
+
+    /* History goes with the entry, ids can be used again */
+    query = sqlite3_mprintf("delete from history where entry_id=%d;"
+                            "delete from entries where id=%d;", id, id);
+    rc = sqlite3_exec(db, query, NULL, 0, &err);
+
+    if(rc != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
+        sqlite3_free(query);
+        db_close(db);
+
+        return false;
+    }
+
+    count = sqlite3_changes(db);
+
+    if(count > 0)
+        *changes = true;
+
+    sqlite3_free(query);
+    db_close(db);
+
+    return true;
+}
+
+/* Runs select returning ENTRY_COLUMNS and calls cb for every row as
+ * soon as it is read. The entry passed to cb points directly to sqlite's
+ * memory and is only valid during the call. Values of the query are
+ * bound to the statement if query is not NULL.
+ */
+static bool db_stream(sqlite3 *db, const char *sql, const Query_t *query,
+                      Entry_cb cb, void *data)
+{
+    sqlite3_stmt *stmt = db_statement(db, sql);
+    int rc;
+
+    if(!stmt)
+        return false;
+
+    for(int i = 0; query && i < query->count; i++)
+        sqlite3_bind_text(stmt, i + 1, query->params[i], -1, SQLITE_STATIC);
+
+    while((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        Entry_t entry;
+
+        entry.id = sqlite3_column_int(stmt, 0);
+        entry.title = (char *)column_text(stmt, 1);
+        entry.user = (char *)column_text(stmt, 2);
+        entry.url = (char *)column_text(stmt, 3);
+        entry.password = (char *)column_text(stmt, 4);
+        entry.notes = (char *)column_text(stmt, 5);
+        entry.stamp = (char *)column_text(stmt, 6);
+        entry.next = NULL;
+
+        if(!cb(&entry, data))
+        {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+
+    if(rc != SQLITE_DONE)
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+
+    db_release(stmt);
+
+    return rc == SQLITE_DONE;
+}
+
+/* Opens the active database and streams the result of sql to cb */
+static bool db_stream_active(const char *sql, const Query_t *query,
+                             Entry_cb cb, void *data)
+{
+    sqlite3 *db = db_open_active();
+
+    if(!db)
+        return false;
+
+    bool ok = db_stream(db, sql, query, cb, data);
+
+    db_close(db);
+
+    return ok;
+}
+
+/* Entry_cb that copies the streamed entries to a list.
+ * data points to the last entry of the list.
+ */
+static bool cb_append(Entry_t *entry, void *tail)
+{
+    Entry_t *one_entry = entry_add(*(Entry_t **)tail, entry->title, entry->user,
+                                   entry->url, entry->password, entry->notes);
+    one_entry->id = entry->id;
+    one_entry->stamp = strdup(entry->stamp);
+
+    *(Entry_t **)tail = one_entry;
+
+    return true;
 }
 
 /* Get latest count of entries pointed by count_latest.
  * -1 to get everything. -2 to get everything ordered by date
  */
-Entry_t *db_get_list(int count_latest)
+bool db_stream_list(int count_latest, Entry_cb cb, void *data)
+{
+    char limit[32];
+    char *params[1] = { limit };
+    Query_t query = { NULL, params, 1 };
+
+    if(count_latest < 0 && count_latest != -1 && count_latest != -2)
+    {
+        fprintf(stderr, "Invalid parameter <count>\n");
+        return false;
+    }
+
+    /* Get all data or a defined count, negative limit means no limit */
+    if(count_latest == -1)
+        return db_stream_active("select " ENTRY_COLUMNS " from entries;",
+                                NULL, cb, data);
+
+    snprintf(limit, sizeof(limit), "%d", count_latest == -2 ? -1 : count_latest);
+
+    return db_stream_active("select " ENTRY_COLUMNS " from entries "
+                            "order by datetime(timestamp) desc limit ?;",
+                            &query, cb, data);
+}
+
+/* Search is done against the case and accent folded columns,
+ * so "MÜNCHEN" finds entries containing "munchen".
+ */
+bool db_stream_find(const char *search, Entry_cb cb, void *data)
+{
+    char *folded = fold_text(search);
+    Query_t query = { NULL, &folded, 1 };
+
+    /* Search the same search term from each column we're might be interested in.
+     * ylva_contains checks all of them with one call per row.
+     */
+    bool ok = db_stream_active("select " ENTRY_COLUMNS " from entries "
+                               "where ylva_contains(?, title_fold, user_fold,"
+                               "url_fold, notes_fold);", &query, cb, data);
+
+    free(folded);
+
+    return ok;
+}
+
+/* Match regular expression against every field of the entries.
+ * With ignore_case the expression is folded and matched against
+ * the folded columns, so it ignores both case and accents.
+ */
+bool db_stream_regex(const char *regex, bool ignore_case, Entry_cb cb, void *data)
 {
-    char *path = NULL;
-    char *err = NULL;
-    sqlite3 *db;
-    char *query = NULL;
+    char *pattern = ignore_case ? fold_regex(regex) : strdup(regex);
+    Query_t query = { NULL, &pattern, 1 };
+    bool ok;
+
+    if(ignore_case)
+        ok = db_stream_active("select " ENTRY_COLUMNS " from entries "
+                              "where ylva_regex(?1, title_fold, 1) "
+                              "or ylva_regex(?1, user_fold, 1) "
+                              "or ylva_regex(?1, url_fold, 1) "
+                              "or ylva_regex(?1, notes_fold, 1) "
+                              "or ylva_regex(?1, timestamp, 1);", &query, cb, data);
+    else
+        ok = db_stream_active("select " ENTRY_COLUMNS " from entries "
+                              "where ylva_regex(?1, title, 0) "
+                              "or ylva_regex(?1, user, 0) "
+                              "or ylva_regex(?1, url, 0) "
+                              "or ylva_regex(?1, notes, 0) "
+                              "or ylva_regex(?1, timestamp, 0);", &query, cb, data);
 
-    if(count_latest < 0 && count_latest != -1 && count_latest != -2)
+    free(pattern);
+
+    return ok;
+}
+
+/* Finds entries matching a query compiled with query_compile */
+bool db_stream_query(const Query_t *query, Entry_cb cb, void *data)
+{
+    char *sql = sqlite3_mprintf("select " ENTRY_COLUMNS " from entries where %s "
+                                "order by id;", query->where);
+
+    bool ok = db_stream_active(sql, query, cb, data);
+
+    sqlite3_free(sql);
+
+    return ok;
+}
+
+/* Decodes a history record, see db_save_history, to values. Values
+ * point to text, which must have room for the data and a terminator
+ * per field. Returns false if the record is damaged.
+ */
+static bool history_decode(const uint8_t *data, size_t len, int fields,
+                           char *text, char **values)
+{
+    size_t pos = 0;
+
+    for(int i = 0; i < HISTORY_FIELDS; i++)
     {
-        fprintf(stderr, "Invalid parameter <count>\n");
-        return NULL;
+        size_t value_len = 0;
+        int shift = 0;
+        uint8_t byte;
+
+        values[i] = NULL;
+
+        if(!(fields & (1 << i)))
+            continue;
+
+        do
+        {
+            if(pos == len || shift > 56)
+                return false;
+
+            byte = data[pos++];
+            value_len |= (size_t)(byte & 0x7F) << shift;
+            shift += 7;
+
+        } while(byte & 0x80);
+
+        if(value_len > len - pos)
+            return false;
+
+        memcpy(text, data + pos, value_len);
+        text[value_len] = '\0';
+        values[i] = text;
+        text += value_len + 1;
+        pos += value_len;
     }
 
-    path = read_active_database_path();
+    return true;
+}
 
-    if(!path)
+/* Streams history records of entry id, newest first. The entry passed
+ * to cb has the id of the entry, the time of the change as stamp and
+ * the values the change replaced. Fields that did not change are NULL.
+ */
+bool db_stream_history(int id, Entry_cb cb, void *data)
+{
+    sqlite3 *db = db_open_active();
+    sqlite3_stmt *stmt;
+    int rc;
+
+    if(!db)
+        return false;
+
+    stmt = db_statement(db, "select changed, fields, size, data from history "
+                            "where entry_id=? order by id desc;");
+
+    if(!stmt)
     {
-        fprintf(stderr, "Error getting database path\n");
-        return NULL;
+        db_close(db);
+        return false;
     }
 
-    if(!db_check_integrity(path))
+    sqlite3_bind_int(stmt, 1, id);
+
+    while((rc = sqlite3_step(stmt)) == SQLITE_ROW)
     {
-        fprintf(stderr, "Corrupted database. Abort.\n");
-        free(path);
+        int fields = sqlite3_column_int(stmt, 1);
+        size_t size = sqlite3_column_int64(stmt, 2);
+        const uint8_t *record = sqlite3_column_blob(stmt, 3);
+        size_t len = sqlite3_column_bytes(stmt, 3);
+        uint8_t *unpacked = NULL;
+        char *values[HISTORY_FIELDS];
+        bool more = true;
+
+        if(size > 0)
+        {
+            uLongf unpacked_len = size;
 
-        return NULL;
+            unpacked = secure_alloc(size);
+
+            if(uncompress(unpacked, &unpacked_len, record, len) != Z_OK ||
+               unpacked_len != size)
+            {
+                secure_free(unpacked);
+                fprintf(stderr, "Damaged history record of entry %d.\n", id);
+                continue;
+            }
+
+            record = unpacked;
+            len = size;
+        }
+
+        char *text = secure_alloc(len + HISTORY_FIELDS);
+
+        if(history_decode(record, len, fields, text, values))
+        {
+            Entry_t entry;
+
+            entry.id = id;
+            entry.title = values[0];
+            entry.user = values[1];
+            entry.url = values[2];
+            entry.password = values[3];
+            entry.notes = values[4];
+            entry.stamp = (char *)column_text(stmt, 0);
+            entry.next = NULL;
+
+            more = cb(&entry, data);
+        }
+        else
+        {
+            fprintf(stderr, "Damaged history record of entry %d.\n", id);
+        }
+
+        secure_free(text);
+        secure_free(unpacked);
+
+        if(!more)
+        {
+            rc = SQLITE_DONE;
+            break;
+        }
     }
 
-    int rc = sqlite3_open(path, &db);
+    if(rc != SQLITE_DONE)
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
 
-    if(rc != SQLITE_OK)
+    db_release(stmt);
+    db_close(db);
+
+    return rc == SQLITE_DONE;
+}
+
+/* Sets since to the change log position of the previous snapshot of
+ * chain, or -1 if the chain is not known, and current to the newest
+ * position.
+ */
+bool db_snapshot_state(const char *chain, long long *since, long long *current)
+{
+    sqlite3 *db = db_open_active();
+    sqlite3_stmt *stmt;
+    int rc;
+
+    if(!db)
+        return false;
+
+    stmt = db_statement(db, "select coalesce((select seq from snapshots where chain=?),-1),"
+                            "coalesce((select seq from sqlite_sequence where name='changes'),0);");
+
+    if(!stmt)
+    {
+        db_close(db);
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, chain, -1, SQLITE_STATIC);
+
+    rc = sqlite3_step(stmt);
+
+    if(rc == SQLITE_ROW)
+    {
+        *since = sqlite3_column_int64(stmt, 0);
+        *current = sqlite3_column_int64(stmt, 1);
+    }
+    else
     {
         fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
-        sqlite3_close(db);
-        free(path);
+    }
 
-        return NULL;
+    db_release(stmt);
+    db_close(db);
+
+    return rc == SQLITE_ROW;
+}
+
+/* Calls cb once for every entry changed after change log position
+ * since. Entry is NULL if the entry has been removed.
+ */
+bool db_stream_changes(long long since, Change_cb cb, void *data)
+{
+    sqlite3 *db = db_open_active();
+    sqlite3_stmt *stmt;
+    int rc;
+
+    if(!db)
+        return false;
+
+    stmt = db_statement(db, "select c.entry_id,e.title,e.user,e.url,e.password,e.notes,"
+                            "e.timestamp,e.id is not null from (select distinct entry_id "
+                            "from changes where seq>?) c left join entries e "
+                            "on e.id=c.entry_id;");
+
+    if(!stmt)
+    {
+        db_close(db);
+        return false;
     }
 
-    /* Fill our list with dummy data */
-    Entry_t *entry = entry_new("dummy", "dummy", "dummy", "dummy", "dummy");
+    sqlite3_bind_int64(stmt, 1, since);
 
-    /* Get all data or a defined count */
-    if(count_latest == -1)
-        query = "select * from entries;";
-    else if(count_latest == -2)
-        query = sqlite3_mprintf("select * from entries order by datetime(timestamp) desc");
-    else
-        query = sqlite3_mprintf("select * from entries order by datetime(timestamp) desc limit %d", count_latest);
+    while((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        Entry_t entry;
+        int id = sqlite3_column_int(stmt, 0);
+
+        entry.id = id;
+        entry.title = (char *)column_text(stmt, 1);
+        entry.user = (char *)column_text(stmt, 2);
+        entry.url = (char *)column_text(stmt, 3);
+        entry.password = (char *)column_text(stmt, 4);
+        entry.notes = (char *)column_text(stmt, 5);
+        entry.stamp = (char *)column_text(stmt, 6);
+        entry.next = NULL;
+
+        if(!cb(id, sqlite3_column_int(stmt, 7) ? &entry : NULL, data))
+        {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+
+    if(rc != SQLITE_DONE)
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+
+    db_release(stmt);
+    db_close(db);
+
+    return rc == SQLITE_DONE;
+}
 
-    rc = sqlite3_exec(db, query, cb_list_all, entry, &err);
+/* Records that chain has the changes up to position seq. Changes every
+ * known chain has are removed from the log.
+ */
+bool db_snapshot_done(const char *chain, long long seq)
+{
+    sqlite3 *db = db_open_active();
+    char *err = NULL;
+
+    if(!db)
+        return false;
+
+    char *query = sqlite3_mprintf("insert or replace into snapshots(chain, seq) values(%Q, %lld);"
+                                  "delete from changes where seq<=(select min(seq) from snapshots);",
+                                  chain, seq);
+    int rc = sqlite3_exec(db, query, NULL, 0, &err);
 
     if(rc != SQLITE_OK)
     {
         fprintf(stderr, "Error: %s\n", err);
         sqlite3_free(err);
-
-        if(count_latest != -1 && query != NULL)
-            sqlite3_free(query);
-
-        sqlite3_close(db);
-        free(path);
-
-        return NULL;
     }
 
-    sqlite3_close(db);
-    free(path);
+    sqlite3_free(query);
+    db_close(db);
 
-    return entry;
+    return rc == SQLITE_OK;
 }
 
-Entry_t *db_find(const char *search)
+/* Removes all entries and their history */
+bool db_clear_entries()
 {
-    char *path = NULL;
+    sqlite3 *db = db_open_active();
     char *err = NULL;
-    sqlite3 *db;
 
-    path = read_active_database_path();
+    if(!db)
+        return false;
 
-    if(!path)
+    int rc = sqlite3_exec(db, "delete from history; delete from entries;", NULL, 0, &err);
+
+    if(rc != SQLITE_OK)
     {
-        fprintf(stderr, "Error getting database path\n");
-        return NULL;
+        fprintf(stderr, "Error: %s\n", err);
+        sqlite3_free(err);
     }
 
-    if(!db_check_integrity(path))
-    {
-        fprintf(stderr, "Corrupted database. Abort.\n");
-        free(path);
+    db_close(db);
 
+    return rc == SQLITE_OK;
+}
+
+/* Connection to the active database for modules that run their own
+ * queries, like sync. Release it with db_release_connection.
+ */
+sqlite3 *db_active_connection()
+{
+    return db_open_active();
+}
+
+void db_release_connection(sqlite3 *db)
+{
+    db_close(db);
+}
+
+/* Opens a private in-memory database from image, the contents of a
+ * database file, and brings it up to date. Returns NULL on failure.
+ * Close with sqlite3_close.
+ */
+sqlite3 *db_open_image(const unsigned char *image, size_t len)
+{
+    sqlite3 *db = NULL;
+    unsigned char *copy = sqlite3_malloc64(len);
+    int version = 0;
+
+    if(!copy)
         return NULL;
-    }
 
-    int rc = sqlite3_open(path, &db);
+    memcpy(copy, image, len);
 
-    if(rc != SQLITE_OK)
+    /* Copy is freed by sqlite, also when deserializing fails. Reading
+     * the version fails if the image is not a database.
+     */
+    if(sqlite3_open(":memory:", &db) != SQLITE_OK ||
+       sqlite3_deserialize(db, "main", copy, len, len, SQLITE_DESERIALIZE_FREEONCLOSE |
+                           SQLITE_DESERIALIZE_RESIZEABLE) != SQLITE_OK ||
+       sqlite3_exec(db, "pragma user_version;", cb_user_version, &version, NULL) != SQLITE_OK)
     {
         fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
         sqlite3_close(db);
-        free(path);
+        return NULL;
+    }
 
+    if(!db_prepare(db))
+    {
+        sqlite3_close(db);
         return NULL;
     }
 
-    /* Fill our list with dummy data */
-    Entry_t *entry = entry_new("dummy", "dummy", "dummy", "dummy", "dummy");
+    return db;
+}
+
+/* Returns the contents of database db as a file image. Caller must free
+ * the return value with sqlite3_free.
+ */
+unsigned char *db_image(sqlite3 *db, size_t *len)
+{
+    sqlite3_int64 size = 0;
+    unsigned char *image = sqlite3_serialize(db, "main", &size, 0);
+
+    if(!image)
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+
+    *len = size;
+
+    return image;
+}
+
+/* Writes entry with its timestamp and the time modified in UTC to db
+ * as the entry with uuid, adding it if db does not have it.
+ */
+bool db_put_synced(sqlite3 *db, const Entry_t *entry, const char *uuid,
+                   const char *modified)
+{
+    const char *values[] = { entry->title, entry->user, entry->url, entry->password,
+                             entry->notes, entry->stamp, uuid, modified };
+    sqlite3_stmt *stmt;
+
+    stmt = db_statement(db, "insert into entries(title, user, url, password, notes,"
+                            "timestamp, uuid, modified_utc, title_fold, user_fold, url_fold,"
+                            "notes_fold, url_key) values(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8,"
+                            "ylva_fold(?1), ylva_fold(?2), ylva_fold(?3), ylva_fold(?5),"
+                            "ylva_url_key(?3)) "
+                            "on conflict(uuid) do update set title=excluded.title,"
+                            "user=excluded.user, url=excluded.url, password=excluded.password,"
+                            "notes=excluded.notes, timestamp=excluded.timestamp,"
+                            "modified_utc=excluded.modified_utc,"
+                            "title_fold=excluded.title_fold, user_fold=excluded.user_fold,"
+                            "url_fold=excluded.url_fold, notes_fold=excluded.notes_fold,"
+                            "url_key=excluded.url_key;");
+
+    if(!stmt)
+        return false;
+
+    for(int i = 0; i < 8; i++)
+        sqlite3_bind_text(stmt, i + 1, values[i], -1, SQLITE_STATIC);
+
+    int rc = sqlite3_step(stmt);
+
+    if(rc != SQLITE_DONE)
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+
+    db_release(stmt);
 
-    /* Search the same search term from each column we're might be interested in. */
-    char *query = sqlite3_mprintf("select * from entries where title like '%%%q%%' "
-                                  "or user like '%%%q%%' "
-                                  "or url like '%%%q%%' "
-                                  "or notes like '%%%q%%';", search, search, search, search);
+    return rc == SQLITE_DONE;
+}
 
-    rc = sqlite3_exec(db, query, cb_find, entry, &err);
+/* Removes the entry with uuid and its history from db. The tombstone
+ * of the entry gets time deleted, when the other vault removed it.
+ */
+bool db_delete_synced(sqlite3 *db, const char *uuid, const char *deleted)
+{
+    char *err = NULL;
+    char *query = sqlite3_mprintf("delete from history where entry_id="
+                                  "(select id from entries where uuid=%Q);"
+                                  "delete from entries where uuid=%Q;"
+                                  "update tombstones set deleted=%Q where uuid=%Q;",
+                                  uuid, uuid, deleted, uuid);
+    int rc = sqlite3_exec(db, query, NULL, 0, &err);
 
     if(rc != SQLITE_OK)
     {
         fprintf(stderr, "Error: %s\n", err);
         sqlite3_free(err);
-        sqlite3_free(query);
-        sqlite3_close(db);
-        free(path);
+    }
 
+    sqlite3_free(query);
+
+    return rc == SQLITE_OK;
+}
+
+/* List versions of db_stream_list and db_stream_query. The list is
+ * initialized with dummy data which callers skip. Caller must free
+ * the return value.
+ */
+Entry_t *db_get_list(int count_latest)
+{
+    Entry_t *entry = entry_new("dummy", "dummy", "dummy", "dummy", "dummy");
+    Entry_t *tail = entry;
+
+    if(!db_stream_list(count_latest, cb_append, &tail))
+    {
+        entry_free(entry);
         return NULL;
     }
 
-    sqlite3_free(query);
-    sqlite3_close(db);
-    free(path);
+    return entry;
+}
+
+Entry_t *db_find_query(const Query_t *query)
+{
+    Entry_t *entry = entry_new("dummy", "dummy", "dummy", "dummy", "dummy");
+    Entry_t *tail = entry;
+
+    if(!db_stream_query(query, cb_append, &tail))
+    {
+        entry_free(entry);
+        return NULL;
+    }
 
     return entry;
 }
 
-static int cb_check_integrity(void *notused, int argc, char **argv, char **column_name)
+/* Loads folded search columns of all entries into one buffer for callers
+ * that search the same data many times. Caller must free the return
+ * value with scan_free.
+ */
+Scan_t *db_get_scan()
 {
-    for(int i = 0; i < argc; i++)
+    sqlite3 *db;
+    sqlite3_stmt *stmt = NULL;
+    Scan_t *scan = NULL;
+    int rc;
+
+    db = db_open_active();
+
+    if(!db)
+        return NULL;
+
+    rc = sqlite3_prepare_v2(db, "select id,title_fold,user_fold,url_fold,notes_fold "
+                            "from entries order by id;", -1, &stmt, NULL);
+
+    if(rc != SQLITE_OK)
     {
-        if(strcmp(column_name[i], "integrity_check") == 0)
-        {
-            char *result = argv[i];
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+        db_close(db);
 
-            if(strcmp(result, "ok") != 0)
-                return 1;
+        return NULL;
+    }
+
+    scan = scan_new();
+
+    while((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const char *fields[4];
+        size_t lens[4];
+
+        for(int i = 0; i < 4; i++)
+        {
+            fields[i] = (const char *)sqlite3_column_text(stmt, i + 1);
+            lens[i] = sqlite3_column_bytes(stmt, i + 1);
         }
+
+        scan_add_row(scan, sqlite3_column_int(stmt, 0), fields, lens, 4);
     }
 
-    return 0;
+    if(rc != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+        scan_free(scan);
+        scan = NULL;
+    }
+
+    sqlite3_finalize(stmt);
+    db_close(db);
+
+    return scan;
 }
 
-static int cb_list_all(void *entry, int argc, char **argv, char **column_name)
+static int cb_user_version(void *version, int argc, char **argv, char **column_name)
 {
-    Entry_t *one_entry = entry_add(entry, argv[1], argv[2], argv[3], argv[4], argv[5]);
-    one_entry->id = atoi(argv[0]);
-    one_entry->stamp = strdup(argv[6]);
+    if(argc > 0 && argv[0] != NULL)
+        *(int *)version = atoi(argv[0]);
 
     return 0;
 }
 
-static int cb_find(void *entry, int argc, char **argv, char **column_name)
+static int cb_check_integrity(void *notused, int argc, char **argv, char **column_name)
 {
-    Entry_t *one_entry = entry_add(entry, argv[1], argv[2], argv[3], argv[4], argv[5]);
-    one_entry->id = atoi(argv[0]);
-    one_entry->stamp = strdup(argv[6]);
+    for(int i = 0; i < argc; i++)
+    {
+        if(strcmp(column_name[i], "integrity_check") == 0)
+        {
+            char *result = argv[i];
+
+            if(strcmp(result, "ok") != 0)
+                return 1;
+        }
+    }
 
     return 0;
 }
@@ -547,7 +2086,7 @@ static int cb_get_by_id(void *entry, int argc, char **argv, char **column_name)
     ((Entry_t *)entry)->title = strdup(argv[1]);
     ((Entry_t *)entry)->user = strdup(argv[2]);
     ((Entry_t *)entry)->url = strdup(argv[3]);
-    ((Entry_t *)entry)->password = strdup(argv[4]);
+    ((Entry_t *)entry)->password = secure_strdup(argv[4]);
     ((Entry_t *)entry)->notes = strdup(argv[5]);
     ((Entry_t *)entry)->stamp = strdup(argv[6]);
     ((Entry_t *)entry)->next = NULL;
@@ -5,12 +5,71 @@
 #ifndef __DB_H
 #define __DB_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <sqlite3.h>
+#include "entry.h"
+#include "scan.h"
+#include "query.h"
+
+/* Called for every entry of a streamed result. Entry is only valid
+ * during the call. Return false to stop.
+ */
+typedef bool (*Entry_cb)(Entry_t *entry, void *data);
+
+/* Called for every changed entry by db_stream_changes. Entry is NULL
+ * if the entry with id has been removed.
+ */
+typedef bool (*Change_cb)(int id, Entry_t *entry, void *data);
+
+/* Number of matching ids db_lookup_field reports */
+#define LOOKUP_MAX_IDS 8
+
+typedef struct _lookup
+{
+    char *value;                /* Field of the only match, or NULL, free with secure_free */
+    int matches;                /* Number of matching entries */
+    int ids[LOOKUP_MAX_IDS];    /* First matching ids */
+
+} Lookup_t;
+
+bool db_session_open();
+void db_session_close();
+bool db_begin();
+bool db_end(bool commit);
+void db_unit_begin();
+bool db_unit_write();
+bool db_unit_end(bool commit);
 bool db_init_new(const char *path);
+bool db_checkpoint(const char *path);
 bool db_insert_entry(Entry_t *entry);
 bool db_update_entry(int id, Entry_t *new_entry);
+bool db_restore_entry(const Entry_t *entry);
+bool db_entry_matches(const Query_t *query, const Entry_t *entry, bool *match);
 bool db_delete_entry(int id, bool *changes);
 Entry_t *db_get_entry_by_id(int id);
 Entry_t *db_get_list(int count_latest);
-Entry_t *db_find(const char *search);
+Entry_t *db_find_query(const Query_t *query);
+Scan_t *db_get_scan();
+bool db_lookup_field(const char *name, const char *field, Lookup_t *lookup);
+
+bool db_stream_list(int count_latest, Entry_cb cb, void *data);
+bool db_stream_find(const char *search, Entry_cb cb, void *data);
+bool db_stream_regex(const char *regex, bool ignore_case, Entry_cb cb, void *data);
+bool db_stream_query(const Query_t *query, Entry_cb cb, void *data);
+bool db_stream_history(int id, Entry_cb cb, void *data);
+
+bool db_snapshot_state(const char *chain, long long *since, long long *current);
+bool db_stream_changes(long long since, Change_cb cb, void *data);
+bool db_snapshot_done(const char *chain, long long seq);
+bool db_clear_entries();
+
+sqlite3 *db_active_connection();
+void db_release_connection(sqlite3 *db);
+sqlite3 *db_open_image(const unsigned char *image, size_t len);
+unsigned char *db_image(sqlite3 *db, size_t *len);
+bool db_put_synced(sqlite3 *db, const Entry_t *entry, const char *uuid,
+                   const char *modified);
+bool db_delete_synced(sqlite3 *db, const char *uuid, const char *deleted);
 
 #endif
@@ -9,6 +9,7 @@
 #include <string.h>
 #include "entry.h"
 #include "utils.h"
+#include "securemem.h"
 
 /* Allocate and return a new entry containing data.
    Called must free the return value.
@@ -25,7 +26,7 @@ Entry_t *entry_new(const char *title, const char *user,
     new->title = strdup(title);
     new->user = strdup(user);
     new->url = strdup(url);
-    new->password = strdup(password);
+    new->password = secure_strdup(password);
     new->notes = strdup(notes);
     new->stamp = NULL;
     new->next = NULL;
@@ -37,6 +38,7 @@ Entry_t* entry_new_empty()
 {
     Entry_t* new = NULL;
     new = tmalloc(sizeof(struct _entry));
+    memset(new, 0, sizeof(struct _entry));
     return new;
 }
 
@@ -81,7 +83,7 @@ void entry_free(Entry_t *entry)
         free(entry->title);
         free(entry->user);
         free(entry->url);
-        free(entry->password);
+        secure_free(entry->password);
         free(entry->notes);
 
         if(entry->stamp)
@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "fold.h"
+#include "utils.h"
+
+/* Folding is a small approximation of Unicode NFKC + casefold that
+ * covers the scripts people actually type into a password manager.
+ * Accents are stripped so that "München" and "munchen" match each other.
+ * Code points we know nothing about are copied as they are.
+ */
+
+/* Base letters for U+00C0 - U+017F. NULL means keep the character. */
+static const char *latin_table[] =
+{
+    /* U+00C0 */
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+    /* U+00D0 */
+    "d", "n", "o", "o", "o", "o", "o", NULL, "o", "u", "u", "u", "u", "y", "th", "ss",
+    /* U+00E0 */
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+    /* U+00F0 */
+    "d", "n", "o", "o", "o", "o", "o", NULL, "o", "u", "u", "u", "u", "y", "th", "y",
+    /* U+0100 */
+    "a", "a", "a", "a", "a", "a", "c", "c", "c", "c", "c", "c", "c", "c", "d", "d",
+    /* U+0110 */
+    "d", "d", "e", "e", "e", "e", "e", "e", "e", "e", "e", "e", "g", "g", "g", "g",
+    /* U+0120 */
+    "g", "g", "g", "g", "h", "h", "h", "h", "i", "i", "i", "i", "i", "i", "i", "i",
+    /* U+0130 */
+    "i", "i", "ij", "ij", "j", "j", "k", "k", "k", "l", "l", "l", "l", "l", "l", "l",
+    /* U+0140 */
+    "l", "l", "l", "n", "n", "n", "n", "n", "n", "n", "n", "n", "o", "o", "o", "o",
+    /* U+0150 */
+    "o", "o", "oe", "oe", "r", "r", "r", "r", "r", "r", "s", "s", "s", "s", "s", "s",
+    /* U+0160 */
+    "s", "s", "t", "t", "t", "t", "t", "t", "u", "u", "u", "u", "u", "u", "u", "u",
+    /* U+0170 */
+    "u", "u", "u", "u", "w", "w", "y", "y", "y", "z", "z", "z", "z", "z", "z", "s"
+};
+
+/* Decode one UTF-8 sequence from str. Returns the number of bytes consumed
+ * and stores the code point to cp. Malformed input, including overlong
+ * and out of range sequences, is consumed one byte at a time and
+ * reported as code point -1.
+ */
+static int utf8_decode(const unsigned char *str, int32_t *cp)
+{
+    int len;
+    int32_t c = str[0];
+
+    if(c < 0x80)
+    {
+        *cp = c;
+        return 1;
+    }
+    else if((c & 0xE0) == 0xC0)
+    {
+        len = 2;
+        c &= 0x1F;
+    }
+    else if((c & 0xF0) == 0xE0)
+    {
+        len = 3;
+        c &= 0x0F;
+    }
+    else if((c & 0xF8) == 0xF0)
+    {
+        len = 4;
+        c &= 0x07;
+    }
+    else
+    {
+        *cp = -1;
+        return 1;
+    }
+
+    for(int i = 1; i < len; i++)
+    {
+        if((str[i] & 0xC0) != 0x80)
+        {
+            *cp = -1;
+            return 1;
+        }
+
+        c = (c << 6) | (str[i] & 0x3F);
+    }
+
+    /* Overlong forms, like C0 80 for NUL, surrogates and values past
+     * the last code point are malformed too.
+     */
+    static const int32_t min_cp[] = { 0, 0, 0x80, 0x800, 0x10000 };
+
+    if(c < min_cp[len] || (c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF)
+    {
+        *cp = -1;
+        return 1;
+    }
+
+    *cp = c;
+
+    return len;
+}
+
+static int utf8_encode(int32_t cp, char *out)
+{
+    if(cp < 0x80)
+    {
+        out[0] = cp;
+        return 1;
+    }
+    else if(cp < 0x800)
+    {
+        out[0] = 0xC0 | (cp >> 6);
+        out[1] = 0x80 | (cp & 0x3F);
+        return 2;
+    }
+    else if(cp < 0x10000)
+    {
+        out[0] = 0xE0 | (cp >> 12);
+        out[1] = 0x80 | ((cp >> 6) & 0x3F);
+        out[2] = 0x80 | (cp & 0x3F);
+        return 3;
+    }
+
+    out[0] = 0xF0 | (cp >> 18);
+    out[1] = 0x80 | ((cp >> 12) & 0x3F);
+    out[2] = 0x80 | ((cp >> 6) & 0x3F);
+    out[3] = 0x80 | (cp & 0x3F);
+
+    return 4;
+}
+
+/* Fold a single code point. If the code point is replaced with ASCII
+ * letters, they are pointed by ascii and their length is returned.
+ * Otherwise returns 0 and stores the folded code point to folded,
+ * -2 meaning that the code point is dropped.
+ */
+static int fold_codepoint(int32_t cp, const char **ascii, int32_t *folded)
+{
+    static const char *ligatures[] = { "ff", "fi", "fl", "ffi", "ffl", "st", "st" };
+
+    *ascii = NULL;
+    *folded = cp;
+
+    if(cp >= 'A' && cp <= 'Z')
+        *folded = cp + 32;
+    else if(cp >= 0xC0 && cp <= 0x17F)
+        *ascii = latin_table[cp - 0xC0];
+    else if(cp == 0xA0)
+        *ascii = " ";
+    else if(cp == 0xAA)
+        *ascii = "a";
+    else if(cp == 0xBA)
+        *ascii = "o";
+    else if(cp == 0xB2)
+        *ascii = "2";
+    else if(cp == 0xB3)
+        *ascii = "3";
+    else if(cp == 0xB9)
+        *ascii = "1";
+    else if(cp == 0xB5)
+        *folded = 0x3BC;
+    else if(cp >= 0x300 && cp <= 0x36F) /* Combining diacritical marks */
+        *folded = -2;
+    else if(cp >= 0x391 && cp <= 0x3A9)
+        *folded = cp + 32;
+    else if(cp == 0x386 || cp == 0x3AC)
+        *folded = 0x3B1;
+    else if(cp == 0x388 || cp == 0x3AD)
+        *folded = 0x3B5;
+    else if(cp == 0x389 || cp == 0x3AE)
+        *folded = 0x3B7;
+    else if(cp == 0x38A || cp == 0x3AF || cp == 0x390 || cp == 0x3AA || cp == 0x3CA)
+        *folded = 0x3B9;
+    else if(cp == 0x38C || cp == 0x3CC)
+        *folded = 0x3BF;
+    else if(cp == 0x38E || cp == 0x3CD || cp == 0x3B0 || cp == 0x3AB || cp == 0x3CB)
+        *folded = 0x3C5;
+    else if(cp == 0x38F || cp == 0x3CE)
+        *folded = 0x3C9;
+    else if(cp == 0x3C2)
+        *folded = 0x3C3;
+    else if(cp == 0x401 || cp == 0x451)
+        *folded = 0x435;
+    else if(cp >= 0x400 && cp <= 0x40F)
+        *folded = cp + 0x50;
+    else if(cp >= 0x410 && cp <= 0x42F)
+        *folded = cp + 32;
+    else if(cp == 0x1E9E)
+        *ascii = "ss";
+    else if(cp >= 0xFB00 && cp <= 0xFB06)
+        *ascii = ligatures[cp - 0xFB00];
+    else if(cp >= 0xFF01 && cp <= 0xFF5E) /* Fullwidth ASCII */
+    {
+        *folded = cp - 0xFF01 + 0x21;
+
+        if(*folded >= 'A' && *folded <= 'Z')
+            *folded += 32;
+    }
+
+    if(*ascii)
+        return strlen(*ascii);
+
+    return 0;
+}
+
+static char *fold(const char *text, bool keep_escapes)
+{
+    const unsigned char *p = (const unsigned char *)text;
+    /* Folded code point is never longer than the original one */
+    char *out = tmalloc(strlen(text) + 1);
+    char *o = out;
+    bool escaped = false;
+
+    while(*p)
+    {
+        int32_t cp;
+        int32_t folded;
+        const char *ascii;
+        int len = utf8_decode(p, &cp);
+
+        if(cp < 0)
+        {
+            *o++ = *p++;
+            escaped = false;
+            continue;
+        }
+
+        /* Regular expression escapes like \W must keep their case */
+        if(keep_escapes && escaped && cp < 0x80)
+        {
+            *o++ = *p++;
+            escaped = false;
+            continue;
+        }
+
+        escaped = keep_escapes && cp == '\\';
+
+        int n = fold_codepoint(cp, &ascii, &folded);
+
+        if(n > 0)
+        {
+            memcpy(o, ascii, n);
+            o += n;
+        }
+        else if(folded >= 0)
+        {
+            o += utf8_encode(folded, o);
+        }
+
+        p += len;
+    }
+
+    *o = '\0';
+
+    return out;
+}
+
+/* Returns case and accent folded copy of text.
+ * Caller must free the return value.
+ */
+char *fold_text(const char *text)
+{
+    return fold(text, false);
+}
+
+/* Same as fold_text, but leaves characters after backslash untouched
+ * so that the folded string is still the same regular expression.
+ * Caller must free the return value.
+ */
+char *fold_regex(const char *pattern)
+{
+    return fold(pattern, true);
+}
+
+/* Returns url reduced to the site it points to, so that
+ * "https://www.GitHub.com/login" and "github.com" give the same key.
+ * Scheme, user info, default ports, leading www., path, query and
+ * fragment are dropped and the host is lower cased. Returns NULL if url
+ * has no host.
+ * Caller must free the return value.
+ */
+char *fold_url(const char *url)
+{
+    const char *host = url + strspn(url, " \t");
+    const char *scheme = strstr(host, "://");
+
+    if(scheme && scheme < host + strcspn(host, "/?#"))
+        host = scheme + 3;
+
+    const char *host_end = host + strcspn(host, "/?# \t");
+
+    for(const char *p = host; p < host_end; p++)
+    {
+        if(*p == '@')
+            host = p + 1;
+    }
+
+    const char *port = memchr(host, ':', host_end - host);
+
+    if(port && ((host_end - port == 3 && strncmp(port, ":80", 3) == 0) ||
+                (host_end - port == 4 && strncmp(port, ":443", 4) == 0)))
+        host_end = port;
+
+    if(host_end - host > 4 && strncasecmp(host, "www.", 4) == 0)
+        host += 4;
+
+    while(host_end > host && host_end[-1] == '.')
+        host_end--;
+
+    if(host_end == host)
+        return NULL;
+
+    size_t len = host_end - host;
+    char *key = tmalloc(len + 1);
+
+    for(size_t i = 0; i < len; i++)
+        key[i] = tolower((unsigned char)host[i]);
+
+    key[len] = '\0';
+
+    return key;
+}
@@ -0,0 +1,12 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __FOLD_H
+#define __FOLD_H
+
+char *fold_text(const char *text);
+char *fold_regex(const char *pattern);
+char *fold_url(const char *url);
+
+#endif
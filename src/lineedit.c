@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "lineedit.h"
+#include "utils.h"
+
+#define KEY_CTRL(k) ((k) & 0x1F)
+#define LINE_MAX_LEN 4096
+
+/* Small line editor for the shell. Supports moving with arrow keys,
+ * Ctrl-A, Ctrl-E, Ctrl-B and Ctrl-F, history with up and down arrows
+ * or Ctrl-P and Ctrl-N, Ctrl-U and Ctrl-K to delete and Tab to complete
+ * the first word. When input is not a terminal lines are read as is.
+ */
+
+LineEdit_t *lineedit_new(const char **words)
+{
+    LineEdit_t *le = tmalloc(sizeof(LineEdit_t));
+
+    le->words = words;
+    le->history = NULL;
+    le->count = 0;
+    le->cap = 0;
+
+    return le;
+}
+
+void lineedit_free(LineEdit_t *le)
+{
+    if(!le)
+        return;
+
+    for(int i = 0; i < le->count; i++)
+        free(le->history[i]);
+
+    free(le->history);
+    free(le);
+}
+
+static void history_add(LineEdit_t *le, const char *line)
+{
+    if(line[0] == '\0')
+        return;
+
+    if(le->count > 0 && strcmp(le->history[le->count - 1], line) == 0)
+        return;
+
+    if(le->count == LINEEDIT_HISTORY_MAX)
+    {
+        free(le->history[0]);
+        memmove(le->history, le->history + 1, (le->count - 1) * sizeof(char *));
+        le->count--;
+    }
+
+    if(le->count == le->cap)
+    {
+        le->cap = le->cap ? le->cap * 2 : 32;
+        le->history = trealloc(le->history, le->cap * sizeof(char *));
+    }
+
+    le->history[le->count++] = strdup(line);
+}
+
+/* Waits for input. Returns 1 if there is input, 0 on timeout. */
+static int wait_input(int fd, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+    int rc = poll(&pfd, 1, timeout_ms > 0 ? timeout_ms : -1);
+
+    return rc == 0 ? 0 : 1;
+}
+
+/* Number of characters in len bytes of UTF-8 text */
+static int text_width(const char *text, size_t len)
+{
+    int width = 0;
+
+    for(size_t i = 0; i < len; i++)
+    {
+        if(((unsigned char)text[i] & 0xC0) != 0x80)
+            width++;
+    }
+
+    return width;
+}
+
+static void refresh(const char *prompt, const char *buf, size_t len, size_t pos)
+{
+    char out[LINE_MAX_LEN + 256];
+    int n = snprintf(out, sizeof(out), "\r%s%.*s\x1B[K", prompt, (int)len, buf);
+    int back = text_width(buf + pos, len - pos);
+
+    if(back > 0)
+        n += snprintf(out + n, sizeof(out) - n, "\x1B[%dD", back);
+
+    write(STDOUT_FILENO, out, n);
+}
+
+/* Completes the first word from the list of words. With many matches
+ * the common prefix is completed, or the matches are listed.
+ */
+static void complete(LineEdit_t *le, const char *prompt, char *buf, size_t *len, size_t *pos)
+{
+    const char *first = NULL;
+    size_t common = 0;
+    int matches = 0;
+
+    if(!le->words || memchr(buf, ' ', *pos) != NULL)
+        return;
+
+    for(int i = 0; le->words[i]; i++)
+    {
+        const char *word = le->words[i];
+
+        if(strncmp(word, buf, *pos) != 0)
+            continue;
+
+        if(!first)
+        {
+            first = word;
+            common = strlen(word);
+        }
+        else
+        {
+            size_t j = 0;
+
+            while(j < common && word[j] == first[j])
+                j++;
+
+            common = j;
+        }
+
+        matches++;
+    }
+
+    if(matches == 0)
+        return;
+
+    if(common > *pos || matches == 1)
+    {
+        size_t add = common - *pos + (matches == 1 ? 1 : 0);
+
+        if(*len + add >= LINE_MAX_LEN)
+            return;
+
+        memmove(buf + *pos + add, buf + *pos, *len - *pos);
+        memcpy(buf + *pos, first + *pos, common - *pos);
+
+        if(matches == 1)
+            buf[common] = ' ';
+
+        *len += add;
+        *pos += add;
+        return;
+    }
+
+    /* Nothing to add, show what is possible */
+    write(STDOUT_FILENO, "\r\n", 2);
+
+    for(int i = 0; le->words[i]; i++)
+    {
+        if(strncmp(le->words[i], buf, *pos) == 0)
+        {
+            write(STDOUT_FILENO, le->words[i], strlen(le->words[i]));
+            write(STDOUT_FILENO, "  ", 2);
+        }
+    }
+
+    write(STDOUT_FILENO, "\r\n", 2);
+    refresh(prompt, buf, *len, *pos);
+}
+
+/* Reads lines when input is not a terminal */
+static char *read_plain(int timeout_ms, bool *timed_out)
+{
+    char *line = NULL;
+    size_t size = 0;
+
+    if(wait_input(STDIN_FILENO, timeout_ms) == 0)
+    {
+        *timed_out = true;
+        return NULL;
+    }
+
+    ssize_t n = getline(&line, &size, stdin);
+
+    if(n == -1)
+    {
+        free(line);
+        return NULL;
+    }
+
+    if(n > 0 && line[n - 1] == '\n')
+        line[n - 1] = '\0';
+
+    return line;
+}
+
+/* Reads one line. Returns NULL on end of input or if nothing was typed
+ * in timeout_ms, which then sets timed_out. timeout_ms 0 waits forever.
+ * Caller must free the return value.
+ */
+char *lineedit_read(LineEdit_t *le, const char *prompt, int timeout_ms, bool *timed_out)
+{
+    struct termios old, raw;
+    char buf[LINE_MAX_LEN];
+    size_t len = 0;
+    size_t pos = 0;
+    int index = le->count;   /* Position in history, count is the new line */
+    char *result = NULL;
+    bool done = false;
+
+    *timed_out = false;
+
+    if(!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &old) != 0)
+    {
+        fputs(prompt, stdout);
+        fflush(stdout);
+
+        return read_plain(timeout_ms, timed_out);
+    }
+
+    raw = old;
+    raw.c_lflag &= ~(ECHO | ICANON | ISIG | IEXTEN);
+    raw.c_iflag &= ~(IXON | ICRNL);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+
+    fflush(stdout);
+    refresh(prompt, buf, len, pos);
+
+    while(!done)
+    {
+        unsigned char c;
+
+        if(wait_input(STDIN_FILENO, timeout_ms) == 0)
+        {
+            *timed_out = true;
+            break;
+        }
+
+        if(read(STDIN_FILENO, &c, 1) != 1)
+            break;
+
+        if(c == '\r' || c == '\n')
+        {
+            buf[len] = '\0';
+            result = strdup(buf);
+            done = true;
+        }
+        else if(c == KEY_CTRL('d'))
+        {
+            if(len == 0)
+                break;
+
+            if(pos < len)
+            {
+                size_t n = 1;
+
+                while(pos + n < len && ((unsigned char)buf[pos + n] & 0xC0) == 0x80)
+                    n++;
+
+                memmove(buf + pos, buf + pos + n, len - pos - n);
+                len -= n;
+            }
+        }
+        else if(c == KEY_CTRL('c'))
+        {
+            /* Cancel the line */
+            result = strdup("");
+            done = true;
+        }
+        else if(c == 0x7F || c == KEY_CTRL('h'))
+        {
+            size_t n = 0;
+
+            while(pos > n)
+            {
+                n++;
+
+                if(((unsigned char)buf[pos - n] & 0xC0) != 0x80)
+                    break;
+            }
+
+            memmove(buf + pos - n, buf + pos, len - pos);
+            pos -= n;
+            len -= n;
+        }
+        else if(c == KEY_CTRL('a'))
+        {
+            pos = 0;
+        }
+        else if(c == KEY_CTRL('e'))
+        {
+            pos = len;
+        }
+        else if(c == KEY_CTRL('u'))
+        {
+            memmove(buf, buf + pos, len - pos);
+            len -= pos;
+            pos = 0;
+        }
+        else if(c == KEY_CTRL('k'))
+        {
+            len = pos;
+        }
+        else if(c == '\t')
+        {
+            complete(le, prompt, buf, &len, &pos);
+        }
+        else if(c == 0x1B || c == KEY_CTRL('b') || c == KEY_CTRL('f') ||
+                c == KEY_CTRL('p') || c == KEY_CTRL('n'))
+        {
+            unsigned char seq[2] = { 0, 0 };
+
+            /* Arrow keys come as ESC [ A..D */
+            if(c == 0x1B)
+            {
+                if(wait_input(STDIN_FILENO, 50) == 0 || read(STDIN_FILENO, &seq[0], 1) != 1 ||
+                   seq[0] != '[' || read(STDIN_FILENO, &seq[1], 1) != 1)
+                    continue;
+
+                c = seq[1];
+            }
+
+            if(c == 'D' || c == KEY_CTRL('b'))
+            {
+                while(pos > 0)
+                {
+                    pos--;
+
+                    if(((unsigned char)buf[pos] & 0xC0) != 0x80)
+                        break;
+                }
+            }
+            else if(c == 'C' || c == KEY_CTRL('f'))
+            {
+                while(pos < len)
+                {
+                    pos++;
+
+                    if(pos == len || ((unsigned char)buf[pos] & 0xC0) != 0x80)
+                        break;
+                }
+            }
+            else if((c == 'A' || c == KEY_CTRL('p')) && index > 0)
+            {
+                index--;
+                len = strlen(le->history[index]);
+                memcpy(buf, le->history[index], len);
+                pos = len;
+            }
+            else if((c == 'B' || c == KEY_CTRL('n')) && index < le->count)
+            {
+                index++;
+                len = index < le->count ? strlen(le->history[index]) : 0;
+                memcpy(buf, index < le->count ? le->history[index] : "", len);
+                pos = len;
+            }
+            else if(c == 'H')
+            {
+                pos = 0;
+            }
+            else if(c == 'F')
+            {
+                pos = len;
+            }
+        }
+        else if(c >= 0x20 && len + 1 < LINE_MAX_LEN)
+        {
+            memmove(buf + pos + 1, buf + pos, len - pos);
+            buf[pos++] = c;
+            len++;
+        }
+
+        if(!done)
+            refresh(prompt, buf, len, pos);
+    }
+
+    write(STDOUT_FILENO, "\r\n", 2);
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &old);
+
+    if(result)
+        history_add(le, result);
+
+    return result;
+}
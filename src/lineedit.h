@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __LINEEDIT_H
+#define __LINEEDIT_H
+
+#include <stdbool.h>
+
+#define LINEEDIT_HISTORY_MAX 500
+
+/* History is kept in memory only, it is never written to disk */
+typedef struct _line_edit
+{
+    const char **words;    /* NULL terminated words for completion */
+    char **history;
+    int count;
+    int cap;
+
+} LineEdit_t;
+
+LineEdit_t *lineedit_new(const char **words);
+char *lineedit_read(LineEdit_t *le, const char *prompt, int timeout_ms, bool *timed_out);
+void lineedit_free(LineEdit_t *le);
+
+#endif
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include "lock.h"
+#include "utils.h"
+
+/* Ylva processes of the same user coordinate through an advisory lock on
+ * ~/.ylva.lock, each profile has its own. Everything that reads or writes
+ * the decrypted database holds it shared, so any number of processes can
+ * work at the same time and sqlite serializes their writes. Decrypting,
+ * encrypting and switching databases replace files under the readers, so
+ * they hold it exclusively. A process keeps its shared lock until it
+ * exits.
+ */
+
+/* How long to wait for the lock before giving up */
+#define LOCK_TIMEOUT_MS 10000
+
+/* How long sqlite waits for another connection to finish writing */
+#define BUSY_TIMEOUT_MS 5000
+
+/* Longest sleep between tries */
+#define LOCK_MAX_SLEEP_MS 50
+
+typedef struct _lock_stats
+{
+    int vault_waits;
+    double vault_ms;
+    int busy_waits;
+    double busy_ms;
+
+} Lock_stats_t;
+
+static int lock_fd = -1;
+static int lock_mode = VAULT_UNLOCKED;
+static Lock_stats_t stats;
+
+static double now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void sleep_ms(int ms)
+{
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+
+    nanosleep(&ts, NULL);
+}
+
+static bool open_lock_file()
+{
+    char *path = get_profile_filepath(".ylva.lock");
+
+    if(!path)
+    {
+        fprintf(stderr, "Unable to find home directory for the lock file.\n");
+        return false;
+    }
+
+    lock_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+    if(lock_fd == -1)
+        fprintf(stderr, "Unable to open %s: %s\n", path, strerror(errno));
+
+    free(path);
+
+    return lock_fd != -1;
+}
+
+/* Takes the lock with flock operation op, waiting at most LOCK_TIMEOUT_MS */
+static bool take_lock(int op)
+{
+    if(flock(lock_fd, op | LOCK_NB) == 0)
+        return true;
+
+    if(errno != EWOULDBLOCK)
+    {
+        fprintf(stderr, "Unable to lock the database: %s\n", strerror(errno));
+        return false;
+    }
+
+    double start = now_ms();
+    int delay = 1;
+    bool ok = false;
+
+    stats.vault_waits++;
+
+    while(now_ms() - start < LOCK_TIMEOUT_MS)
+    {
+        sleep_ms(delay);
+
+        if(flock(lock_fd, op | LOCK_NB) == 0)
+        {
+            ok = true;
+            break;
+        }
+
+        if(delay < LOCK_MAX_SLEEP_MS)
+            delay *= 2;
+    }
+
+    stats.vault_ms += now_ms() - start;
+
+    if(!ok)
+        fprintf(stderr, "Database is in use by another ylva process.\n");
+
+    return ok;
+}
+
+/* Takes the vault lock in mode unless it is already held at least as
+ * strongly. Returns the mode held before, to be given to vault_unlock,
+ * or -1 if the lock could not be taken.
+ */
+int vault_lock(int mode)
+{
+    int previous = lock_mode;
+
+    if(mode <= lock_mode)
+        return previous;
+
+    if(lock_fd == -1 && !open_lock_file())
+        return -1;
+
+    /* Converting shared to exclusive drops the shared lock first, so two
+     * processes upgrading at the same time can't deadlock.
+     */
+    if(!take_lock(mode == VAULT_EXCLUSIVE ? LOCK_EX : LOCK_SH))
+    {
+        lock_mode = VAULT_UNLOCKED;
+        return -1;
+    }
+
+    lock_mode = mode;
+
+    return previous;
+}
+
+/* Returns to the mode vault_lock returned */
+void vault_unlock(int previous)
+{
+    if(previous < 0 || previous >= lock_mode)
+        return;
+
+    if(previous == VAULT_UNLOCKED)
+        flock(lock_fd, LOCK_UN);
+    else if(!take_lock(LOCK_SH))
+        previous = VAULT_UNLOCKED;
+
+    lock_mode = previous;
+}
+
+/* Releases the lock and closes the lock file, so that the next
+ * vault_lock uses the lock file of the current profile.
+ */
+void vault_close()
+{
+    if(lock_fd == -1)
+        return;
+
+    close(lock_fd);
+    lock_fd = -1;
+    lock_mode = VAULT_UNLOCKED;
+}
+
+/* sqlite busy handler. Like sqlite3_busy_timeout, but backs off less
+ * aggressively and keeps count of the time spent waiting.
+ */
+int lock_busy_handler(void *unused, int count)
+{
+    static int waited;
+    int delay = LOCK_MAX_SLEEP_MS;
+
+    (void)unused;
+
+    if(count == 0)
+    {
+        waited = 0;
+        stats.busy_waits++;
+    }
+
+    if(waited >= BUSY_TIMEOUT_MS)
+        return 0;
+
+    if(count < 6)
+        delay = 1 << count;
+
+    double start = now_ms();
+
+    sleep_ms(delay);
+    waited += delay;
+    stats.busy_ms += now_ms() - start;
+
+    return 1;
+}
+
+/* Prints time spent waiting for other processes to stderr if
+ * YLVA_LOCK_STATS is set.
+ */
+void lock_report()
+{
+    if(!getenv("YLVA_LOCK_STATS"))
+        return;
+
+    fprintf(stderr, "Lock waits: %d for the vault lock, %.1f ms, "
+            "%d for database writes, %.1f ms.\n",
+            stats.vault_waits, stats.vault_ms, stats.busy_waits, stats.busy_ms);
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __LOCK_H
+#define __LOCK_H
+
+#include <stdbool.h>
+
+#define VAULT_UNLOCKED  (0)
+#define VAULT_SHARED    (1)
+#define VAULT_EXCLUSIVE (2)
+
+int vault_lock(int mode);
+void vault_unlock(int previous);
+void vault_close();
+int lock_busy_handler(void *unused, int count);
+void lock_report();
+
+#endif
@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "entry.h"
+#include "scan.h"
+#include "fold.h"
+#include "utils.h"
+#include "pick.h"
+
+#define KEY_CTRL(k) ((k) & 0x1F)
+#define QUERY_MAX 256
+
+typedef struct _picker
+{
+    int fd;
+    const Scan_t *scan;
+    Entry_t **entries;
+
+    char query[QUERY_MAX];
+    char *folded;          /* Folded query the rows were filtered with */
+    size_t *rows;          /* Matching rows */
+    size_t count;
+    size_t selected;
+    size_t top;            /* First visible row */
+    double filter_ms;
+
+    char *screen;          /* Whole screen is built here and written at once */
+    size_t screen_len;
+    size_t screen_cap;
+
+} Picker_t;
+
+static double now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void screen_append(Picker_t *p, const char *data, size_t len)
+{
+    if(p->screen_len + len > p->screen_cap)
+    {
+        while(p->screen_len + len > p->screen_cap)
+            p->screen_cap *= 2;
+
+        p->screen = trealloc(p->screen, p->screen_cap);
+    }
+
+    memcpy(p->screen + p->screen_len, data, len);
+    p->screen_len += len;
+}
+
+static void screen_puts(Picker_t *p, const char *str)
+{
+    screen_append(p, str, strlen(str));
+}
+
+/* Append at most width characters of str, stopping at newlines */
+static int screen_put_clipped(Picker_t *p, const char *str, int width)
+{
+    const unsigned char *s = (const unsigned char *)str;
+    int used = 0;
+
+    while(*s && *s != '\n' && used < width)
+    {
+        int len = 1;
+
+        if(*s >= 0xF0)
+            len = 4;
+        else if(*s >= 0xE0)
+            len = 3;
+        else if(*s >= 0xC0)
+            len = 2;
+
+        if(strnlen((const char *)s, len) < (size_t)len)
+            break;
+
+        screen_append(p, (const char *)s, len);
+        s += len;
+        used++;
+    }
+
+    return used;
+}
+
+static void screen_pad(Picker_t *p, int count)
+{
+    for(int i = 0; i < count; i++)
+        screen_append(p, " ", 1);
+}
+
+static void get_window_size(int fd, int *rows, int *cols)
+{
+    struct winsize ws;
+
+    *rows = 24;
+    *cols = 80;
+
+    if(ioctl(fd, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0)
+    {
+        *rows = ws.ws_row;
+        *cols = ws.ws_col;
+    }
+}
+
+/* Filter rows with the current query. If the query only grew, the
+ * previous matches are refined instead of scanning all rows again.
+ */
+static void refilter(Picker_t *p)
+{
+    double start = now_ms();
+    char *folded = fold_text(p->query);
+
+    if(p->folded && strstr(folded, p->folded) != NULL)
+        p->count = scan_refine(p->scan, folded, p->rows, p->count);
+    else
+        p->count = scan_find(p->scan, folded, p->rows);
+
+    free(p->folded);
+    p->folded = folded;
+    p->selected = 0;
+    p->top = 0;
+    p->filter_ms = now_ms() - start;
+}
+
+static void draw(Picker_t *p)
+{
+    int rows, cols;
+    char line[128];
+
+    get_window_size(p->fd, &rows, &cols);
+
+    int visible = rows - 2;
+
+    if(visible < 1)
+        visible = 1;
+
+    if(p->selected < p->top)
+        p->top = p->selected;
+    else if(p->selected >= p->top + visible)
+        p->top = p->selected - visible + 1;
+
+    p->screen_len = 0;
+    screen_puts(p, "\x1B[H\x1B[2K> ");
+    int query_width = screen_put_clipped(p, p->query, cols - 3);
+
+    for(int i = 0; i < visible; i++)
+    {
+        size_t index = p->top + i;
+
+        screen_puts(p, "\r\n\x1B[2K");
+
+        if(index >= p->count)
+            continue;
+
+        Entry_t *entry = p->entries[p->rows[index]];
+
+        if(!entry)
+            continue;
+
+        if(index == p->selected)
+            screen_puts(p, "\x1B[7m");
+
+        int width = snprintf(line, sizeof(line), "%6d  ", entry->id);
+        screen_puts(p, line);
+
+        int left = cols - width;
+        int used = screen_put_clipped(p, entry->title, left < 30 ? left : 30);
+        screen_pad(p, (left < 30 ? left : 30) - used + 2);
+        left -= 32;
+
+        if(left > 0)
+        {
+            used = screen_put_clipped(p, entry->user, left < 20 ? left : 20);
+            screen_pad(p, (left < 20 ? left : 20) - used + 2);
+            left -= 22;
+        }
+
+        if(left > 0)
+            used = screen_put_clipped(p, entry->url, left);
+
+        if(index == p->selected)
+            screen_puts(p, COLOR_DEFAULT);
+    }
+
+    snprintf(line, sizeof(line), "\r\n\x1B[2K%zu/%zu  %.2f ms", p->count,
+             p->scan->count, p->filter_ms);
+    screen_puts(p, line);
+
+    /* Cursor back to the end of the query, counted in characters */
+    snprintf(line, sizeof(line), "\x1B[1;%dH", 3 + query_width);
+    screen_puts(p, line);
+
+    write(p->fd, p->screen, p->screen_len);
+}
+
+/* Remove the last UTF-8 character from the query */
+static void query_backspace(Picker_t *p)
+{
+    size_t len = strlen(p->query);
+
+    while(len > 0)
+    {
+        len--;
+
+        if(((unsigned char)p->query[len] & 0xC0) != 0x80)
+            break;
+    }
+
+    p->query[len] = '\0';
+}
+
+/* Runs full screen picker on the terminal. entries[i] is the entry
+ * of the scan row i. Returns the chosen row or -1 if user cancelled.
+ */
+int pick_run(const Scan_t *scan, Entry_t **entries)
+{
+    struct termios old, raw;
+    Picker_t p;
+    unsigned char buf[64];
+    int chosen = -1;
+    bool running = true;
+
+    memset(&p, 0, sizeof(p));
+
+    p.fd = open("/dev/tty", O_RDWR);
+
+    if(p.fd < 0)
+    {
+        fprintf(stderr, "Picker needs a terminal.\n");
+        return -1;
+    }
+
+    if(tcgetattr(p.fd, &old) != 0)
+    {
+        fprintf(stderr, "Picker needs a terminal.\n");
+        close(p.fd);
+        return -1;
+    }
+
+    raw = old;
+    raw.c_lflag &= ~(ECHO | ICANON | ISIG | IEXTEN);
+    raw.c_iflag &= ~(IXON | ICRNL);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(p.fd, TCSAFLUSH, &raw);
+
+    /* Alternate screen keeps the user's scrollback intact */
+    write(p.fd, "\x1B[?1049h", 8);
+
+    p.scan = scan;
+    p.entries = entries;
+    p.rows = tmalloc((scan->count + 1) * sizeof(size_t));
+    p.screen_cap = 16 * 1024;
+    p.screen = tmalloc(p.screen_cap);
+
+    refilter(&p);
+
+    while(running)
+    {
+        draw(&p);
+
+        ssize_t n = read(p.fd, buf, sizeof(buf));
+
+        if(n <= 0)
+            break;
+
+        bool changed = false;
+
+        for(ssize_t i = 0; i < n; i++)
+        {
+            unsigned char c = buf[i];
+
+            if(c == '\r' || c == '\n')
+            {
+                if(p.count > 0)
+                    chosen = p.rows[p.selected];
+
+                running = false;
+                break;
+            }
+            else if(c == 0x1B)
+            {
+                /* Arrow keys come as ESC [ A and ESC [ B, lonely ESC cancels */
+                if(i + 2 < n && buf[i + 1] == '[')
+                {
+                    if(buf[i + 2] == 'A' && p.selected > 0)
+                        p.selected--;
+                    else if(buf[i + 2] == 'B' && p.selected + 1 < p.count)
+                        p.selected++;
+
+                    i += 2;
+                    continue;
+                }
+
+                running = false;
+                break;
+            }
+            else if(c == KEY_CTRL('c') || c == KEY_CTRL('g'))
+            {
+                running = false;
+                break;
+            }
+            else if(c == KEY_CTRL('p'))
+            {
+                if(p.selected > 0)
+                    p.selected--;
+            }
+            else if(c == KEY_CTRL('n'))
+            {
+                if(p.selected + 1 < p.count)
+                    p.selected++;
+            }
+            else if(c == 0x7F || c == KEY_CTRL('h'))
+            {
+                query_backspace(&p);
+                changed = true;
+            }
+            else if(c == KEY_CTRL('u'))
+            {
+                p.query[0] = '\0';
+                changed = true;
+            }
+            else if(c >= 0x20)
+            {
+                size_t len = strlen(p.query);
+
+                if(len + 1 < QUERY_MAX)
+                {
+                    p.query[len] = c;
+                    p.query[len + 1] = '\0';
+                    changed = true;
+                }
+            }
+        }
+
+        /* Refilter once per read, even if many keys were pasted */
+        if(running && changed)
+            refilter(&p);
+    }
+
+    write(p.fd, "\x1B[?1049l", 8);
+    tcsetattr(p.fd, TCSAFLUSH, &old);
+    close(p.fd);
+
+    free(p.folded);
+    free(p.rows);
+    free(p.screen);
+
+    return chosen;
+}
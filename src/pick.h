@@ -0,0 +1,13 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __PICK_H
+#define __PICK_H
+
+#include "entry.h"
+#include "scan.h"
+
+int pick_run(const Scan_t *scan, Entry_t **entries);
+
+#endif
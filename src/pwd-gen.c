@@ -7,74 +7,218 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <unistd.h>
 #include <time.h>
 #include <string.h>
+#include <ctype.h>
 #include <openssl/err.h>
 #include <openssl/rand.h>
+#include <openssl/crypto.h>
+#include "pwd-gen.h"
+#include "wordlist.h"
 #include "utils.h"
+#include "securemem.h"
 
-/*Generates random number between 0 and max.
- *Function should generate uniform distribution.
+/* Random bytes are fetched from OpenSSL this many at a time */
+#define RAND_POOL_SIZE 4096
+
+/* Passwords are collected here before writing them out */
+#define OUTPUT_BUFFER_SIZE 65536
+
+static const char alpha[] = "abcdefghijklmnopqrstuvwxyz" \
+                            "ABCDEFGHIJKLMNOPQRSTUVWXYZ" \
+                            "0123456789?)(/%#!=";
+
+/* Buffered output of the bulk generators */
+typedef struct _output
+{
+    char buf[OUTPUT_BUFFER_SIZE];
+    size_t used;
+    FILE *fp;
+    bool ok;
+
+} Output_t;
+
+static unsigned char rand_pool[RAND_POOL_SIZE];
+static size_t rand_pool_pos = RAND_POOL_SIZE;
+static bool rand_checked = false;
+
+static void rand_refill()
+{
+    if(!rand_checked)
+    {
+        if(RAND_status() != 1)
+            fprintf(stderr, "Warning, random number generator not seeded.\n");
+
+        rand_checked = true;
+    }
+
+    if(RAND_bytes(rand_pool, sizeof(rand_pool)) != 1)
+    {
+        ERR_print_errors_fp(stderr);
+        abort();
+    }
+
+    rand_pool_pos = 0;
+}
+
+/* Returns count random bytes from the pool as a number */
+static uint32_t rand_take(int count)
+{
+    uint32_t r = 0;
+
+    for(int i = 0; i < count; i++)
+    {
+        if(rand_pool_pos == RAND_POOL_SIZE)
+            rand_refill();
+
+        r = (r << 8) | rand_pool[rand_pool_pos];
+
+        /* Used bytes are not left behind in memory */
+        rand_pool[rand_pool_pos++] = 0;
+    }
+
+    return r;
+}
+
+/* Generates random number between 0 and n - 1 with uniform distribution.
+ * Random numbers just wide enough for n are drawn and the ones past the
+ * last whole multiple of n are thrown away, so every result is equally
+ * likely and few draws are wasted.
  */
-static unsigned int rand_between(unsigned int min, unsigned int max)
+uint32_t rand_below(uint32_t n)
 {
+    int bytes = n <= 0x100 ? 1 : n <= 0x10000 ? 2 : 4;
+    uint64_t span = (uint64_t)1 << (bytes * 8);
+    uint64_t limit = span - span % n;
     uint32_t r;
-    const unsigned int range = 1 + max - min;
-    const unsigned int buckets = RAND_MAX / range;
-    const unsigned int limit = buckets * range;
-
-    /*Create equal size buckets all in a row, then fire randomly towards
-     *the buckets until you land in one of them. All buckets are equally
-     *likely. If you land off the end of the line of buckets, try again.
-     */
+
     do
     {
-        if(RAND_bytes((unsigned char *)&r, sizeof r) == 0)
-        {
-            ERR_print_errors_fp(stderr);
-            abort();
-        }
+        r = rand_take(bytes);
 
-    } while (r >= limit);
+    } while(r >= limit);
 
-    return min + (r / buckets);
+    return r % n;
 }
 
-/* Simply generate secure password
- * and output it to the stdout. Uses OpenSSL RAND_bytes.
+/* Generates secure password. Uses OpenSSL RAND_bytes.
  *
- * Caller must free the return value.
+ * Caller must free the return value with secure_free.
  */
 char *generate_password(int length)
 {
     if(length < 1 || length > RAND_MAX)
         return NULL;
 
-    char *pass = NULL;
-    char *alpha = "abcdefghijklmnopqrstuvwxyz" \
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZ" \
-    "0123456789?)(/%#!?)=";
-    unsigned int max;
-    unsigned int number;
+    char *pass = secure_alloc((length + 1) * sizeof(char));
 
-    RAND_poll();
+    for(int j = 0; j < length; j++)
+        pass[j] = alpha[rand_below(sizeof(alpha) - 1)];
 
-    if(RAND_status() != 1)
-        fprintf(stdout, "Warning, random number generator not seeded.\n");
+    pass[length] = '\0';
 
-    max = strlen(alpha) - 1;
-    pass = tmalloc((length + 1) * sizeof(char));
+    return pass;
+}
 
-    for(int j = 0; j < length; j++)
+static void output_flush(Output_t *out)
+{
+    if(out->ok && out->used > 0)
+        out->ok = fwrite(out->buf, 1, out->used, out->fp) == out->used;
+
+    out->used = 0;
+}
+
+static void output_char(Output_t *out, char c)
+{
+    if(out->used == sizeof(out->buf))
+        output_flush(out);
+
+    out->buf[out->used++] = c;
+}
+
+static void output_text(Output_t *out, const char *text)
+{
+    while(*text)
+        output_char(out, *text++);
+}
+
+/* Writes what is left and wipes the buffer. Returns false if
+ * anything failed to be written.
+ */
+static bool output_close(Output_t *out)
+{
+    output_flush(out);
+    OPENSSL_cleanse(out->buf, sizeof(out->buf));
+
+    if(!out->ok || fflush(out->fp) != 0)
     {
-        number = rand_between(0, max);
-        pass[j] = alpha[number];
+        fprintf(stderr, "Failed to write passwords.\n");
+        return false;
     }
 
-    pass[length] = '\0';
+    return true;
+}
 
-    fprintf(stdout, "%s\n", pass);
+/* Writes count passwords to out, one per line. Passwords are built
+ * straight into an output buffer which is written out when full.
+ */
+bool generate_passwords(int length, long count, FILE *out)
+{
+    Output_t output = { .used = 0, .fp = out, .ok = true };
 
-    return pass;
+    if(length < 1 || length > RAND_MAX || count < 0)
+        return false;
+
+    for(long i = 0; i < count && output.ok; i++)
+    {
+        for(int j = 0; j < length; j++)
+            output_char(&output, alpha[rand_below(sizeof(alpha) - 1)]);
+
+        output_char(&output, '\n');
+    }
+
+    return output_close(&output);
+}
+
+/* Writes one passphrase to output. Digit, if asked, is put after one of
+ * the words picked at random.
+ */
+static void passphrase_write(Output_t *out, const Passphrase_t *options)
+{
+    int digit_after = options->digit ? (int)rand_below(options->words) : -1;
+
+    for(int i = 0; i < options->words; i++)
+    {
+        const char *word = wordlist[rand_below(WORDLIST_SIZE)];
+
+        if(i > 0)
+            output_text(out, options->separator);
+
+        output_char(out, options->capitalize ? toupper(word[0]) : word[0]);
+        output_text(out, word + 1);
+
+        if(i == digit_after)
+            output_char(out, '0' + rand_below(10));
+    }
+}
+
+/* Writes count passphrases to out, one per line. Words are picked
+ * from the compiled in word list, see wordlist.c.
+ */
+bool generate_passphrases(const Passphrase_t *options, long count, FILE *out)
+{
+    Output_t output = { .used = 0, .fp = out, .ok = true };
+
+    if(options->words < 1 || options->words > PASSPHRASE_MAX_WORDS || count < 0)
+        return false;
+
+    for(long i = 0; i < count && output.ok; i++)
+    {
+        passphrase_write(&output, options);
+        output_char(&output, '\n');
+    }
+
+    return output_close(&output);
 }
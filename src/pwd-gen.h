@@ -5,6 +5,24 @@
 #ifndef __PWD_GEN_H
 #define __PWD_GEN_H
 
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PASSPHRASE_MAX_WORDS 64
+
+typedef struct _passphrase
+{
+    int words;
+    const char *separator;
+    int capitalize;     /* Capitalize the first letter of each word */
+    int digit;          /* Add a random digit after one of the words */
+
+} Passphrase_t;
+
+uint32_t rand_below(uint32_t n);
 char *generate_password(int length);
+bool generate_passwords(int length, long count, FILE *out);
+bool generate_passphrases(const Passphrase_t *options, long count, FILE *out);
 
 #endif
@@ -12,60 +12,161 @@
 #include "qr.h"
 #include "utils.h"
 
-// Prints the given QR Code to the console.
-static void printQr(const uint8_t qrcode[])
+#define QR_BORDER 4
+
+/* UTF-8 glyphs are at most three bytes */
+#define QR_GLYPH_MAX 3
+
+// Prints the given QR Code to the console, each module as two full
+// glyphs on its own line. Tall, but works with any font.
+static void printQrClassic(const uint8_t qrcode[], char *line)
 {
-    printf(QR_FG_COLOR QR_BG_COLOR);
+    int size = qrcodegen_getSize(qrcode);
 
+    for (int y = -QR_BORDER; y < size + QR_BORDER; y++) {
+        char *pos = line;
+
+        for (int x = -QR_BORDER; x < size + QR_BORDER; x++) {
+            const char *glyph = qrcodegen_getModule(qrcode, x, y) ? "\u2585\u2585" : "  ";
+            size_t len = strlen(glyph);
+
+            memcpy(pos, glyph, len);
+            pos += len;
+        }
+
+        *pos++ = '\n';
+        fwrite(line, 1, pos - line, stdout);
+    }
+}
+
+// Prints the given QR Code to the console packing two module rows into
+// each line with half block glyphs. Foreground draws the dark modules.
+static void printQrHalfBlock(const uint8_t qrcode[], char *line)
+{
+    static const char *glyphs[4] = { " ", "\u2584", "\u2580", "\u2588" };
     int size = qrcodegen_getSize(qrcode);
-    int border = 4;
 
-    printf("\n");
+    for (int y = -QR_BORDER; y < size + QR_BORDER; y += 2) {
+        char *pos = line;
 
-    for (int y = -border; y < size + border; y++) {
-        for (int x = -border; x < size + border; x++) {
-            fputs((qrcodegen_getModule(qrcode, x, y) ? "\u2585\u2585" : "  "), stdout);
+        for (int x = -QR_BORDER; x < size + QR_BORDER; x++) {
+            int top = qrcodegen_getModule(qrcode, x, y);
+            int bottom = y + 1 < size + QR_BORDER && qrcodegen_getModule(qrcode, x, y + 1);
+            const char *glyph = glyphs[top << 1 | bottom];
+            size_t len = strlen(glyph);
+
+            memcpy(pos, glyph, len);
+            pos += len;
         }
 
-        printf("\n");
+        *pos++ = '\n';
+        fwrite(line, 1, pos - line, stdout);
     }
+}
+
+// Prints the given QR Code to the console. Every line is built in a
+// buffer and written with one call.
+static void printQr(const uint8_t qrcode[], int style)
+{
+    int width = qrcodegen_getSize(qrcode) + 2 * QR_BORDER;
+    char *line = tmalloc(width * 2 * QR_GLYPH_MAX + 1);
+
+    printf(QR_FG_COLOR QR_BG_COLOR);
+    printf("\n");
+
+    if (style == QR_STYLE_CLASSIC)
+        printQrClassic(qrcode, line);
+    else
+        printQrHalfBlock(qrcode, line);
 
     printf(COLOR_DEFAULT);
     printf("\n");
+
+    free(line);
 }
 
-void print_entry_as_qr(Entry_t *entry)
+/* Parses comma separated list of field names to a QR_FIELD_* mask.
+ * Returns -1 if there is an unknown field.
+ */
+int qr_parse_fields(const char *fields)
 {
-    enum qrcodegen_Ecc error_level = qrcodegen_Ecc_LOW;
-    uint8_t qrcode[qrcodegen_BUFFER_LEN_MAX];
-    uint8_t tmp_buffer[qrcodegen_BUFFER_LEN_MAX];
+    static const char *names[] = { "title", "user", "url", "password", "notes" };
+    int mask = 0;
+    const char *s = fields;
+
+    while (*s) {
+        size_t len = strcspn(s, ",");
+        int found = -1;
+
+        for (int i = 0; i < 5; i++) {
+            if (strlen(names[i]) == len && strncmp(s, names[i], len) == 0)
+                found = i;
+        }
 
+        if (found == -1)
+            return -1;
+
+        mask |= 1 << found;
+        s += len;
+
+        if (*s == ',')
+            s++;
+    }
+
+    return mask == 0 ? -1 : mask;
+}
+
+/* Returns the text encoded to the QR code of an entry, every field
+ * in fields followed by a newline. Caller must free the return value.
+ */
+char *qr_entry_payload(Entry_t *entry, int fields)
+{
+    const char *values[] = { entry->title, entry->user, entry->url,
+                             entry->password, entry->notes };
+    size_t data_len = 1;
     char *data = NULL;
-    size_t data_len = strlen(entry->title) + strlen(entry->user) +
-                    strlen(entry->url) + strlen(entry->password) +
-                    strlen(entry->notes);
+    char *pos = NULL;
 
-    //Allocate space for the entry data plus five newline characters and for the \0
-    data_len += 6;
-    data = tmalloc((data_len) * sizeof(char));
+    for (int i = 0; i < 5; i++) {
+        if (fields & (1 << i))
+            data_len += strlen(values[i]) + 1;
+    }
 
-    if( (snprintf(data, data_len, "%s\n%s\n%s\n%s\n%s\n", entry->title,
-            entry->user, entry->url, entry->password, entry->notes) ) < 0 ) {
+    data = tmalloc(data_len * sizeof(char));
+    pos = data;
 
-            fprintf(stderr, "Unable to combine entry data.\n");
-            free(data);
-            return;
+    for (int i = 0; i < 5; i++) {
+        if (fields & (1 << i)) {
+            size_t len = strlen(values[i]);
+
+            memcpy(pos, values[i], len);
+            pos[len] = '\n';
+            pos += len + 1;
+        }
     }
 
+    *pos = '\0';
+
+    return data;
+}
+
+/* Style is QR_STYLE_HALF_BLOCK or QR_STYLE_CLASSIC */
+void print_entry_as_qr(Entry_t *entry, int style)
+{
+    enum qrcodegen_Ecc error_level = qrcodegen_Ecc_LOW;
+    uint8_t qrcode[qrcodegen_BUFFER_LEN_MAX];
+    uint8_t tmp_buffer[qrcodegen_BUFFER_LEN_MAX];
+
+    char *data = qr_entry_payload(entry, QR_FIELDS_ALL);
+
     bool ok = qrcodegen_encodeText(data, tmp_buffer, qrcode, error_level,
                                    qrcodegen_VERSION_MIN, qrcodegen_VERSION_MAX,
                                    qrcodegen_Mask_AUTO, true);
 
     if (ok)
-        printQr(qrcode);
+        printQr(qrcode, style);
     else
         fprintf(stderr, "Unable to generate QR code.\n");
 
     free(data);
 }
-
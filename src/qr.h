@@ -13,6 +13,20 @@
 //background color
 #define QR_BG_COLOR "\33[107m"
 
-void print_entry_as_qr(Entry_t *entry);
+//styles of the terminal output
+#define QR_STYLE_HALF_BLOCK (1)
+#define QR_STYLE_CLASSIC (2)
+
+//fields of the entry encoded to the code
+#define QR_FIELD_TITLE (1 << 0)
+#define QR_FIELD_USER (1 << 1)
+#define QR_FIELD_URL (1 << 2)
+#define QR_FIELD_PASSWORD (1 << 3)
+#define QR_FIELD_NOTES (1 << 4)
+#define QR_FIELDS_ALL (0x1F)
+
+int qr_parse_fields(const char *fields);
+char *qr_entry_payload(Entry_t *entry, int fields);
+void print_entry_as_qr(Entry_t *entry, int style);
 
 #endif
@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <qrcodegen/qrcodegen.h>
+#include "qrexport.h"
+#include "qr.h"
+#include "utils.h"
+
+#define QR_EXPORT_BORDER 4
+#define QR_EXPORT_MAX_THREADS 32
+
+/* Pixels per module in PNG files */
+#define QR_PNG_SCALE 8
+
+/* Largest stored deflate block */
+#define DEFLATE_BLOCK_MAX 65535
+
+typedef struct _buffer
+{
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+
+} Buffer_t;
+
+typedef struct _export_job
+{
+    Entry_t **entries;
+    size_t count;
+    size_t next;
+    const QrExport_t *options;
+    pthread_mutex_t lock;
+
+} ExportJob_t;
+
+typedef struct _worker
+{
+    pthread_t thread;
+    ExportJob_t *job;
+    size_t written;
+    size_t failed;
+    size_t bytes;
+
+} Worker_t;
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static double now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void buffer_append(Buffer_t *buf, const void *data, size_t len)
+{
+    if(buf->len + len > buf->cap)
+    {
+        while(buf->len + len > buf->cap)
+            buf->cap *= 2;
+
+        buf->data = trealloc(buf->data, buf->cap);
+    }
+
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+static void buffer_str(Buffer_t *buf, const char *str)
+{
+    buffer_append(buf, str, strlen(str));
+}
+
+static void buffer_u32(Buffer_t *buf, uint32_t value)
+{
+    uint8_t bytes[4] = { value >> 24, value >> 16, value >> 8, value };
+
+    buffer_append(buf, bytes, 4);
+}
+
+static void png_crc_init()
+{
+    for(uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t c = n;
+
+        for(int k = 0; k < 8; k++)
+            c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+
+        crc_table[n] = c;
+    }
+}
+
+static uint32_t png_crc32(const uint8_t *data, size_t len)
+{
+    uint32_t c = 0xFFFFFFFF;
+
+    for(size_t i = 0; i < len; i++)
+        c = crc_table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+
+    return c ^ 0xFFFFFFFF;
+}
+
+/* Sums can grow for 5552 bytes before they must be reduced */
+static uint32_t png_adler32(const uint8_t *data, size_t len)
+{
+    uint32_t a = 1;
+    uint32_t b = 0;
+
+    while(len > 0)
+    {
+        size_t n = len < 5552 ? len : 5552;
+
+        len -= n;
+
+        while(n-- > 0)
+        {
+            a += *data++;
+            b += a;
+        }
+
+        a %= 65521;
+        b %= 65521;
+    }
+
+    return (b << 16) | a;
+}
+
+static void png_chunk(Buffer_t *buf, const char *type, const uint8_t *data, size_t len)
+{
+    buffer_u32(buf, len);
+
+    size_t start = buf->len;
+
+    buffer_append(buf, type, 4);
+
+    if(len > 0)
+        buffer_append(buf, data, len);
+
+    buffer_u32(buf, png_crc32(buf->data + start, len + 4));
+}
+
+/* Writes the code as 1-bit grayscale PNG. Image data is stored in
+ * uncompressed deflate blocks, so no compression library is needed.
+ * Two colors at one bit per pixel keep the files small anyway.
+ */
+static void qr_to_png(const uint8_t qrcode[], Buffer_t *buf)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    int size = qrcodegen_getSize(qrcode);
+    uint32_t width = (size + 2 * QR_EXPORT_BORDER) * QR_PNG_SCALE;
+    size_t row_len = 1 + (width + 7) / 8;
+    size_t raw_len = row_len * width;
+    uint8_t *raw = tmalloc(raw_len);
+    uint8_t header[13];
+
+    /* Every row starts with filter type 0, white is 1. Each module row
+     * is drawn once and copied to the rest of its pixel rows.
+     */
+    memset(raw, 0xFF, raw_len);
+
+    for(uint32_t y = 0; y < width; y += QR_PNG_SCALE)
+    {
+        uint8_t *row = raw + y * row_len;
+        int my = (int)(y / QR_PNG_SCALE) - QR_EXPORT_BORDER;
+
+        row[0] = 0;
+
+        for(uint32_t x = 0; x < width; x++)
+        {
+            int mx = (int)(x / QR_PNG_SCALE) - QR_EXPORT_BORDER;
+
+            if(qrcodegen_getModule(qrcode, mx, my))
+                row[1 + x / 8] &= ~(0x80 >> (x % 8));
+        }
+
+        for(int i = 1; i < QR_PNG_SCALE; i++)
+            memcpy(row + i * row_len, row, row_len);
+    }
+
+    buffer_append(buf, signature, 8);
+
+    uint32_t fields[2] = { width, width };
+
+    for(int i = 0; i < 2; i++)
+    {
+        header[i * 4] = fields[i] >> 24;
+        header[i * 4 + 1] = fields[i] >> 16;
+        header[i * 4 + 2] = fields[i] >> 8;
+        header[i * 4 + 3] = fields[i];
+    }
+
+    header[8] = 1;   /* bit depth */
+    header[9] = 0;   /* grayscale */
+    header[10] = 0;  /* deflate */
+    header[11] = 0;  /* adaptive filtering */
+    header[12] = 0;  /* no interlace */
+    png_chunk(buf, "IHDR", header, sizeof(header));
+
+    /* zlib stream of stored blocks */
+    Buffer_t idat;
+
+    idat.cap = raw_len + raw_len / DEFLATE_BLOCK_MAX * 5 + 16;
+    idat.len = 0;
+    idat.data = tmalloc(idat.cap);
+
+    buffer_append(&idat, "\x78\x01", 2);
+
+    for(size_t pos = 0; pos < raw_len; pos += DEFLATE_BLOCK_MAX)
+    {
+        size_t len = raw_len - pos < DEFLATE_BLOCK_MAX ? raw_len - pos : DEFLATE_BLOCK_MAX;
+        uint8_t block[5] = { pos + len == raw_len, len & 0xFF, len >> 8,
+                             ~len & 0xFF, (~len >> 8) & 0xFF };
+
+        buffer_append(&idat, block, 5);
+        buffer_append(&idat, raw + pos, len);
+    }
+
+    buffer_u32(&idat, png_adler32(raw, raw_len));
+
+    png_chunk(buf, "IDAT", idat.data, idat.len);
+    png_chunk(buf, "IEND", NULL, 0);
+
+    free(idat.data);
+    free(raw);
+}
+
+/* One path with a square per dark module */
+static void qr_to_svg(const uint8_t qrcode[], Buffer_t *buf)
+{
+    int size = qrcodegen_getSize(qrcode);
+    char line[256];
+
+    snprintf(line, sizeof(line),
+             "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+             "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" "
+             "viewBox=\"0 0 %d %d\" stroke=\"none\">\n",
+             size + 2 * QR_EXPORT_BORDER, size + 2 * QR_EXPORT_BORDER);
+    buffer_str(buf, line);
+    buffer_str(buf, "<rect width=\"100%\" height=\"100%\" fill=\"#FFFFFF\"/>\n<path d=\"");
+
+    for(int y = 0; y < size; y++)
+    {
+        for(int x = 0; x < size; x++)
+        {
+            if(!qrcodegen_getModule(qrcode, x, y))
+                continue;
+
+            snprintf(line, sizeof(line), "M%d,%dh1v1h-1z",
+                     x + QR_EXPORT_BORDER, y + QR_EXPORT_BORDER);
+            buffer_str(buf, line);
+        }
+    }
+
+    buffer_str(buf, "\" fill=\"#000000\"/>\n</svg>\n");
+}
+
+/* Files contain passwords, so they are readable only by the owner */
+static bool write_file(const char *path, const uint8_t *data, size_t len)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    if(fd < 0)
+        return false;
+
+    while(len > 0)
+    {
+        ssize_t n = write(fd, data, len);
+
+        if(n < 0 && errno == EINTR)
+            continue;
+
+        if(n <= 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        data += n;
+        len -= n;
+    }
+
+    return close(fd) == 0;
+}
+
+static bool export_entry(Worker_t *worker, Entry_t *entry, Buffer_t *buf)
+{
+    const QrExport_t *options = worker->job->options;
+    uint8_t qrcode[qrcodegen_BUFFER_LEN_MAX];
+    uint8_t tmp_buffer[qrcodegen_BUFFER_LEN_MAX];
+    char path[4096];
+
+    char *data = qr_entry_payload(entry, options->fields);
+
+    bool ok = qrcodegen_encodeText(data, tmp_buffer, qrcode, options->ecc,
+                                   qrcodegen_VERSION_MIN, qrcodegen_VERSION_MAX,
+                                   qrcodegen_Mask_AUTO, true);
+
+    free(data);
+
+    if(!ok)
+    {
+        fprintf(stderr, "Entry %d does not fit in a QR code.\n", entry->id);
+        return false;
+    }
+
+    buf->len = 0;
+
+    if(options->format == QR_EXPORT_PNG)
+        qr_to_png(qrcode, buf);
+    else
+        qr_to_svg(qrcode, buf);
+
+    snprintf(path, sizeof(path), "%s/%d.%s", options->dir, entry->id,
+             options->format == QR_EXPORT_PNG ? "png" : "svg");
+
+    if(!write_file(path, buf->data, buf->len))
+    {
+        fprintf(stderr, "Unable to write %s.\n", path);
+        return false;
+    }
+
+    worker->bytes += buf->len;
+
+    return true;
+}
+
+static void *export_worker(void *arg)
+{
+    Worker_t *worker = arg;
+    ExportJob_t *job = worker->job;
+    Buffer_t buf;
+
+    buf.cap = 16 * 1024;
+    buf.len = 0;
+    buf.data = tmalloc(buf.cap);
+
+    while(true)
+    {
+        pthread_mutex_lock(&job->lock);
+        size_t index = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if(index >= job->count)
+            break;
+
+        if(export_entry(worker, job->entries[index], &buf))
+            worker->written++;
+        else
+            worker->failed++;
+    }
+
+    free(buf.data);
+
+    return NULL;
+}
+
+/* Returns QR_EXPORT_* matching the name or -1 if there is none */
+int qr_export_parse_format(const char *name)
+{
+    if(strcmp(name, "svg") == 0)
+        return QR_EXPORT_SVG;
+    else if(strcmp(name, "png") == 0)
+        return QR_EXPORT_PNG;
+
+    return -1;
+}
+
+/* Returns error correction level matching the name or -1 */
+int qr_export_parse_ecc(const char *name)
+{
+    if(strcmp(name, "low") == 0)
+        return qrcodegen_Ecc_LOW;
+    else if(strcmp(name, "medium") == 0)
+        return qrcodegen_Ecc_MEDIUM;
+    else if(strcmp(name, "quartile") == 0)
+        return qrcodegen_Ecc_QUARTILE;
+    else if(strcmp(name, "high") == 0)
+        return qrcodegen_Ecc_HIGH;
+
+    return -1;
+}
+
+/* Writes a QR code file of every entry to options->dir, which is
+ * created if it does not exist. Entries are encoded in parallel, one
+ * worker per CPU. Prints a summary and returns false if any failed.
+ */
+bool qr_export(Entry_t **entries, size_t count, const QrExport_t *options)
+{
+    ExportJob_t job;
+    Worker_t workers[QR_EXPORT_MAX_THREADS];
+    size_t written = 0;
+    size_t failed = 0;
+    size_t bytes = 0;
+
+    if(mkdir(options->dir, 0700) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Unable to create directory %s.\n", options->dir);
+        return false;
+    }
+
+    pthread_once(&crc_once, png_crc_init);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t nthreads = cpus > 0 ? (size_t)cpus : 1;
+
+    if(nthreads > QR_EXPORT_MAX_THREADS)
+        nthreads = QR_EXPORT_MAX_THREADS;
+
+    if(nthreads > count)
+        nthreads = count > 0 ? count : 1;
+
+    job.entries = entries;
+    job.count = count;
+    job.next = 0;
+    job.options = options;
+    pthread_mutex_init(&job.lock, NULL);
+
+    double start = now_ms();
+    size_t started = 0;
+
+    for(size_t i = 0; i < nthreads; i++)
+    {
+        memset(&workers[i], 0, sizeof(Worker_t));
+        workers[i].job = &job;
+
+        if(pthread_create(&workers[i].thread, NULL, export_worker, &workers[i]) != 0)
+            break;
+
+        started++;
+    }
+
+    /* Do the work here if no thread could be started */
+    if(started == 0)
+    {
+        memset(&workers[0], 0, sizeof(Worker_t));
+        workers[0].job = &job;
+        export_worker(&workers[0]);
+    }
+
+    for(size_t i = 0; i < started; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    for(size_t i = 0; i < (started > 0 ? started : 1); i++)
+    {
+        written += workers[i].written;
+        failed += workers[i].failed;
+        bytes += workers[i].bytes;
+    }
+
+    double elapsed = now_ms() - start;
+
+    pthread_mutex_destroy(&job.lock);
+
+    fprintf(stdout, "Exported %zu QR codes to %s in %.1f ms, %.0f codes/s, "
+            "%.1f MB/s, %zu threads.\n", written, options->dir, elapsed,
+            elapsed > 0 ? written * 1000.0 / elapsed : 0.0,
+            elapsed > 0 ? bytes / 1000.0 / elapsed : 0.0,
+            started > 0 ? started : 1);
+
+    if(failed > 0)
+        fprintf(stderr, "%zu entries failed.\n", failed);
+
+    return failed == 0;
+}
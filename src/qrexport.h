@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __QREXPORT_H
+#define __QREXPORT_H
+
+#include <stdbool.h>
+#include "entry.h"
+
+#define QR_EXPORT_SVG (0)
+#define QR_EXPORT_PNG (1)
+
+/* How the codes are written, see qr_export */
+typedef struct _qr_export
+{
+    const char *dir;
+    int format;      /* QR_EXPORT_SVG or QR_EXPORT_PNG */
+    int ecc;         /* enum qrcodegen_Ecc */
+    int fields;      /* QR_FIELD_* mask */
+
+} QrExport_t;
+
+int qr_export_parse_format(const char *name);
+int qr_export_parse_ecc(const char *name);
+bool qr_export(Entry_t **entries, size_t count, const QrExport_t *options);
+
+#endif
@@ -0,0 +1,537 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "query.h"
+#include "fold.h"
+#include "utils.h"
+
+/* Query syntax:
+ *
+ *   github                      any field contains "github"
+ *   title:github                title contains "github"
+ *   title:=github               title is exactly "github"
+ *   title:git*                  title starts with "git"
+ *   url:*.corp                  url matches the glob, * and ? are wildcards
+ *   "my bank"  title:"a b"      quoted values are taken literally
+ *   modified:>2024-01-01        also >=, <, <= and =
+ *   modified:2024-01            modified during the given period
+ *   a OR b, a AND b, a b        AND is implicit, NOT binds tighter, ( ) group
+ *
+ * Text is matched against the case and accent folded columns.
+ * Exact and prefix matches compile to comparisons that can use an index.
+ */
+
+typedef enum
+{
+    TOK_END,
+    TOK_LPAREN,
+    TOK_RPAREN,
+    TOK_AND,
+    TOK_OR,
+    TOK_NOT,
+    TOK_TERM
+
+} Token_t;
+
+typedef struct _parser
+{
+    const char *pos;
+
+    Token_t token;
+    char *field;
+    char *value;
+    bool quoted;
+
+    char *sql;
+    size_t len;
+    size_t cap;
+
+    char **params;
+    int count;
+    int params_cap;
+
+    char *error;
+
+} Parser_t;
+
+static const char *text_columns[] = { "title_fold", "user_fold", "url_fold", "notes_fold" };
+
+static const char *column_for_field(const char *field)
+{
+    if(strcmp(field, "title") == 0)
+        return "title_fold";
+    else if(strcmp(field, "user") == 0)
+        return "user_fold";
+    else if(strcmp(field, "url") == 0)
+        return "url_fold";
+    else if(strcmp(field, "notes") == 0)
+        return "notes_fold";
+    else if(strcmp(field, "modified") == 0)
+        return "timestamp";
+
+    return NULL;
+}
+
+static void set_error(Parser_t *p, const char *error)
+{
+    if(!p->error)
+        p->error = strdup(error);
+}
+
+static void emit(Parser_t *p, const char *sql)
+{
+    size_t len = strlen(sql);
+
+    if(p->len + len + 1 > p->cap)
+    {
+        while(p->len + len + 1 > p->cap)
+            p->cap *= 2;
+
+        p->sql = trealloc(p->sql, p->cap);
+    }
+
+    memcpy(p->sql + p->len, sql, len + 1);
+    p->len += len;
+}
+
+/* Adds a value to bind. Takes ownership of value. */
+static void add_param(Parser_t *p, char *value)
+{
+    if(p->count == p->params_cap)
+    {
+        p->params_cap = p->params_cap ? p->params_cap * 2 : 8;
+        p->params = trealloc(p->params, p->params_cap * sizeof(char *));
+    }
+
+    p->params[p->count++] = value;
+}
+
+static bool is_term_end(char c)
+{
+    return c == '\0' || c == ' ' || c == '\t' || c == '\n' || c == '(' || c == ')';
+}
+
+static void next_token(Parser_t *p)
+{
+    free(p->field);
+    free(p->value);
+    p->field = NULL;
+    p->value = NULL;
+    p->quoted = false;
+
+    while(*p->pos == ' ' || *p->pos == '\t' || *p->pos == '\n')
+        p->pos++;
+
+    if(*p->pos == '\0')
+    {
+        p->token = TOK_END;
+        return;
+    }
+
+    if(*p->pos == '(' || *p->pos == ')')
+    {
+        p->token = *p->pos == '(' ? TOK_LPAREN : TOK_RPAREN;
+        p->pos++;
+        return;
+    }
+
+    /* Optional field name */
+    const char *start = p->pos;
+    const char *s = start;
+
+    while(*s >= 'a' && *s <= 'z')
+        s++;
+
+    if(*s == ':' && s > start)
+    {
+        p->field = strndup(start, s - start);
+
+        if(!column_for_field(p->field))
+        {
+            set_error(p, "Unknown field");
+            p->token = TOK_END;
+            return;
+        }
+
+        p->pos = s + 1;
+    }
+
+    if(*p->pos == '"')
+    {
+        const char *end = strchr(p->pos + 1, '"');
+
+        if(!end)
+        {
+            set_error(p, "Missing closing quote");
+            p->token = TOK_END;
+            return;
+        }
+
+        p->value = strndup(p->pos + 1, end - p->pos - 1);
+        p->quoted = true;
+        p->pos = end + 1;
+    }
+    else
+    {
+        start = p->pos;
+
+        while(!is_term_end(*p->pos))
+            p->pos++;
+
+        p->value = strndup(start, p->pos - start);
+    }
+
+    p->token = TOK_TERM;
+
+    if(!p->field && !p->quoted)
+    {
+        if(strcmp(p->value, "AND") == 0)
+            p->token = TOK_AND;
+        else if(strcmp(p->value, "OR") == 0)
+            p->token = TOK_OR;
+        else if(strcmp(p->value, "NOT") == 0)
+            p->token = TOK_NOT;
+    }
+
+    if(p->token == TOK_TERM && p->value[0] == '\0')
+        set_error(p, "Missing value");
+}
+
+/* Upper bound for prefix match: prefix with the last byte incremented.
+ * Returns NULL if there is no such string.
+ */
+static char *prefix_upper_bound(const char *prefix)
+{
+    size_t len = strlen(prefix);
+    char *upper = strdup(prefix);
+
+    while(len > 0 && (unsigned char)upper[len - 1] == 0xFF)
+        upper[--len] = '\0';
+
+    if(len == 0)
+    {
+        free(upper);
+        return NULL;
+    }
+
+    upper[len - 1]++;
+
+    return upper;
+}
+
+/* Turns glob into LIKE pattern, escaping LIKE's own wildcards */
+static char *glob_to_like(const char *glob)
+{
+    char *like = tmalloc(strlen(glob) * 2 + 1);
+    char *o = like;
+
+    for(const char *s = glob; *s; s++)
+    {
+        if(*s == '*')
+            *o++ = '%';
+        else if(*s == '?')
+            *o++ = '_';
+        else
+        {
+            if(*s == '%' || *s == '_' || *s == '\\')
+                *o++ = '\\';
+
+            *o++ = *s;
+        }
+    }
+
+    *o = '\0';
+
+    return like;
+}
+
+/* Timestamp column has numeric affinity, so sqlite would compare a value
+ * like "2024" as a number and never match the stored text. Unary plus
+ * drops the affinity at the cost of not using the index.
+ */
+static const char *timestamp_column(const char *value)
+{
+    char *end;
+
+    strtod(value, &end);
+
+    if(end != value && *end == '\0')
+        return "+timestamp";
+
+    return "timestamp";
+}
+
+static void emit_prefix(Parser_t *p, const char *column, const char *prefix)
+{
+    char *upper = prefix_upper_bound(prefix);
+
+    if(prefix[0] == '\0')
+    {
+        emit(p, "1");
+    }
+    else if(upper)
+    {
+        emit(p, "(");
+        emit(p, column);
+        emit(p, " >= ? and ");
+        emit(p, column);
+        emit(p, " < ?)");
+        add_param(p, strdup(prefix));
+        add_param(p, upper);
+    }
+    else
+    {
+        char *like = glob_to_like(prefix);
+        size_t len = strlen(like);
+
+        like = trealloc(like, len + 2);
+        strcpy(like + len, "%");
+
+        emit(p, column);
+        emit(p, " like ? escape '\\'");
+        add_param(p, like);
+    }
+}
+
+/* A date names the whole period it covers, so "2024-01-01" is that day
+ * and "2024" that year. = matches the period, > and <= compare with its
+ * end and >= and < with its start.
+ */
+static void emit_modified(Parser_t *p, const char *value)
+{
+    const char *ops[] = { ">=", "<=", ">", "<", "=" };
+
+    for(int i = 0; i < 5; i++)
+    {
+        size_t len = strlen(ops[i]);
+
+        if(strncmp(value, ops[i], len) != 0)
+            continue;
+
+        const char *column = timestamp_column(value + len);
+        const char *op = ops[i];
+        char *bound = strdup(value + len);
+
+        if(op[0] == '=')
+        {
+            emit_prefix(p, column, bound);
+            free(bound);
+            return;
+        }
+
+        if((strcmp(op, ">") == 0 || strcmp(op, "<=") == 0))
+        {
+            char *end = prefix_upper_bound(bound);
+
+            if(end)
+            {
+                free(bound);
+                bound = end;
+                op = op[0] == '>' ? ">=" : "<";
+            }
+        }
+
+        emit(p, column);
+        emit(p, " ");
+        emit(p, op);
+        emit(p, " ?");
+        add_param(p, bound);
+        return;
+    }
+
+    emit_prefix(p, timestamp_column(value), value);
+}
+
+static void emit_text(Parser_t *p, const char *column, const char *value)
+{
+    char *folded = fold_text(value);
+    bool has_wildcards = !p->quoted && strpbrk(folded, "*?") != NULL;
+    size_t len = strlen(folded);
+
+    if(!p->quoted && folded[0] == '=')
+    {
+        emit(p, column);
+        emit(p, " = ?");
+        add_param(p, strdup(folded + 1));
+    }
+    else if(has_wildcards && strpbrk(folded, "*?") == folded + len - 1 &&
+            folded[len - 1] == '*')
+    {
+        folded[len - 1] = '\0';
+        emit_prefix(p, column, folded);
+    }
+    else if(has_wildcards)
+    {
+        emit(p, column);
+        emit(p, " like ? escape '\\'");
+        add_param(p, glob_to_like(folded));
+    }
+    else
+    {
+        emit(p, "ylva_contains(?, ");
+        emit(p, column);
+        emit(p, ")");
+        add_param(p, strdup(folded));
+    }
+
+    free(folded);
+}
+
+static void parse_term(Parser_t *p)
+{
+    emit(p, "(");
+
+    if(p->field && strcmp(p->field, "modified") == 0)
+    {
+        emit_modified(p, p->value);
+    }
+    else if(p->field)
+    {
+        emit_text(p, column_for_field(p->field), p->value);
+    }
+    else
+    {
+        /* No field given, match any of them */
+        for(int i = 0; i < 4; i++)
+        {
+            if(i > 0)
+                emit(p, " or ");
+
+            emit_text(p, text_columns[i], p->value);
+        }
+    }
+
+    emit(p, ")");
+    next_token(p);
+}
+
+static void parse_or(Parser_t *p);
+
+static void parse_unary(Parser_t *p)
+{
+    if(p->error)
+        return;
+
+    if(p->token == TOK_NOT)
+    {
+        emit(p, "not ");
+        next_token(p);
+        parse_unary(p);
+    }
+    else if(p->token == TOK_LPAREN)
+    {
+        emit(p, "(");
+        next_token(p);
+        parse_or(p);
+
+        if(p->token != TOK_RPAREN)
+        {
+            set_error(p, "Missing closing parenthesis");
+            return;
+        }
+
+        emit(p, ")");
+        next_token(p);
+    }
+    else if(p->token == TOK_TERM)
+    {
+        parse_term(p);
+    }
+    else
+    {
+        set_error(p, "Unexpected end of query");
+    }
+}
+
+static void parse_and(Parser_t *p)
+{
+    parse_unary(p);
+
+    while(!p->error && (p->token == TOK_AND || p->token == TOK_NOT ||
+                        p->token == TOK_LPAREN || p->token == TOK_TERM))
+    {
+        if(p->token == TOK_AND)
+            next_token(p);
+
+        emit(p, " and ");
+        parse_unary(p);
+    }
+}
+
+static void parse_or(Parser_t *p)
+{
+    parse_and(p);
+
+    while(!p->error && p->token == TOK_OR)
+    {
+        emit(p, " or ");
+        next_token(p);
+        parse_and(p);
+    }
+}
+
+/* Compiles query text to a where clause. Returns NULL and prints
+ * the reason if the query is invalid. Caller must free the return
+ * value with query_free.
+ */
+Query_t *query_compile(const char *text)
+{
+    Parser_t p;
+    Query_t *query = NULL;
+
+    memset(&p, 0, sizeof(p));
+    p.pos = text;
+    p.cap = 256;
+    p.sql = tmalloc(p.cap);
+    p.sql[0] = '\0';
+
+    next_token(&p);
+    parse_or(&p);
+
+    if(!p.error && p.token != TOK_END)
+        set_error(&p, "Unexpected closing parenthesis");
+
+    free(p.field);
+    free(p.value);
+
+    if(p.error)
+    {
+        fprintf(stderr, "Invalid query: %s.\n", p.error);
+        free(p.error);
+        free(p.sql);
+
+        for(int i = 0; i < p.count; i++)
+            free(p.params[i]);
+
+        free(p.params);
+
+        return NULL;
+    }
+
+    query = tmalloc(sizeof(Query_t));
+    query->where = p.sql;
+    query->params = p.params;
+    query->count = p.count;
+
+    return query;
+}
+
+void query_free(Query_t *query)
+{
+    if(!query)
+        return;
+
+    for(int i = 0; i < query->count; i++)
+        free(query->params[i]);
+
+    free(query->params);
+    free(query->where);
+    free(query);
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __QUERY_H
+#define __QUERY_H
+
+/* Query compiled to sql where clause with ? placeholders.
+ * params holds the values to bind, in order.
+ */
+typedef struct _query
+{
+    char *where;
+    char **params;
+    int count;
+
+} Query_t;
+
+Query_t *query_compile(const char *text);
+void query_free(Query_t *query);
+
+#endif
@@ -7,37 +7,73 @@
 #define _POSIX_C_SOURCE 200112L
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <regex.h>
-#include "entry.h"
-#include "utils.h"
+#include <sqlite3.h>
 #include "regexfind.h"
 
-void regex_find(Entry_t *head, const char *search, int show_password)
+static void regex_free(void *ptr)
 {
-    regex_t regex;
-    int retval;
+    regfree((regex_t *)ptr);
+    free(ptr);
+}
+
+/* Implements sql function ylva_regex(pattern, text, ignore_case).
+ * Compiled expression is cached by sqlite for the duration of the
+ * statement, so each pattern is compiled only once per search.
+ */
+static void sql_regex(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    regex_t *regex;
+    const char *text;
+
+    regex = sqlite3_get_auxdata(ctx, 0);
 
-    if(regcomp(&regex, search, REG_NOSUB) != 0)
+    if(!regex)
     {
-        fprintf(stderr, "Invalid regular expression.\n");
-        return;
+        const char *pattern = (const char *)sqlite3_value_text(argv[0]);
+        int flags = REG_NOSUB;
+
+        if(sqlite3_value_int(argv[2]) != 0)
+            flags |= REG_ICASE;
+
+        regex = malloc(sizeof(regex_t));
+
+        if(!regex || !pattern || regcomp(regex, pattern, flags) != 0)
+        {
+            free(regex);
+            sqlite3_result_error(ctx, "Invalid regular expression.", -1);
+            return;
+        }
+
+        sqlite3_set_auxdata(ctx, 0, regex, regex_free);
+
+        /* sqlite may have freed the data already */
+        regex = sqlite3_get_auxdata(ctx, 0);
+
+        if(!regex)
+        {
+            sqlite3_result_error_nomem(ctx);
+            return;
+        }
     }
 
-    while(head != NULL)
+    text = (const char *)sqlite3_value_text(argv[1]);
+
+    if(!text)
     {
-        if((retval = regexec(&regex, head->title, 0, NULL, 0)) == 0)
-            print_entry(head, show_password, 0);
-        else if((retval = regexec(&regex, head->user, 0, NULL, 0)) == 0)
-            print_entry(head, show_password, 0);
-        else if((retval = regexec(&regex, head->url, 0, NULL, 0)) == 0)
-            print_entry(head, show_password, 0);
-        else if((retval = regexec(&regex, head->notes, 0, NULL, 0)) == 0)
-            print_entry(head, show_password, 0);
-        else if((retval = regexec(&regex, head->stamp, 0, NULL, 0)) == 0)
-            print_entry(head, show_password, 0);
-
-        head = head->next;
+        sqlite3_result_int(ctx, 0);
+        return;
     }
 
-    regfree(&regex);
+    sqlite3_result_int(ctx, regexec(regex, text, 0, NULL, 0) == 0);
+}
+
+bool regex_register(sqlite3 *db)
+{
+    int rc = sqlite3_create_function(db, "ylva_regex", 3,
+                                     SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                     NULL, sql_regex, NULL, NULL);
+
+    return rc == SQLITE_OK;
 }
@@ -5,7 +5,9 @@
  #ifndef __REGEXFIND_H
  #define __REGEXFIND_H
 
-void regex_find(Entry_t *head, const char *search,
-    int show_password);
+#include <stdbool.h>
+#include <sqlite3.h>
+
+bool regex_register(sqlite3 *db);
 
  #endif
@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "entry.h"
+#include "render.h"
+#include "utils.h"
+#include "qr.h"
+#include "securemem.h"
+
+/* Buffer is written out when it grows past this */
+#define RENDER_FLUSH_SIZE (64 * 1024)
+
+#define SEPARATOR "=====================================================================\n"
+
+static const char *get_output_color()
+{
+    char *color = getenv("YLVA_COLOR");
+
+    if(color == NULL)
+        return COLOR_DEFAULT;
+
+    if(strcmp(color, "BLUE") == 0)
+        return "\x1B[34m";
+    else if(strcmp(color, "RED") == 0)
+        return "\x1B[31m";
+    else if(strcmp(color, "GREEN") == 0)
+        return "\x1B[32m";
+    else if(strcmp(color, "YELLOW") == 0)
+        return "\x1B[33m";
+    else if(strcmp(color, "MAGENTA") == 0)
+        return "\x1B[35m";
+    else if(strcmp(color, "CYAN") == 0)
+        return "\x1B[36m";
+    else if(strcmp(color, "WHITE") == 0)
+        return "\x1B[37m";
+    else
+        return COLOR_DEFAULT; /* Handle empty variable too */
+}
+
+static void append(Render_t *render, const char *data, size_t len)
+{
+    if(render->len + len > render->cap)
+    {
+        while(render->len + len > render->cap)
+            render->cap *= 2;
+
+        /* Buffer can hold passwords, grow it without leaving a copy */
+        char *grown = secure_alloc(render->cap);
+
+        memcpy(grown, render->buf, render->len);
+        secure_free(render->buf);
+        render->buf = grown;
+    }
+
+    memcpy(render->buf + render->len, data, len);
+    render->len += len;
+}
+
+static void append_str(Render_t *render, const char *str)
+{
+    append(render, str, strlen(str));
+}
+
+/* Fields that are NULL are left out, history records only have the
+ * fields that changed.
+ */
+static void append_field(Render_t *render, const char *label, const char *value)
+{
+    if(!value)
+        return;
+
+    append_str(render, label);
+    append_str(render, value);
+    append(render, "\n", 1);
+}
+
+/* JSON string with quotes, escaping quotes, backslashes and control
+ * characters. Runs of plain bytes are copied at once.
+ */
+static void append_json(Render_t *render, const char *value)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *start = value;
+    const char *s = value;
+    char esc[6] = { '\\', 'u', '0', '0', 0, 0 };
+
+    append(render, "\"", 1);
+
+    for(; *s; s++)
+    {
+        unsigned char c = *s;
+
+        if(c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        append(render, start, s - start);
+        start = s + 1;
+
+        if(c == '"')
+            append(render, "\\\"", 2);
+        else if(c == '\\')
+            append(render, "\\\\", 2);
+        else if(c == '\n')
+            append(render, "\\n", 2);
+        else if(c == '\t')
+            append(render, "\\t", 2);
+        else if(c == '\r')
+            append(render, "\\r", 2);
+        else
+        {
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0xF];
+            append(render, esc, 6);
+        }
+    }
+
+    append(render, start, s - start);
+    append(render, "\"", 1);
+}
+
+/* TSV field, tabs, newlines and backslashes are escaped so that
+ * every entry is exactly one line.
+ */
+static void append_tsv(Render_t *render, const char *value)
+{
+    const char *start = value;
+    const char *s = value;
+
+    for(; *s; s++)
+    {
+        const char *esc = NULL;
+
+        if(*s == '\t')
+            esc = "\\t";
+        else if(*s == '\n')
+            esc = "\\n";
+        else if(*s == '\r')
+            esc = "\\r";
+        else if(*s == '\\')
+            esc = "\\\\";
+        else
+            continue;
+
+        append(render, start, s - start);
+        append(render, esc, 2);
+        start = s + 1;
+    }
+
+    append(render, start, s - start);
+}
+
+static void render_human(Render_t *render, Entry_t *entry)
+{
+    char id[32];
+
+    append_str(render, SEPARATOR);
+
+    if(render->as_qrcode != 0)
+    {
+        /* QR code is printed directly, keep the output in order */
+        render_flush(render);
+        print_entry_as_qr(entry, render->as_qrcode);
+    }
+    else
+    {
+        /* Set the color */
+        append_str(render, render->color);
+
+        snprintf(id, sizeof(id), "ID: %d\n", entry->id);
+        append_str(render, id);
+        append_field(render, "Title: ", entry->title);
+        append_field(render, "User: ", entry->user);
+        append_field(render, "Url: ", entry->url);
+
+        if(render->show_password == 1)
+            append_field(render, "Password: ", entry->password);
+        else if(entry->password)
+            append_str(render, "Password: **********\n");
+
+        append_field(render, "Notes: ", entry->notes);
+        append_field(render, "Modified: ", entry->stamp);
+
+        /* Reset the color */
+        append_str(render, COLOR_DEFAULT);
+    }
+
+    append_str(render, SEPARATOR);
+}
+
+static void render_jsonl(Render_t *render, Entry_t *entry)
+{
+    char id[32];
+
+    snprintf(id, sizeof(id), "{\"id\":%d,\"title\":", entry->id);
+    append_str(render, id);
+    append_json(render, entry->title ? entry->title : "");
+    append_str(render, ",\"user\":");
+    append_json(render, entry->user ? entry->user : "");
+    append_str(render, ",\"url\":");
+    append_json(render, entry->url ? entry->url : "");
+    append_str(render, ",\"password\":");
+
+    if(render->show_password == 1)
+        append_json(render, entry->password ? entry->password : "");
+    else
+        append_str(render, "null");
+
+    append_str(render, ",\"notes\":");
+    append_json(render, entry->notes ? entry->notes : "");
+    append_str(render, ",\"modified\":");
+    append_json(render, entry->stamp ? entry->stamp : "");
+    append_str(render, "}\n");
+}
+
+/* Fields in the same order as in JSON, hidden password is empty.
+ * TSV ends every entry with a newline, nul format terminates every
+ * field with a NUL byte so each entry is exactly seven fields.
+ */
+static void render_fields(Render_t *render, Entry_t *entry)
+{
+    const char *fields[6] = { entry->title, entry->user, entry->url,
+                              render->show_password == 1 ? entry->password : "",
+                              entry->notes, entry->stamp };
+    bool tsv = render->format == OUTPUT_TSV;
+    char id[32];
+
+    snprintf(id, sizeof(id), "%d", entry->id);
+    append_str(render, id);
+    append(render, tsv ? "\t" : "", 1);
+
+    for(int i = 0; i < 6; i++)
+    {
+        const char *value = fields[i] ? fields[i] : "";
+
+        if(tsv)
+        {
+            append_tsv(render, value);
+            append(render, i < 5 ? "\t" : "\n", 1);
+        }
+        else
+        {
+            append(render, value, strlen(value) + 1);
+        }
+    }
+}
+
+/* Returns OUTPUT_* matching the name or -1 if there is none */
+int render_parse_format(const char *name)
+{
+    if(strcmp(name, "human") == 0)
+        return OUTPUT_HUMAN;
+    else if(strcmp(name, "jsonl") == 0)
+        return OUTPUT_JSONL;
+    else if(strcmp(name, "tsv") == 0)
+        return OUTPUT_TSV;
+    else if(strcmp(name, "nul") == 0)
+        return OUTPUT_NUL;
+
+    return -1;
+}
+
+Render_t *render_new(FILE *out, int format, int show_password, int as_qrcode)
+{
+    Render_t *render = tmalloc(sizeof(Render_t));
+
+    render->out = out;
+    render->format = format;
+    render->color = get_output_color();
+    render->show_password = show_password;
+    render->as_qrcode = as_qrcode;
+    render->cap = 4096;
+    render->len = 0;
+    render->buf = secure_alloc(render->cap);
+
+    return render;
+}
+
+/* Entry is formatted to the buffer right away, nothing is kept from it */
+void render_entry(Render_t *render, Entry_t *entry)
+{
+    if(render->format == OUTPUT_JSONL)
+    {
+        render_jsonl(render, entry);
+    }
+    else if(render->format == OUTPUT_TSV || render->format == OUTPUT_NUL)
+    {
+        render_fields(render, entry);
+    }
+    else
+    {
+        render_human(render, entry);
+    }
+
+    if(render->len >= RENDER_FLUSH_SIZE)
+        render_flush(render);
+}
+
+void render_flush(Render_t *render)
+{
+    if(render->len > 0)
+        fwrite(render->buf, 1, render->len, render->out);
+
+    render->len = 0;
+    fflush(render->out);
+}
+
+/* Flushes anything left in the buffer and frees the renderer */
+void render_free(Render_t *render)
+{
+    if(!render)
+        return;
+
+    render_flush(render);
+    secure_free(render->buf);
+    free(render);
+}
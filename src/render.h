@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __RENDER_H
+#define __RENDER_H
+
+#include <stdio.h>
+#include "entry.h"
+
+/* Output formats, see render_parse_format */
+#define OUTPUT_HUMAN (0)
+#define OUTPUT_JSONL (1)
+#define OUTPUT_TSV (2)
+#define OUTPUT_NUL (3)
+
+/* Formats entries into one big buffer and writes it out in large
+ * chunks. Color and flags are resolved once when the renderer is created.
+ */
+typedef struct _render
+{
+    FILE *out;
+    int format;
+    const char *color;
+    int show_password;
+    int as_qrcode;
+
+    char *buf;
+    size_t len;
+    size_t cap;
+
+} Render_t;
+
+int render_parse_format(const char *name);
+Render_t *render_new(FILE *out, int format, int show_password, int as_qrcode);
+void render_entry(Render_t *render, Entry_t *entry);
+void render_flush(Render_t *render);
+void render_free(Render_t *render);
+
+#endif
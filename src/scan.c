@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "scan.h"
+#include "utils.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define YLVA_SCAN_X86
+#include <immintrin.h>
+#endif
+
+Scan_t *scan_new()
+{
+    Scan_t *scan = tmalloc(sizeof(Scan_t));
+
+    scan->cap = 64 * 1024;
+    scan->len = 0;
+    scan->data = tmalloc(scan->cap);
+
+    scan->rows_cap = 1024;
+    scan->count = 0;
+    scan->ids = tmalloc(scan->rows_cap * sizeof(int));
+    scan->offsets = tmalloc((scan->rows_cap + 1) * sizeof(size_t));
+    scan->offsets[0] = 0;
+
+    return scan;
+}
+
+/* Appends a row of count fields. Lengths of the fields are given in lens,
+ * NULL fields are stored as empty strings.
+ */
+void scan_add_row(Scan_t *scan, int id, const char **fields,
+                  const size_t *lens, int count)
+{
+    size_t needed = count;
+
+    for(int i = 0; i < count; i++)
+        needed += lens[i];
+
+    if(scan->len + needed > scan->cap)
+    {
+        while(scan->len + needed > scan->cap)
+            scan->cap *= 2;
+
+        scan->data = trealloc(scan->data, scan->cap);
+    }
+
+    if(scan->count == scan->rows_cap)
+    {
+        scan->rows_cap *= 2;
+        scan->ids = trealloc(scan->ids, scan->rows_cap * sizeof(int));
+        scan->offsets = trealloc(scan->offsets, (scan->rows_cap + 1) * sizeof(size_t));
+    }
+
+    for(int i = 0; i < count; i++)
+    {
+        if(fields[i])
+        {
+            memcpy(scan->data + scan->len, fields[i], lens[i]);
+            scan->len += lens[i];
+        }
+
+        scan->data[scan->len++] = '\0';
+    }
+
+    scan->ids[scan->count] = id;
+    scan->count++;
+    scan->offsets[scan->count] = scan->len;
+}
+
+/* Portable version, also used for the tail of the vectorized ones */
+static const char *memmem_plain(const char *hay, size_t len, size_t start,
+                                const char *needle, size_t n)
+{
+    for(size_t i = start; i + n <= len; i++)
+    {
+        const char *p = memchr(hay + i, needle[0], len - n + 1 - i);
+
+        if(!p)
+            return NULL;
+
+        if(memcmp(p, needle, n) == 0)
+            return p;
+
+        i = p - hay;
+    }
+
+    return NULL;
+}
+
+#ifdef YLVA_SCAN_X86
+
+/* Filter candidate positions by comparing both the first and the last
+ * byte of the needle to a whole block of the haystack at once. Only
+ * positions where both match are verified with memcmp.
+ */
+__attribute__((target("avx2")))
+static const char *memmem_avx2(const char *hay, size_t len,
+                               const char *needle, size_t n)
+{
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+    size_t i = 0;
+
+    for(; i + n + 31 <= len; i += 32)
+    {
+        __m256i block_first = _mm256_loadu_si256((const __m256i *)(hay + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *)(hay + i + n - 1));
+        uint32_t mask = _mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                             _mm256_cmpeq_epi8(block_last, last)));
+
+        while(mask != 0)
+        {
+            int bit = __builtin_ctz(mask);
+
+            if(memcmp(hay + i + bit, needle, n) == 0)
+                return hay + i + bit;
+
+            mask &= mask - 1;
+        }
+    }
+
+    return memmem_plain(hay, len, i, needle, n);
+}
+
+__attribute__((target("sse2")))
+static const char *memmem_sse2(const char *hay, size_t len,
+                               const char *needle, size_t n)
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[n - 1]);
+    size_t i = 0;
+
+    for(; i + n + 15 <= len; i += 16)
+    {
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(hay + i + n - 1));
+        uint32_t mask = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                          _mm_cmpeq_epi8(block_last, last)));
+
+        while(mask != 0)
+        {
+            int bit = __builtin_ctz(mask);
+
+            if(memcmp(hay + i + bit, needle, n) == 0)
+                return hay + i + bit;
+
+            mask &= mask - 1;
+        }
+    }
+
+    return memmem_plain(hay, len, i, needle, n);
+}
+
+#endif
+
+/* Returns pointer to the first occurrence of needle in hay or NULL.
+ * Uses AVX2 or SSE2 when the CPU has them.
+ */
+const char *scan_memmem(const char *hay, size_t len, const char *needle, size_t n)
+{
+    if(n == 0)
+        return hay;
+
+    if(n > len)
+        return NULL;
+
+#ifdef YLVA_SCAN_X86
+    static int has_avx2 = -1;
+
+    if(has_avx2 == -1)
+    {
+        __builtin_cpu_init();
+        has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+
+    if(has_avx2)
+        return memmem_avx2(hay, len, needle, n);
+
+    if(__builtin_cpu_supports("sse2"))
+        return memmem_sse2(hay, len, needle, n);
+#endif
+
+    return memmem_plain(hay, len, 0, needle, n);
+}
+
+/* Stores indexes of the rows containing needle to rows, which must have
+ * room for scan->count items. Returns the number of matching rows.
+ * Case insensitive search is done by storing and searching folded text.
+ */
+size_t scan_find(const Scan_t *scan, const char *needle, size_t *rows)
+{
+    size_t n = strlen(needle);
+    size_t found = 0;
+    size_t row = 0;
+    size_t pos = 0;
+
+    if(n == 0)
+    {
+        for(size_t i = 0; i < scan->count; i++)
+            rows[i] = i;
+
+        return scan->count;
+    }
+
+    while(pos < scan->len)
+    {
+        const char *hit = scan_memmem(scan->data + pos, scan->len - pos, needle, n);
+
+        if(!hit)
+            break;
+
+        size_t offset = hit - scan->data;
+
+        while(scan->offsets[row + 1] <= offset)
+            row++;
+
+        rows[found++] = row;
+
+        /* One hit is enough, continue from the next row */
+        pos = scan->offsets[row + 1];
+        row++;
+    }
+
+    return found;
+}
+
+/* Same as scan_find, but only looks at the count rows listed in rows and
+ * keeps the matching ones. When the needle has only grown, the new matches
+ * are a subset of the old ones and there is no need to scan everything.
+ */
+size_t scan_refine(const Scan_t *scan, const char *needle, size_t *rows, size_t count)
+{
+    size_t n = strlen(needle);
+    size_t found = 0;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        size_t start = scan->offsets[rows[i]];
+        size_t len = scan->offsets[rows[i] + 1] - start;
+
+        if(scan_memmem(scan->data + start, len, needle, n))
+            rows[found++] = rows[i];
+    }
+
+    return found;
+}
+
+void scan_free(Scan_t *scan)
+{
+    if(!scan)
+        return;
+
+    free(scan->data);
+    free(scan->ids);
+    free(scan->offsets);
+    free(scan);
+}
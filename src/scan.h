@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __SCAN_H
+#define __SCAN_H
+
+#include <stddef.h>
+
+/* Searchable fields of many rows packed into one buffer.
+ * Each field is terminated by '\0', so a match never spans
+ * two fields or two rows.
+ */
+typedef struct _scan
+{
+    char *data;
+    size_t len;
+    size_t cap;
+
+    int *ids;
+    size_t *offsets; /* Start of each row in data, plus the end of data */
+    size_t count;
+    size_t rows_cap;
+
+} Scan_t;
+
+Scan_t *scan_new();
+void scan_add_row(Scan_t *scan, int id, const char **fields,
+                  const size_t *lens, int count);
+size_t scan_find(const Scan_t *scan, const char *needle, size_t *rows);
+size_t scan_refine(const Scan_t *scan, const char *needle, size_t *rows, size_t count);
+const char *scan_memmem(const char *hay, size_t len, const char *needle, size_t n);
+void scan_free(Scan_t *scan);
+
+#endif
@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <openssl/crypto.h>
+#include "securemem.h"
+#include "utils.h"
+
+/* Secrets are allocated from a pool that is locked to memory, so it is
+ * never swapped, and left out of core dumps. The pool sits between two
+ * inaccessible guard pages, so running over either end crashes instead
+ * of reading or writing other memory. Blocks are wiped when freed and
+ * the whole pool is wiped at exit.
+ *
+ * The pool is divided to chunks of SECURE_CHUNK bytes. A block is a run
+ * of chunks and the size of the run is kept outside of the pool. If the
+ * pool is full or can't be mapped, blocks come from the heap with the
+ * size in a header before them, and they are still wiped when freed.
+ */
+#define SECURE_POOL_SIZE (64 * 1024)
+#define SECURE_CHUNK 16
+#define SECURE_CHUNKS (SECURE_POOL_SIZE / SECURE_CHUNK)
+
+typedef struct _pool
+{
+    bool ready;
+    bool failed;
+    bool locked;
+    uint8_t *map;               /* Pool and the guard pages */
+    size_t map_len;
+    uint8_t *base;
+    uint16_t runs[SECURE_CHUNKS];   /* Chunks of the block starting here */
+    uint8_t used[SECURE_CHUNKS];
+    size_t free_chunks;
+    size_t next;                /* Where to start looking for free chunks */
+    size_t no_fit;              /* Blocks this large don't fit, 0 if unknown */
+
+    /* Statistics for secure_report */
+    long allocs;
+    long heap_allocs;
+    size_t in_use;
+    size_t peak;
+
+} Pool_t;
+
+typedef struct _heap_block
+{
+    size_t size;
+    size_t pad;                 /* Keeps the block aligned to 16 bytes */
+
+} Heap_block_t;
+
+static Pool_t pool;
+
+static void pool_wipe()
+{
+    if(!pool.ready)
+        return;
+
+    OPENSSL_cleanse(pool.base, SECURE_POOL_SIZE);
+
+    if(pool.locked)
+        munlock(pool.base, SECURE_POOL_SIZE);
+}
+
+static bool pool_init()
+{
+    long page = sysconf(_SC_PAGESIZE);
+
+    if(pool.ready || pool.failed)
+        return pool.ready;
+
+    if(page <= 0 || SECURE_POOL_SIZE % page != 0)
+        page = 4096;
+
+    pool.map_len = SECURE_POOL_SIZE + 2 * page;
+    pool.map = mmap(NULL, pool.map_len, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(pool.map == MAP_FAILED)
+    {
+        pool.failed = true;
+        return false;
+    }
+
+    pool.base = pool.map + page;
+
+    if(mprotect(pool.map, page, PROT_NONE) != 0 ||
+       mprotect(pool.base + SECURE_POOL_SIZE, page, PROT_NONE) != 0)
+    {
+        munmap(pool.map, pool.map_len);
+        pool.failed = true;
+        return false;
+    }
+
+    /* Works without the lock too, RLIMIT_MEMLOCK may be small */
+    pool.locked = mlock(pool.base, SECURE_POOL_SIZE) == 0;
+
+#ifdef MADV_DONTDUMP
+    madvise(pool.base, SECURE_POOL_SIZE, MADV_DONTDUMP);
+#endif
+
+    pool.free_chunks = SECURE_CHUNKS;
+    pool.ready = true;
+    atexit(pool_wipe);
+
+    return true;
+}
+
+/* Returns index of the first of count free chunks, or -1 */
+static long pool_find(size_t count)
+{
+    size_t run = 0;
+
+    /* Look from next to the end, then once from the start */
+    for(size_t n = 0; n < SECURE_CHUNKS + count; n++)
+    {
+        size_t i = (pool.next + n) % SECURE_CHUNKS;
+
+        if(i == 0)
+            run = 0;
+
+        if(pool.used[i])
+        {
+            run = 0;
+            continue;
+        }
+
+        if(++run == count)
+            return i + 1 - count;
+    }
+
+    return -1;
+}
+
+static void *pool_alloc(size_t size)
+{
+    size_t count = (size + SECURE_CHUNK - 1) / SECURE_CHUNK;
+
+    if(count == 0)
+        count = 1;
+
+    if(!pool_init() || count > pool.free_chunks || (pool.no_fit && count >= pool.no_fit))
+        return NULL;
+
+    long start = pool_find(count);
+
+    /* Full pool is not searched again until something is freed */
+    if(start == -1)
+    {
+        pool.no_fit = count;
+        return NULL;
+    }
+
+    memset(pool.used + start, 1, count);
+    pool.runs[start] = count;
+    pool.free_chunks -= count;
+    pool.next = start + count;
+    pool.in_use += count * SECURE_CHUNK;
+
+    if(pool.in_use > pool.peak)
+        pool.peak = pool.in_use;
+
+    return pool.base + start * SECURE_CHUNK;
+}
+
+static bool in_pool(const void *ptr)
+{
+    return pool.ready && (const uint8_t *)ptr >= pool.base &&
+           (const uint8_t *)ptr < pool.base + SECURE_POOL_SIZE;
+}
+
+/* Allocates size bytes of zeroed memory for secrets. Never returns
+ * NULL. Free the memory with secure_free.
+ */
+void *secure_alloc(size_t size)
+{
+    void *ptr = pool_alloc(size);
+
+    pool.allocs++;
+
+    if(ptr)
+        return ptr;
+
+    Heap_block_t *block = tmalloc(sizeof(Heap_block_t) + size);
+
+    pool.heap_allocs++;
+    block->size = size;
+    memset(block + 1, 0, size);
+
+    return block + 1;
+}
+
+char *secure_strdup(const char *text)
+{
+    size_t len = strlen(text) + 1;
+    char *copy = secure_alloc(len);
+
+    memcpy(copy, text, len);
+
+    return copy;
+}
+
+/* Wipes and frees memory from secure_alloc. The whole block is wiped,
+ * whatever was written to it.
+ */
+void secure_free(void *ptr)
+{
+    if(!ptr)
+        return;
+
+    if(in_pool(ptr))
+    {
+        size_t start = ((uint8_t *)ptr - pool.base) / SECURE_CHUNK;
+        size_t count = pool.runs[start];
+
+        OPENSSL_cleanse(ptr, count * SECURE_CHUNK);
+        memset(pool.used + start, 0, count);
+        pool.runs[start] = 0;
+        pool.free_chunks += count;
+        pool.in_use -= count * SECURE_CHUNK;
+        pool.no_fit = 0;
+
+        /* Reuse the space first, it keeps the pool compact */
+        if(start < pool.next)
+            pool.next = start;
+
+        return;
+    }
+
+    Heap_block_t *block = (Heap_block_t *)ptr - 1;
+
+    OPENSSL_cleanse(block, sizeof(Heap_block_t) + block->size);
+    free(block);
+}
+
+/* Prints use of the pool to stderr if YLVA_SECMEM_STATS is set */
+void secure_report()
+{
+    if(!getenv("YLVA_SECMEM_STATS"))
+        return;
+
+    fprintf(stderr, "Secure memory: %ld allocations, %ld from the heap, "
+            "peak %zu of %d bytes, %s.\n", pool.allocs, pool.heap_allocs,
+            pool.peak, SECURE_POOL_SIZE, pool.locked ? "locked" : "not locked");
+}
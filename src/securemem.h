@@ -0,0 +1,15 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __SECUREMEM_H
+#define __SECUREMEM_H
+
+#include <stddef.h>
+
+void *secure_alloc(size_t size);
+char *secure_strdup(const char *text);
+void secure_free(void *ptr);
+void secure_report();
+
+#endif
@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include "shell.h"
+#include "cmd_ui.h"
+#include "db.h"
+#include "utils.h"
+#include "render.h"
+#include "qr.h"
+#include "pwd-gen.h"
+#include "lineedit.h"
+#include "securemem.h"
+
+/* Seconds without input before the shell locks the database */
+#define SHELL_DEFAULT_TIMEOUT 300
+
+/* Longer timeouts are cut to a day, in milliseconds it still fits an int */
+#define SHELL_MAX_TIMEOUT 86400
+
+typedef struct _shell
+{
+    int show_password;
+    int format;
+
+} Shell_t;
+
+static const char *commands[] =
+{
+    "add", "edit", "rm", "get", "find", "regex", "query", "list",
+    "latest", "gen", "qr", "help", "quit", "exit", NULL
+};
+
+#define SHELL_HELP "\
+    add                    Add new entry\n\
+    edit     <id>          Edit entry\n\
+    rm       <id>          Remove entry\n\
+    get      <id>          Show entry\n\
+    find     <search>      Search entries\n\
+    regex    <search>      Search entries with regular expressions\n\
+    query    <query>       Search entries with a query\n\
+    list                   List all entries\n\
+    latest   [count]       Show latest entries\n\
+    gen      [length]      Generate password\n\
+    qr       <id>          Show entry as QR code\n\
+    help                   Show this help\n\
+    quit                   Encrypt the database and exit\n\
+"
+
+/* Returns the idle timeout in seconds, 0 if it is disabled. Values that
+ * are not a number of seconds fall back to the default, so a typo never
+ * leaves the database open forever.
+ */
+static int get_timeout()
+{
+    char *timeout = getenv("YLVA_SHELL_TIMEOUT");
+    char *end = NULL;
+
+    if(timeout == NULL || timeout[0] == '\0')
+        return SHELL_DEFAULT_TIMEOUT;
+
+    long seconds = strtol(timeout, &end, 10);
+
+    if(end == timeout || *end != '\0' || seconds < 0)
+    {
+        fprintf(stderr, "Invalid YLVA_SHELL_TIMEOUT %s, using %d seconds.\n",
+                timeout, SHELL_DEFAULT_TIMEOUT);
+        return SHELL_DEFAULT_TIMEOUT;
+    }
+
+    return seconds > SHELL_MAX_TIMEOUT ? SHELL_MAX_TIMEOUT : seconds;
+}
+
+/* Parses id argument, prints error and returns -1 if it is invalid */
+static int parse_id(const char *arg)
+{
+    char *end = NULL;
+    long id = strtol(arg, &end, 10);
+
+    if(end == arg || *end != '\0' || id < 0)
+    {
+        fprintf(stderr, "Expected an id.\n");
+        return -1;
+    }
+
+    return id;
+}
+
+/* Parses password length argument, prints error and returns -1 if it is
+ * invalid. Empty argument gives the default length.
+ */
+static int parse_length(const char *arg)
+{
+    char *end = NULL;
+
+    if(arg[0] == '\0')
+        return 20;
+
+    long length = strtol(arg, &end, 10);
+
+    if(end == arg || *end != '\0' || length < 1 || length > INT_MAX)
+    {
+        fprintf(stderr, "Invalid password length.\n");
+        return -1;
+    }
+
+    return length;
+}
+
+/* Runs one command, returns false when the shell should exit */
+static bool run_command(Shell_t *shell, char *line)
+{
+    char *cmd = line + strspn(line, " \t");
+    char *arg = cmd + strcspn(cmd, " \t");
+    int id;
+
+    if(*arg != '\0')
+    {
+        *arg++ = '\0';
+        arg += strspn(arg, " \t");
+    }
+
+    /* Trailing white space is not part of the argument */
+    size_t len = strlen(arg);
+
+    while(len > 0 && (arg[len - 1] == ' ' || arg[len - 1] == '\t'))
+        arg[--len] = '\0';
+
+    if(cmd[0] == '\0')
+        return true;
+
+    if(strcmp(cmd, "quit") == 0 || strcmp(cmd, "exit") == 0)
+    {
+        return false;
+    }
+    else if(strcmp(cmd, "help") == 0)
+    {
+        printf(SHELL_HELP);
+    }
+    else if(strcmp(cmd, "add") == 0)
+    {
+        add_new_entry();
+    }
+    else if(strcmp(cmd, "edit") == 0)
+    {
+        if((id = parse_id(arg)) != -1)
+            edit_entry(id);
+    }
+    else if(strcmp(cmd, "rm") == 0)
+    {
+        if((id = parse_id(arg)) != -1)
+            remove_entry(id);
+    }
+    else if(strcmp(cmd, "get") == 0)
+    {
+        if((id = parse_id(arg)) != -1)
+            list_by_id(id, shell->show_password, 0, shell->format);
+    }
+    else if(strcmp(cmd, "qr") == 0)
+    {
+        if((id = parse_id(arg)) != -1)
+            list_by_id(id, shell->show_password, QR_STYLE_HALF_BLOCK, OUTPUT_HUMAN);
+    }
+    else if(strcmp(cmd, "find") == 0)
+    {
+        find(arg, shell->show_password, shell->format);
+    }
+    else if(strcmp(cmd, "regex") == 0)
+    {
+        find_regex(arg, shell->show_password, 0, shell->format);
+    }
+    else if(strcmp(cmd, "query") == 0)
+    {
+        find_query(arg, shell->show_password, shell->format);
+    }
+    else if(strcmp(cmd, "list") == 0)
+    {
+        list_all(shell->show_password, -1, shell->format);
+    }
+    else if(strcmp(cmd, "latest") == 0)
+    {
+        show_latest_entries(shell->show_password, arg[0] ? atoi(arg) : -2,
+                            shell->format);
+    }
+    else if(strcmp(cmd, "gen") == 0)
+    {
+        int length = parse_length(arg);
+        char *pass = length != -1 ? generate_password(length) : NULL;
+
+        if(pass != NULL)
+        {
+            fprintf(stdout, "%s\n", pass);
+            secure_free(pass);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Unknown command %s, type help for the commands.\n", cmd);
+    }
+
+    return true;
+}
+
+/* Unlocks the database once and runs commands until quit, end of input
+ * or idle timeout, then encrypts the database again with the same
+ * password. If path is NULL, the active database is used and the
+ * password to encrypt it with is asked first.
+ */
+bool run_shell(const char *path, int show_password, int format)
+{
+    Shell_t shell = { show_password, format };
+    char *pass = NULL;
+    int timeout = get_timeout();
+    bool timed_out = false;
+
+    /* The idle timeout polls standard input, which cannot see lines stdio
+     * has already read ahead into its buffer, so read it unbuffered from
+     * the password prompt on.
+     */
+    setvbuf(stdin, NULL, _IONBF, 0);
+
+    if(path)
+    {
+        if(has_active_database())
+        {
+            fprintf(stderr, "Existing database is already active. "
+                    "Encrypt it before decrypting another one.\n");
+            return false;
+        }
+
+        pass = read_password("Password: ", false);
+
+        if(!decrypt_database_with(path, pass))
+        {
+            secure_free(pass);
+            return false;
+        }
+    }
+    else
+    {
+        if(!has_active_database())
+        {
+            fprintf(stderr, "No decrypted database found.\n");
+            return false;
+        }
+
+        fprintf(stdout, "Type password to encrypt the database when the shell exits.\n");
+        pass = read_password("Password: ", true);
+
+        if(!pass)
+            return false;
+    }
+
+    if(db_session_open())
+    {
+        LineEdit_t *le = lineedit_new(commands);
+        char *line = NULL;
+
+        while((line = lineedit_read(le, "ylva> ", timeout * 1000, &timed_out)) != NULL)
+        {
+            bool more = run_command(&shell, line);
+
+            free(line);
+            fflush(stdout);
+
+            if(!more)
+                break;
+        }
+
+        if(timed_out)
+            fprintf(stdout, "\nNo input for %d seconds.\n", timeout);
+
+        lineedit_free(le);
+        db_session_close();
+    }
+
+    fprintf(stdout, "Encrypting the database.\n");
+
+    bool ok = encrypt_database_with(pass);
+
+    secure_free(pass);
+
+    return ok;
+}
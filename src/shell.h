@@ -0,0 +1,12 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __SHELL_H
+#define __SHELL_H
+
+#include <stdbool.h>
+
+bool run_shell(const char *path, int show_password, int format);
+
+#endif
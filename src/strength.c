@@ -0,0 +1,493 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+#include <openssl/crypto.h>
+#include "strength.h"
+#include "wordlist.h"
+
+/* Password strength is estimated like zxcvbn does it: the password is
+ * split into pieces that an attacker would guess as a whole, dictionary
+ * words, keyboard walks, repeats, sequences and dates, and the rest is
+ * guessed a character at a time. The split that needs the fewest
+ * guesses is found with dynamic programming and gives the estimate.
+ */
+
+/* Longer passwords only get the character estimate */
+#define STRENGTH_MAX_LEN 128
+
+#define DICT_MAX_LEN 16
+#define DICT_SLOTS 8192
+
+typedef struct _dict_word
+{
+    const char *word;
+    size_t len;
+    double bits;
+    int pattern;
+
+} DictWord_t;
+
+static DictWord_t dict[DICT_SLOTS];
+static pthread_once_t strength_once = PTHREAD_ONCE_INIT;
+
+/* Keyboard row and position of every character, row -1 if not a key */
+static int key_rows[256];
+static double key_xs[256];
+
+static const char *keyboard_rows[] =
+{
+    "`1234567890-=",
+    "qwertyuiop[]\\",
+    "asdfghjkl;'",
+    "zxcvbnm,./"
+};
+
+/* Horizontal offset of each keyboard row in keys */
+static const double keyboard_offsets[] = { 0, 1.5, 1.75, 2.25 };
+
+static const char shifted_from[] = "~!@#$%^&*()_+{}|:\"<>?";
+static const char shifted_to[]   = "`1234567890-=[]\\;',./";
+
+static const char leet_from[] = "013457@$!";
+static const char leet_to[]   = "oieastasi";
+
+static const char *pattern_names[] =
+{
+    "too short",
+    "common password",
+    "dictionary word",
+    "keyboard pattern",
+    "repeated characters",
+    "sequence",
+    "date"
+};
+
+#define DICT_HASH_INIT 2166136261u
+
+/* FNV-1a, can be extended a character at a time */
+static uint32_t dict_hash_add(uint32_t h, char c)
+{
+    return (h ^ (unsigned char)c) * 16777619u;
+}
+
+static uint32_t dict_hash(const char *text, size_t len)
+{
+    uint32_t h = DICT_HASH_INIT;
+
+    for(size_t i = 0; i < len; i++)
+        h = dict_hash_add(h, text[i]);
+
+    return h;
+}
+
+static void dict_add(const char *word, double bits, int pattern)
+{
+    size_t len = strlen(word);
+
+    if(len < 3 || len > DICT_MAX_LEN)
+        return;
+
+    for(uint32_t i = dict_hash(word, len) & (DICT_SLOTS - 1); ; i = (i + 1) & (DICT_SLOTS - 1))
+    {
+        if(dict[i].word == NULL)
+        {
+            dict[i].word = word;
+            dict[i].len = len;
+            dict[i].bits = bits;
+            dict[i].pattern = pattern;
+            return;
+        }
+
+        /* Same word in both lists, keep the cheaper */
+        if(dict[i].len == len && memcmp(dict[i].word, word, len) == 0)
+            return;
+    }
+}
+
+static const DictWord_t *dict_find(const char *text, size_t len, uint32_t hash)
+{
+    for(uint32_t i = hash & (DICT_SLOTS - 1); ; i = (i + 1) & (DICT_SLOTS - 1))
+    {
+        if(dict[i].word == NULL)
+            return NULL;
+
+        if(dict[i].len == len && memcmp(dict[i].word, text, len) == 0)
+            return &dict[i];
+    }
+}
+
+/* Keyboard row and horizontal position of c, false if c is not on the
+ * main keys. Shifted characters are at the key they are typed with.
+ */
+static bool key_position(char c, int *row, double *x)
+{
+    if(c == '\0')
+        return false;
+
+    const char *s = strchr(shifted_from, c);
+
+    if(s)
+        c = shifted_to[s - shifted_from];
+    else
+        c = tolower((unsigned char)c);
+
+    for(int r = 0; r < 4; r++)
+    {
+        const char *k = strchr(keyboard_rows[r], c);
+
+        if(k)
+        {
+            *row = r;
+            *x = keyboard_offsets[r] + (k - keyboard_rows[r]);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Direction from key a to neighbouring key b, 0 if not neighbours */
+static int key_direction(char a, char b)
+{
+    int ra, rb;
+    double xa, xb;
+
+    ra = key_rows[(unsigned char)a];
+    rb = key_rows[(unsigned char)b];
+    xa = key_xs[(unsigned char)a];
+    xb = key_xs[(unsigned char)b];
+
+    if(ra == -1 || rb == -1)
+        return 0;
+
+    int dr = rb - ra;
+    double dx = xb - xa;
+
+    if(dr == 0 && (dx == 1 || dx == -1))
+        return dx > 0 ? 1 : 2;
+
+    if((dr == 1 || dr == -1) && fabs(dx) < 1)
+        return 3 + (dr > 0 ? 0 : 2) + (dx > 0 ? 1 : 0);
+
+    return 0;
+}
+
+static int char_class(char c)
+{
+    if(islower((unsigned char)c))
+        return 0;
+    if(isupper((unsigned char)c))
+        return 1;
+    if(isdigit((unsigned char)c))
+        return 2;
+
+    return 3;
+}
+
+/* Bits of guessing one character of password by brute force */
+static double char_bits(const char *password, size_t len)
+{
+    static const int class_sizes[] = { 26, 26, 10, 33 };
+    bool seen[4] = { false, false, false, false };
+    int size = 0;
+
+    for(size_t i = 0; i < len; i++)
+        seen[char_class(password[i])] = true;
+
+    for(int i = 0; i < 4; i++)
+        size += seen[i] ? class_sizes[i] : 0;
+
+    return log2(size > 0 ? size : 1);
+}
+
+/* Extra bits of upper case letters in a dictionary word. Capitalized
+ * or all upper case words cost one bit, others the number of ways to
+ * choose which letters are upper case.
+ */
+static double case_bits(const char *text, size_t len)
+{
+    int upper = 0;
+    int lower = 0;
+
+    for(size_t i = 0; i < len; i++)
+    {
+        upper += isupper((unsigned char)text[i]) ? 1 : 0;
+        lower += islower((unsigned char)text[i]) ? 1 : 0;
+    }
+
+    if(upper == 0)
+        return 0;
+
+    if(lower == 0 || (upper == 1 && isupper((unsigned char)text[0])))
+        return 1;
+
+    int n = upper + lower;
+    int k = upper < lower ? upper : lower;
+    double ways = 0;
+    double c = 1;
+
+    for(int i = 1; i <= k; i++)
+    {
+        c = c * (n - i + 1) / i;
+        ways += c;
+    }
+
+    return log2(ways);
+}
+
+static bool is_date(const char *d, size_t len)
+{
+    int n[8];
+
+    for(size_t i = 0; i < len; i++)
+        n[i] = d[i] - '0';
+
+    #define NUM2(i) (n[i] * 10 + n[i + 1])
+    #define NUM4(i) (NUM2(i) * 100 + NUM2(i + 2))
+    #define DAY_MONTH(d, m) ((d) >= 1 && (d) <= 31 && (m) >= 1 && (m) <= 12)
+    #define YEAR(y) ((y) >= 1900 && (y) <= 2039)
+
+    if(len == 4)
+        return YEAR(NUM4(0));
+
+    if(len == 6)
+        return DAY_MONTH(NUM2(0), NUM2(2)) || DAY_MONTH(NUM2(2), NUM2(0)) ||
+               DAY_MONTH(NUM2(4), NUM2(2));
+
+    if(len == 8)
+        return (YEAR(NUM4(4)) && (DAY_MONTH(NUM2(0), NUM2(2)) || DAY_MONTH(NUM2(2), NUM2(0)))) ||
+               (YEAR(NUM4(0)) && DAY_MONTH(NUM2(6), NUM2(4)));
+
+    #undef NUM2
+    #undef NUM4
+    #undef DAY_MONTH
+    #undef YEAR
+
+    return false;
+}
+
+static void relax(double *best, int *pattern, int *from, size_t start, size_t end,
+                  double bits, int type)
+{
+    if(best[start] + bits < best[end])
+    {
+        best[end] = best[start] + bits;
+        pattern[end] = type;
+        from[end] = start;
+    }
+}
+
+/* Adds every pattern starting at i */
+static void find_patterns(const char *pw, const char *lower, const char *unleet,
+                          size_t len, size_t i, double cbits,
+                          double *best, int *pattern, int *from)
+{
+    /* Dictionary words, as is and with letter substitutions undone */
+    uint32_t lower_hash = DICT_HASH_INIT;
+    uint32_t unleet_hash = DICT_HASH_INIT;
+    size_t substituted = 0;
+
+    for(size_t n = 1; n <= DICT_MAX_LEN && i + n <= len; n++)
+    {
+        lower_hash = dict_hash_add(lower_hash, lower[i + n - 1]);
+        unleet_hash = dict_hash_add(unleet_hash, unleet[i + n - 1]);
+        substituted += lower[i + n - 1] != unleet[i + n - 1] ? 1 : 0;
+
+        if(n < 3)
+            continue;
+
+        const DictWord_t *word = dict_find(lower + i, n, lower_hash);
+        double extra = 0;
+
+        if(!word && substituted > 0)
+        {
+            word = dict_find(unleet + i, n, unleet_hash);
+            extra = substituted;
+        }
+
+        if(word)
+            relax(best, pattern, from, i, i + n,
+                  word->bits + extra + case_bits(pw + i, n), word->pattern);
+    }
+
+    /* Repeated blocks like aaa or abcabc */
+    for(size_t k = 1; i + k * 2 <= len; k++)
+    {
+        size_t m = 1;
+
+        while(i + k * (m + 1) <= len && memcmp(pw + i, pw + i + k * m, k) == 0)
+        {
+            m++;
+
+            if(k * m >= 3)
+                relax(best, pattern, from, i, i + k * m,
+                      k * cbits + log2(m), PATTERN_REPEAT);
+        }
+    }
+
+    /* Sequences like abcd, 4321 */
+    if(i + 1 < len)
+    {
+        int delta = pw[i + 1] - pw[i];
+        int class = char_class(pw[i]);
+        double start_bits = class == 2 ? log2(10) : log2(26);
+
+        for(size_t j = i + 1; (delta == 1 || delta == -1) && j < len &&
+            pw[j] - pw[j - 1] == delta && char_class(pw[j]) == class; j++)
+        {
+            if(j - i + 1 >= 3)
+                relax(best, pattern, from, i, j + 1,
+                      start_bits + log2(j - i + 1) + (delta < 0 ? 1 : 0),
+                      PATTERN_SEQUENCE);
+        }
+    }
+
+    /* Keyboard walks like qwerty or zaq1, every turn costs more */
+    int direction = 0;
+    int turns = 0;
+
+    for(size_t j = i + 1; j < len; j++)
+    {
+        int d = key_direction(pw[j - 1], pw[j]);
+
+        if(d == 0)
+            break;
+
+        if(d != direction)
+            turns++;
+
+        direction = d;
+
+        if(j - i + 1 >= 4)
+            relax(best, pattern, from, i, j + 1,
+                  log2(47) + log2(j - i + 1) + turns * log2(4.6),
+                  PATTERN_KEYBOARD);
+    }
+
+    /* Years and dates written with digits only */
+    for(size_t n = 4; n <= 8 && i + n <= len; n += 2)
+    {
+        size_t digits = 0;
+
+        while(digits < n && isdigit((unsigned char)pw[i + digits]))
+            digits++;
+
+        if(digits == n && is_date(pw + i, n))
+            relax(best, pattern, from, i, i + n,
+                  n == 4 ? log2(140) : log2(366 * 140), PATTERN_DATE);
+    }
+}
+
+/* Builds the lookup tables, once */
+static void strength_init()
+{
+    for(int c = 0; c < 256; c++)
+    {
+        if(!key_position(c, &key_rows[c], &key_xs[c]))
+            key_rows[c] = -1;
+    }
+
+    /* Common passwords first, a match costs about its rank */
+    for(int i = 0; i < COMMON_PASSWORDS_SIZE; i++)
+        dict_add(common_passwords[i], log2(i + 2), PATTERN_COMMON);
+
+    for(int i = 0; i < WORDLIST_SIZE; i++)
+        dict_add(wordlist[i], log2(WORDLIST_SIZE), PATTERN_WORD);
+}
+
+/* Estimates how hard password is to guess. Score goes from 0 to 4 with
+ * the same limits as zxcvbn, 10^3, 10^6, 10^8 and 10^10 guesses. Safe to
+ * call from many threads.
+ */
+Strength_t password_strength(const char *password)
+{
+    Strength_t result = { 0, 0, PATTERN_NONE };
+    size_t len = strlen(password);
+
+    pthread_once(&strength_once, strength_init);
+
+    double cbits = char_bits(password, len);
+
+    if(len > STRENGTH_MAX_LEN)
+    {
+        result.bits = len * cbits;
+        result.score = 4;
+        return result;
+    }
+
+    char lower[STRENGTH_MAX_LEN];
+    char unleet[STRENGTH_MAX_LEN];
+    double best[STRENGTH_MAX_LEN + 1];
+    int pattern[STRENGTH_MAX_LEN + 1];
+    int from[STRENGTH_MAX_LEN + 1];
+    int covered[PATTERN_COUNT] = { 0 };
+
+    for(size_t i = 0; i < len; i++)
+    {
+        const char *leet = strchr(leet_from, password[i]);
+
+        lower[i] = tolower((unsigned char)password[i]);
+        unleet[i] = leet ? leet_to[leet - leet_from] : lower[i];
+    }
+
+    best[0] = 0;
+
+    for(size_t i = 1; i <= len; i++)
+        best[i] = HUGE_VAL;
+
+    for(size_t i = 0; i < len; i++)
+    {
+        relax(best, pattern, from, i, i + 1, cbits, PATTERN_NONE);
+        find_patterns(password, lower, unleet, len, i, cbits, best, pattern, from);
+    }
+
+    /* Weakness is the pattern that covers most of the password */
+    for(size_t i = len; i > 0; i = from[i])
+        covered[pattern[i]] += i - from[i];
+
+    int most = 0;
+
+    for(int p = PATTERN_COMMON; p < PATTERN_COUNT; p++)
+    {
+        if(covered[p] > most)
+        {
+            most = covered[p];
+            result.weakness = p;
+        }
+    }
+
+    result.bits = best[len];
+
+    double guesses_log10 = result.bits * log10(2);
+
+    result.score = guesses_log10 < 3 ? 0 : guesses_log10 < 6 ? 1 :
+                   guesses_log10 < 8 ? 2 : guesses_log10 < 10 ? 3 : 4;
+
+    if(result.weakness == PATTERN_NONE && result.score < 4)
+        result.weakness = PATTERN_SHORT;
+
+    /* Copies of the password are not left on the stack */
+    OPENSSL_cleanse(lower, sizeof(lower));
+    OPENSSL_cleanse(unleet, sizeof(unleet));
+
+    return result;
+}
+
+const char *strength_weakness_name(int weakness)
+{
+    if(weakness <= PATTERN_NONE || weakness >= PATTERN_COUNT)
+        return "";
+
+    return pattern_names[weakness - 1];
+}
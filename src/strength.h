@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __STRENGTH_H
+#define __STRENGTH_H
+
+/* What makes a password weak, see password_strength */
+enum
+{
+    PATTERN_NONE = 0,
+    PATTERN_SHORT,
+    PATTERN_COMMON,
+    PATTERN_WORD,
+    PATTERN_KEYBOARD,
+    PATTERN_REPEAT,
+    PATTERN_SEQUENCE,
+    PATTERN_DATE,
+    PATTERN_COUNT
+};
+
+typedef struct _strength
+{
+    double bits;        /* log2 of the estimated guesses */
+    int score;          /* 0 to 4 */
+    int weakness;       /* PATTERN_* */
+
+} Strength_t;
+
+Strength_t password_strength(const char *password);
+const char *strength_weakness_name(int weakness);
+
+#endif
@@ -0,0 +1,504 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <sqlite3.h>
+#include <openssl/crypto.h>
+#include "sync.h"
+#include "entry.h"
+#include "db.h"
+#include "crypto.h"
+#include "utils.h"
+#include "securemem.h"
+
+/* Two vaults are merged by comparing their hash trees top down. Every
+ * entry has a uuid that stays the same in every copy of the vault. Node
+ * of the tree is the xor of the hashes of the entries whose uuid starts
+ * with the prefix of the node, and triggers keep the nodes up to date,
+ * see the schema in db.c. Subtrees with equal hashes are skipped, so
+ * only the nodes above the changed entries are read. Leaves are the
+ * prefixes of SYNC_TREE_DEPTH characters, and the entries of a differing
+ * leaf are compared one by one.
+ *
+ * The version modified later wins. Times are compared in UTC, so vaults
+ * changed in different time zones merge right. Removed entries leave a
+ * tombstone, so a removal wins over changes made before it. An entry
+ * changed in both vaults since their previous sync is reported as a
+ * conflict.
+ */
+#define SYNC_TREE_DEPTH 3
+
+#define LOCAL 0
+#define OTHER 1
+
+typedef struct _row
+{
+    char *uuid;
+    int64_t hash;
+    char *modified;             /* Time modified in UTC */
+    Entry_t *entry;
+
+} Row_t;
+
+typedef struct _side
+{
+    sqlite3 *db;
+    const char *name;
+    sqlite3_stmt *node;         /* Hash of a node */
+    sqlite3_stmt *leaf;         /* Entries of a leaf */
+    sqlite3_stmt *tombstone;    /* When an entry was removed */
+    long added;
+    long updated;
+    long removed;
+
+} Side_t;
+
+typedef struct _sync
+{
+    Side_t sides[2];
+    char *since;                /* Time of the previous sync, NULL if none */
+    long nodes;
+    long rows;
+    long conflicts;
+    bool ok;
+
+} Sync_t;
+
+static double now_seconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool side_init(Side_t *side, sqlite3 *db, const char *name)
+{
+    memset(side, 0, sizeof(Side_t));
+
+    side->db = db;
+    side->name = name;
+
+    if(sqlite3_prepare_v2(db, "select hash from sync_tree where prefix=?;",
+                          -1, &side->node, NULL) != SQLITE_OK ||
+       sqlite3_prepare_v2(db, "select uuid, title, user, url, password, notes, timestamp,"
+                          "ylva_hash(uuid, title, user, url, password, notes, timestamp),"
+                          "modified_utc from entries where uuid>=?1 and uuid<?1||'g' order by uuid;",
+                          -1, &side->leaf, NULL) != SQLITE_OK ||
+       sqlite3_prepare_v2(db, "select deleted from tombstones where uuid=?;",
+                          -1, &side->tombstone, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(db));
+        return false;
+    }
+
+    return true;
+}
+
+static void side_free(Side_t *side)
+{
+    sqlite3_finalize(side->node);
+    sqlite3_finalize(side->leaf);
+    sqlite3_finalize(side->tombstone);
+}
+
+static int64_t node_hash(Side_t *side, const char *prefix)
+{
+    int64_t hash = 0;
+
+    sqlite3_bind_text(side->node, 1, prefix, -1, SQLITE_STATIC);
+
+    if(sqlite3_step(side->node) == SQLITE_ROW)
+        hash = sqlite3_column_int64(side->node, 0);
+
+    sqlite3_reset(side->node);
+
+    return hash;
+}
+
+/* Returns the time entry uuid was removed from side, NULL if it was
+ * not. Caller must free the return value.
+ */
+static char *removed_at(Side_t *side, const char *uuid)
+{
+    char *deleted = NULL;
+
+    sqlite3_bind_text(side->tombstone, 1, uuid, -1, SQLITE_STATIC);
+
+    if(sqlite3_step(side->tombstone) == SQLITE_ROW)
+        deleted = strdup((const char *)sqlite3_column_text(side->tombstone, 0));
+
+    sqlite3_reset(side->tombstone);
+
+    return deleted;
+}
+
+static const char *column(sqlite3_stmt *stmt, int col)
+{
+    const char *text = (const char *)sqlite3_column_text(stmt, col);
+
+    return text ? text : "";
+}
+
+/* Reads entries of leaf prefix to rows, returns their number or -1 */
+static int read_leaf(Side_t *side, const char *prefix, Row_t **rows)
+{
+    int count = 0;
+    int rc;
+
+    *rows = NULL;
+    sqlite3_bind_text(side->leaf, 1, prefix, -1, SQLITE_STATIC);
+
+    while((rc = sqlite3_step(side->leaf)) == SQLITE_ROW)
+    {
+        Row_t *row;
+
+        *rows = trealloc(*rows, (count + 1) * sizeof(Row_t));
+        row = &(*rows)[count++];
+
+        row->uuid = strdup(column(side->leaf, 0));
+        row->entry = entry_new(column(side->leaf, 1), column(side->leaf, 2),
+                               column(side->leaf, 3), column(side->leaf, 4),
+                               column(side->leaf, 5));
+        row->entry->stamp = strdup(column(side->leaf, 6));
+        row->hash = sqlite3_column_int64(side->leaf, 7);
+        row->modified = strdup(column(side->leaf, 8));
+    }
+
+    if(rc != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error: %s\n", sqlite3_errmsg(side->db));
+        count = -1;
+    }
+
+    sqlite3_reset(side->leaf);
+
+    return count;
+}
+
+static void free_rows(Row_t *rows, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        free(rows[i].uuid);
+        free(rows[i].modified);
+        entry_free(rows[i].entry);
+    }
+
+    free(rows);
+}
+
+/* Copies row of side from to the other side */
+static void copy_row(Sync_t *sync, int from, const Row_t *row, bool update)
+{
+    Side_t *to = &sync->sides[!from];
+
+    if(!db_put_synced(to->db, row->entry, row->uuid, row->modified))
+    {
+        sync->ok = false;
+        return;
+    }
+
+    if(update)
+        to->updated++;
+    else
+        to->added++;
+}
+
+/* Row is only on side from. It was either added there, or removed from
+ * the other side.
+ */
+static void sync_single(Sync_t *sync, int from, const Row_t *row)
+{
+    Side_t *side = &sync->sides[from];
+    char *deleted = removed_at(&sync->sides[!from], row->uuid);
+
+    if(deleted && strcmp(deleted, row->modified) >= 0)
+    {
+        if(db_delete_synced(side->db, row->uuid, deleted))
+            side->removed++;
+        else
+            sync->ok = false;
+    }
+    else
+    {
+        if(deleted)
+        {
+            fprintf(stdout, "Conflict: %s was removed from %s before it was changed "
+                    "in %s, kept it.\n", row->entry->title, sync->sides[!from].name,
+                    side->name);
+            sync->conflicts++;
+        }
+
+        copy_row(sync, from, row, false);
+    }
+
+    free(deleted);
+}
+
+/* Entry differs between the sides, the newer one wins */
+static void sync_pair(Sync_t *sync, const Row_t *local, const Row_t *other)
+{
+    int newer = strcmp(local->modified, other->modified) >= 0 ? LOCAL : OTHER;
+    const Row_t *winner = newer == LOCAL ? local : other;
+
+    /* Without a previous sync there is no telling which side changed */
+    if(sync->since && strcmp(local->modified, sync->since) > 0 &&
+       strcmp(other->modified, sync->since) > 0)
+    {
+        fprintf(stdout, "Conflict: %s was changed in both, kept the version of %s "
+                "from %s.\n", winner->entry->title, sync->sides[newer].name,
+                winner->entry->stamp);
+        sync->conflicts++;
+    }
+
+    copy_row(sync, newer, winner, true);
+}
+
+/* Merges the entries of leaf prefix. Both lists are ordered by uuid */
+static void sync_leaf(Sync_t *sync, const char *prefix)
+{
+    Row_t *local;
+    Row_t *other;
+    int local_count = read_leaf(&sync->sides[LOCAL], prefix, &local);
+    int other_count = read_leaf(&sync->sides[OTHER], prefix, &other);
+    int i = 0;
+    int j = 0;
+
+    if(local_count == -1 || other_count == -1)
+    {
+        free_rows(local, local_count);
+        free_rows(other, other_count);
+        sync->ok = false;
+        return;
+    }
+
+    sync->rows += local_count + other_count;
+
+    while(sync->ok && (i < local_count || j < other_count))
+    {
+        int cmp;
+
+        if(i == local_count)
+            cmp = 1;
+        else if(j == other_count)
+            cmp = -1;
+        else
+            cmp = strcmp(local[i].uuid, other[j].uuid);
+
+        if(cmp < 0)
+        {
+            sync_single(sync, LOCAL, &local[i++]);
+        }
+        else if(cmp > 0)
+        {
+            sync_single(sync, OTHER, &other[j++]);
+        }
+        else
+        {
+            if(local[i].hash != other[j].hash)
+                sync_pair(sync, &local[i], &other[j]);
+
+            i++;
+            j++;
+        }
+    }
+
+    free_rows(local, local_count);
+    free_rows(other, other_count);
+}
+
+/* Descends to the children of prefix whose hashes differ */
+static void sync_node(Sync_t *sync, const char *prefix, int depth)
+{
+    static const char digits[] = "0123456789abcdef";
+    char child[SYNC_TREE_DEPTH + 1];
+
+    sync->nodes++;
+
+    if(node_hash(&sync->sides[LOCAL], prefix) == node_hash(&sync->sides[OTHER], prefix))
+        return;
+
+    if(depth == SYNC_TREE_DEPTH)
+    {
+        sync_leaf(sync, prefix);
+        return;
+    }
+
+    for(int i = 0; sync->ok && i < 16; i++)
+    {
+        memcpy(child, prefix, depth);
+        child[depth] = digits[i];
+        child[depth + 1] = '\0';
+
+        sync_node(sync, child, depth + 1);
+    }
+}
+
+/* Returns the time of the previous sync of db with peer, NULL if none.
+ * Caller must free the return value.
+ */
+static char *last_synced(sqlite3 *db, const char *peer)
+{
+    sqlite3_stmt *stmt = NULL;
+    char *synced = NULL;
+
+    if(sqlite3_prepare_v2(db, "select synced from sync_peers where peer=?;",
+                          -1, &stmt, NULL) != SQLITE_OK)
+        return NULL;
+
+    sqlite3_bind_text(stmt, 1, peer, -1, SQLITE_STATIC);
+
+    if(sqlite3_step(stmt) == SQLITE_ROW)
+        synced = strdup((const char *)sqlite3_column_text(stmt, 0));
+
+    sqlite3_finalize(stmt);
+
+    return synced;
+}
+
+static bool set_synced(sqlite3 *db, const char *peer)
+{
+    char *query = sqlite3_mprintf("insert or replace into sync_peers "
+                                  "values(%Q, datetime('now'));", peer);
+    int rc = sqlite3_exec(db, query, NULL, 0, NULL);
+
+    sqlite3_free(query);
+
+    return rc == SQLITE_OK;
+}
+
+static char *absolute_path(const char *path)
+{
+    char *real = realpath(path, NULL);
+
+    return real ? real : strdup(path);
+}
+
+static void print_side(const Side_t *side)
+{
+    fprintf(stdout, "%s: %ld added, %ld updated, %ld removed.\n",
+            side->name, side->added, side->updated, side->removed);
+}
+
+/* Merges the active database and the encrypted vault in path both ways.
+ * The vault is decrypted only to memory and written back encrypted with
+ * the same password if it changed. Changes to the active database are
+ * written when the unit of work ends.
+ */
+bool sync_vault(const char *path, const char *passphrase)
+{
+    Sync_t sync;
+    Key_t *key = NULL;
+    size_t len = 0;
+    bool changed = false;
+
+    double seconds = 0;
+    unsigned char *image = read_encrypted(passphrase, path, &key, &len);
+
+    if(!image)
+        return false;
+
+    sqlite3 *other = db_open_image(image, len);
+
+    OPENSSL_cleanse(image, len);
+    free(image);
+
+    if(!other)
+    {
+        secure_free(key);
+        return false;
+    }
+
+    sqlite3 *local = db_active_connection();
+    char *active_path = read_active_database_path();
+
+    if(!local || !active_path)
+    {
+        free(active_path);
+        sqlite3_close(other);
+        secure_free(key);
+        return false;
+    }
+
+    /* Each vault knows the other by its path */
+    char *other_id = absolute_path(path);
+    char *local_id = absolute_path(active_path);
+
+    memset(&sync, 0, sizeof(sync));
+    sync.ok = side_init(&sync.sides[LOCAL], local, "This vault") &&
+              side_init(&sync.sides[OTHER], other, path) &&
+              sqlite3_exec(other, "begin;", NULL, 0, NULL) == SQLITE_OK;
+    sync.since = last_synced(local, other_id);
+
+    if(sync.ok)
+    {
+        double start = now_seconds();
+
+        sync_node(&sync, "", 0);
+        seconds = now_seconds() - start;
+    }
+
+    /* Both trees must be equal now */
+    if(sync.ok && node_hash(&sync.sides[LOCAL], "") != node_hash(&sync.sides[OTHER], ""))
+    {
+        fprintf(stderr, "Vaults still differ after the sync.\n");
+        sync.ok = false;
+    }
+
+    changed = sync.sides[OTHER].added || sync.sides[OTHER].updated ||
+              sync.sides[OTHER].removed;
+
+    sync.ok = sync.ok && set_synced(local, other_id) &&
+              (!changed || set_synced(other, local_id)) &&
+              sqlite3_exec(other, "commit;", NULL, 0, NULL) == SQLITE_OK;
+
+    side_free(&sync.sides[LOCAL]);
+    side_free(&sync.sides[OTHER]);
+
+    if(sync.ok && changed)
+    {
+        image = db_image(other, &len);
+        sync.ok = image && write_encrypted(key, image, len, path);
+
+        if(image)
+        {
+            OPENSSL_cleanse(image, len);
+            sqlite3_free(image);
+        }
+    }
+
+    sqlite3_close(other);
+    db_release_connection(local);
+    secure_free(key);
+    free(sync.since);
+    free(other_id);
+    free(local_id);
+    free(active_path);
+
+    if(!sync.ok)
+    {
+        fprintf(stderr, "Sync with %s failed.\n", path);
+        return false;
+    }
+
+    fprintf(stdout, "Compared %ld tree nodes and %ld entries in %.1f ms.\n",
+            sync.nodes, sync.rows, seconds * 1000);
+    print_side(&sync.sides[LOCAL]);
+    print_side(&sync.sides[OTHER]);
+
+    if(sync.conflicts)
+        fprintf(stdout, "%ld conflicts, see above.\n", sync.conflicts);
+
+    return true;
+}
@@ -0,0 +1,12 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __SYNC_H
+#define __SYNC_H
+
+#include <stdbool.h>
+
+bool sync_vault(const char *path, const char *passphrase);
+
+#endif
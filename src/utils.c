@@ -8,11 +8,18 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <ctype.h>
 #include <sys/stat.h>
 #include "entry.h"
 #include "utils.h"
 #include "crypto.h"
-#include "qr.h"
+#include "render.h"
+
+/* Longest profile name */
+#define PROFILE_MAX_LEN 64
+
+/* Profile in use, NULL is the default profile */
+static char *profile = NULL;
 
 /* Function returns NULL if the environment variable
    YLVA_DEFAULT_USERNAME is not set.
@@ -23,62 +30,15 @@ char* get_default_username()
     return username;
 }
 
-static char *get_output_color()
-{
-    char *color = getenv("YLVA_COLOR");
-
-    if(color == NULL)
-        return COLOR_DEFAULT;
-
-    if(strcmp(color, "BLUE") == 0)
-        return "\x1B[34m";
-    else if(strcmp(color, "RED") == 0)
-        return "\x1B[31m";
-    else if(strcmp(color, "GREEN") == 0)
-        return "\x1B[32m";
-    else if(strcmp(color, "YELLOW") == 0)
-        return "\x1B[33m";
-    else if(strcmp(color, "MAGENTA") == 0)
-        return "\x1B[35m";
-    else if(strcmp(color, "CYAN") == 0)
-        return "\x1B[36m";
-    else if(strcmp(color, "WHITE") == 0)
-        return "\x1B[37m";
-    else
-        return COLOR_DEFAULT; /* Handle empty variable too */
-}
-
+/* Prints a single entry. Use a renderer directly when printing
+ * many entries, so that the output is written in large chunks.
+ */
 bool print_entry(Entry_t *entry, int show_password, int as_qrcode)
 {
-    char *color = get_output_color();
-
-    fprintf(stdout, "=====================================================================\n");
-
-    if(as_qrcode == 1) {
-        print_entry_as_qr(entry);
-    }
-    else {
-        /* Set the color */
-        fprintf(stdout, "%s", color);
-
-        fprintf(stdout, "ID: %d\n", entry->id);
-        fprintf(stdout, "Title: %s\n", entry->title);
-        fprintf(stdout, "User: %s\n", entry->user);
-        fprintf(stdout, "Url: %s\n", entry->url);
+    Render_t *render = render_new(stdout, OUTPUT_HUMAN, show_password, as_qrcode);
 
-        if(show_password == 1)
-            fprintf(stdout, "Password: %s\n", entry->password);
-        else
-            fprintf(stdout, "Password: **********\n");
-
-        fprintf(stdout, "Notes: %s\n", entry->notes);
-        fprintf(stdout, "Modified: %s\n", entry->stamp);
-
-        /* Reset the color */
-        fprintf(stdout, "%s", COLOR_DEFAULT);
-    }
-
-    fprintf(stdout, "=====================================================================\n");
+    render_entry(render, entry);
+    render_free(render);
 
     return 0;
 }
@@ -126,9 +86,37 @@ bool has_active_database()
     return true;
 }
 
-/* Returns the path of ~/.ylva.open_db file.
- * Caller must free the return value */
-char *get_open_db_path_holder_filepath()
+/* Selects the profile. Each profile has its own active database, so
+ * several databases can be decrypted at the same time. Name "default" is
+ * the profile used without one. Returns false if name is not valid.
+ */
+bool set_profile(const char *name)
+{
+    size_t len = strlen(name);
+
+    if(len == 0 || len > PROFILE_MAX_LEN)
+        return false;
+
+    for(size_t i = 0; i < len; i++)
+    {
+        if(!isalnum((unsigned char)name[i]) && name[i] != '-' && name[i] != '_')
+            return false;
+    }
+
+    free(profile);
+    profile = strcmp(name, "default") == 0 ? NULL : strdup(name);
+
+    return true;
+}
+
+const char *get_profile()
+{
+    return profile ? profile : "default";
+}
+
+/* Returns the path of ~/name for the default profile and ~/name.profile
+ * for the others. Caller must free the return value */
+char *get_profile_filepath(const char *name)
 {
     char *home = NULL;
     char *path = NULL;
@@ -138,36 +126,41 @@ char *get_open_db_path_holder_filepath()
     if(!home)
         return NULL;
 
-    /* /home/user/.ylva.open_db */
-    path = tmalloc(sizeof(char) * (strlen(home) + 15));
+    /* /home/user/.ylva.open_db.profile */
+    path = tmalloc(strlen(home) + strlen(name) + (profile ? strlen(profile) : 0) + 3);
 
     strcpy(path, home);
-    strcat(path, "/.ylva.open_db");
+    strcat(path, "/");
+    strcat(path, name);
+
+    if(profile)
+    {
+        strcat(path, ".");
+        strcat(path, profile);
+    }
 
     return path;
 }
 
-/* Reads and returns the path of currently decrypted
- * database. Caller must free the return value */
-char *read_active_database_path()
+/* Returns the path of ~/.ylva.open_db file of the profile.
+ * Caller must free the return value */
+char *get_open_db_path_holder_filepath()
+{
+    return get_profile_filepath(".ylva.open_db");
+}
+
+/* Reads the database path from the holder file in path.
+ * Caller must free the return value */
+char *read_database_path_from(const char *path)
 {
     FILE *fp = NULL;
-    char *path = NULL;
     char *opendbholderpath = NULL;
     size_t len;
 
-    path = get_open_db_path_holder_filepath();
-
-    if(!path)
-        return NULL;
-
     fp = fopen(path, "r");
 
     if(!fp)
-    {
-        free(path);
         return NULL;
-    }
 
     /* We only need the first line from the file */
 
@@ -177,17 +170,31 @@ char *read_active_database_path()
             free(opendbholderpath);
 
         fclose(fp);
-        free(path);
 
         return NULL;
     }
 
     fclose(fp);
-    free(path);
 
     return opendbholderpath;
 }
 
+/* Reads and returns the path of currently decrypted
+ * database. Caller must free the return value */
+char *read_active_database_path()
+{
+    char *path = get_open_db_path_holder_filepath();
+
+    if(!path)
+        return NULL;
+
+    char *db_path = read_database_path_from(path);
+
+    free(path);
+
+    return db_path;
+}
+
 void write_active_database_path(const char *db_path)
 {
     FILE *fp = NULL;
@@ -230,6 +237,22 @@ void *tmalloc(size_t size)
     return data;
 }
 
+//Same as tmalloc, but for realloc
+void *trealloc(void *ptr, size_t size)
+{
+    void *data = NULL;
+
+    data = realloc(ptr, size);
+
+    if(data == NULL)
+    {
+        fprintf(stderr, "Realloc failed. Abort.\n");
+        abort();
+    }
+
+    return data;
+}
+
 void set_file_owner_rw(const char *path)
 {
     if(chmod(path, S_IRUSR | S_IWUSR) != 0)
@@ -12,11 +12,16 @@
 #define COLOR_DEFAULT "\x1B[0m"
 
 bool print_entry(Entry_t *entry, int show_password, int as_qrcode);
+bool set_profile(const char *name);
+const char *get_profile();
+char *get_profile_filepath(const char *name);
 char *get_open_db_path_holder_filepath();
+char *read_database_path_from(const char *path);
 void write_active_database_path(const char *db_path);
 char *read_active_database_path();
 bool has_active_database();
 void *tmalloc(size_t size);
+void *trealloc(void *ptr, size_t size);
 void set_file_owner_rw(const char *path);
 bool file_exists(const char *path);
 char* get_default_username();
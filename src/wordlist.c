@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#include "wordlist.h"
+
+/* Words for --gen-passphrase. Common English words of three to eight
+ * letters, all lower case and unique, so each word adds 11 bits.
+ */
+const char *const wordlist[WORDLIST_SIZE] =
+{
+    "abbey", "able", "absorb", "accent", "accord", "acid", "acorn", "acre",
+    "acrobat", "act", "acting", "active", "actor", "adapt", "add", "adjust",
+    "admit", "adobe", "adore", "adult", "advice", "aerial", "affair", "affix",
+    "afford", "afloat", "age", "agenda", "agent", "agile", "aging", "agree",
+    "ahead", "aid", "aim", "air", "airline", "airport", "aisle", "alarm",
+    "album", "alcove", "alert", "algae", "alias", "alibi", "alien", "align",
+    "alike", "alive", "alley", "allow", "alloy", "almanac", "almond", "alone",
+    "alpha", "alpine", "amazed", "amber", "amble", "amend", "ample", "amulet",
+    "amuse", "anchor", "angel", "anger", "angle", "animal", "ankle", "annex",
+    "answer", "antique", "antler", "anvil", "apart", "appeal", "apple", "apricot",
+    "apron", "aqua", "arcade", "arch", "archer", "arctic", "ardent", "arena",
+    "argue", "arise", "armada", "armor", "army", "aroma", "array", "arrive",
+    "arrow", "art", "artisan", "artist", "ascend", "ashes", "aside", "ask",
+    "aspect", "aspen", "asphalt", "asset", "athlete", "atlas", "atom", "attach",
+    "attend", "attic", "audio", "audit", "aunt", "autumn", "avenue", "avid",
+    "avocado", "avoid", "awake", "award", "aware", "awful", "axis", "backpack",
+    "bacon", "badge", "badger", "bagel", "baker", "bakery", "ballad", "ballet",
+    "ballot", "balmy", "bamboo", "banana", "bandit", "banjo", "banner", "banquet",
+    "bargain", "barley", "barn", "barrel", "basalt", "basil", "basin", "basket",
+    "batch", "bath", "baton", "bazaar", "beach", "beacon", "beagle", "beam",
+    "bean", "bear", "beard", "beast", "beaver", "become", "bed", "bedrock",
+    "beech", "beef", "beehive", "begin", "belief", "bell", "bellhop", "below",
+    "belt", "bench", "beret", "berry", "beyond", "bicycle", "bike", "billow",
+    "bingo", "birch", "bird", "biscuit", "bishop", "bison", "blade", "blank",
+    "blanket", "blast", "blaze", "blend", "blender", "bless", "blimp", "blink",
+    "bliss", "block", "bloom", "blossom", "blot", "blouse", "blue", "blunt",
+    "blush", "board", "boast", "boat", "bobcat", "bobsled", "bonfire", "bonus",
+    "book", "bookcase", "boost", "boot", "booth", "border", "boss", "botany",
+    "bottle", "boulder", "bounce", "bouquet", "bow", "bowl", "box", "boxcar",
+    "bracket", "brain", "brake", "branch", "brass", "brave", "bread", "break",
+    "breeze", "brick", "bride", "bridge", "brief", "bright", "bring", "brisk",
+    "broad", "broken", "bronze", "brook", "broom", "brownie", "brush", "bubble",
+    "bubbly", "bucket", "buckle", "buddy", "budget", "buffalo", "buffet", "bugle",
+    "build", "bulb", "bulldog", "bumper", "bunch", "bunny", "burlap", "burrow",
+    "burst", "bush", "butler", "butter", "button", "buzz", "cabbage", "cabin",
+    "cabinet", "cable", "cactus", "cadence", "cadet", "cage", "cake", "calendar",
+    "calm", "camel", "camera", "camp", "camper", "canal", "canary", "candid",
+    "candle", "candy", "cannon", "canoe", "canvas", "canyon", "cape", "capital",
+    "captain", "caramel", "caravan", "carbon", "card", "career", "cargo", "carnival",
+    "carpet", "carrot", "cart", "cartoon", "case", "cash", "cashew", "castle",
+    "casual", "catalog", "catfish", "cause", "cave", "cavern", "cedar", "ceiling",
+    "cell", "cello", "cement", "census", "cereal", "certain", "chain", "chair",
+    "chalk", "champ", "chant", "chapel", "chapter", "charcoal", "charm", "chart",
+    "chase", "cheek", "cheer", "cheese", "cheetah", "chef", "cherry", "chess",
+    "chest", "chick", "chief", "child", "chili", "chime", "chimney", "chip",
+    "choir", "chord", "chorus", "chowder", "cider", "cinema", "circle", "circus",
+    "citizen", "citrus", "city", "civic", "claim", "clamp", "clap", "clarinet",
+    "clarity", "classic", "clay", "clean", "clerk", "click", "cliff", "climate",
+    "climb", "clock", "closet", "cloud", "clover", "clown", "club", "clue",
+    "coach", "coast", "coaster", "cobalt", "cobbler", "cobweb", "cockpit", "cocoa",
+    "coconut", "code", "coffee", "coin", "collar", "colony", "column", "comet",
+    "comfort", "comic", "compact", "compass", "concert", "condor", "console", "contest",
+    "cookie", "copper", "coral", "cord", "corn", "corner", "cornet", "costume",
+    "cottage", "cotton", "couch", "cough", "count", "courage", "cousin", "cover",
+    "cow", "coyote", "crab", "cradle", "craft", "crane", "crate", "crater",
+    "crawl", "crayon", "cream", "credit", "creek", "crescent", "crest", "cricket",
+    "crimson", "crisp", "crop", "croquet", "crow", "crowd", "crown", "cruiser",
+    "crumb", "crust", "crystal", "cubic", "cubicle", "culture", "cupcake", "cupid",
+    "curl", "current", "curtain", "curve", "cushion", "custom", "cycle", "cyclone",
+    "daily", "dairy", "daisy", "dance", "dancer", "dash", "data", "dawn",
+    "dazzle", "deal", "debate", "debut", "decade", "decal", "decibel", "decimal",
+    "decoy", "deer", "delta", "deluxe", "denim", "dentist", "deploy", "depot",
+    "depth", "desert", "desk", "desktop", "dessert", "detail", "device", "dial",
+    "diamond", "diary", "diesel", "digital", "dime", "diner", "dinghy", "dingo",
+    "dinner", "direct", "disco", "dish", "disk", "display", "distant", "ditch",
+    "dive", "divide", "dock", "doctor", "dodge", "dollar", "dolphin", "domain",
+    "dome", "donkey", "donut", "door", "dormant", "dormouse", "dose", "double",
+    "dove", "dozen", "draft", "dragon", "drama", "drawer", "dream", "dress",
+    "drift", "drill", "drink", "drizzle", "drum", "duck", "dugout", "dune",
+    "durable", "dusk", "dust", "dwell", "dynamic", "eager", "eagle", "earnest",
+    "earth", "easel", "east", "easy", "eatery", "echo", "eclipse", "ecology",
+    "edge", "editor", "eel", "effect", "effort", "egg", "eggplant", "eight",
+    "elastic", "elbow", "elder", "elegy", "elephant", "elevate", "eleven", "elf",
+    "elite", "elk", "elm", "embark", "ember", "emblem", "emerald", "empire",
+    "empty", "emu", "enable", "enamel", "endless", "energy", "engage", "engine",
+    "enjoy", "enlist", "enough", "entire", "entry", "envoy", "epic", "episode",
+    "equal", "equator", "equinox", "era", "erase", "erupt", "escape", "escort",
+    "essay", "ether", "even", "evening", "event", "evoke", "exact", "exhale",
+    "exit", "exotic", "expand", "expert", "explore", "export", "extra", "fable",
+    "fabric", "face", "fact", "factor", "faculty", "fade", "fairy", "faith",
+    "falafel", "falcon", "fame", "famous", "fancy", "fanfare", "farm", "farmland",
+    "fast", "fathom", "fault", "fauna", "favor", "feast", "feather", "feline",
+    "fence", "fern", "ferret", "ferry", "festival", "fetch", "fever", "fiber",
+    "fiction", "fiddle", "field", "fiesta", "fifteen", "figure", "film", "filter",
+    "final", "finance", "finch", "finger", "fire", "firefly", "fireman", "first",
+    "fish", "fitness", "five", "flag", "flame", "flannel", "flash", "flask",
+    "fleet", "flick", "flicker", "flint", "flipper", "float", "flock", "flood",
+    "floor", "flora", "flour", "fluffy", "flute", "flutter", "focus", "fog",
+    "folder", "foliage", "folk", "footpath", "forest", "forge", "fork", "fort",
+    "forum", "forward", "fossil", "fountain", "fox", "fragile", "frame", "freckle",
+    "freedom", "freight", "fresh", "fritter", "frog", "frost", "frozen", "fruit",
+    "fudge", "fuel", "funny", "furnace", "fury", "fuse", "future", "gadget",
+    "galaxy", "gallery", "galley", "gallon", "game", "garage", "garden", "garlic",
+    "garnet", "gate", "gauge", "gazebo", "gazelle", "gecko", "gem", "general",
+    "genie", "genius", "gentle", "geyser", "ghost", "giant", "gift", "giggle",
+    "ginger", "gingham", "giraffe", "glacier", "glad", "glass", "glide", "glimmer",
+    "glisten", "globe", "glove", "glow", "glue", "goat", "gobble", "goblet",
+    "gold", "golden", "golf", "gondola", "goose", "gorilla", "gospel", "gourmet",
+    "gown", "grace", "grade", "grain", "granite", "grape", "graph", "grass",
+    "gravel", "gravity", "gravy", "great", "green", "grid", "grill", "grin",
+    "grip", "grocery", "group", "grove", "guard", "guava", "guest", "guide",
+    "guitar", "gulf", "gull", "gum", "gumdrop", "guru", "gust", "gutter",
+    "habit", "hail", "hair", "halibut", "hallway", "hamlet", "hammer", "hammock",
+    "hamster", "hand", "handbook", "handle", "happy", "harbor", "hardy", "harmony",
+    "harness", "harp", "harvest", "hatch", "hatchet", "haven", "hawk", "hazel",
+    "head", "heading", "healthy", "heart", "heat", "heather", "hedge", "helium",
+    "helmet", "help", "helpful", "herald", "herb", "hermit", "hero", "heron",
+    "hidden", "highway", "hill", "hint", "hippo", "history", "hobby", "hockey",
+    "holiday", "holly", "home", "honey", "hood", "hook", "hope", "horizon",
+    "horn", "hornet", "horse", "host", "hostel", "hotel", "hour", "house",
+    "hover", "hub", "hug", "human", "humble", "hummus", "humor", "hundred",
+    "hunt", "hurdle", "husband", "hut", "hymn", "iceberg", "icicle", "icon",
+    "idea", "idle", "igloo", "iguana", "image", "imagine", "impact", "impulse",
+    "inch", "include", "index", "indigo", "infant", "inform", "ink", "inkjet",
+    "inkwell", "inlet", "input", "insect", "inside", "insight", "instant", "intact",
+    "invent", "iris", "iron", "island", "item", "itself", "ivory", "ivy",
+    "jackal", "jacket", "jackpot", "jade", "jaguar", "jam", "jar", "jasmine",
+    "javelin", "jazz", "jeans", "jelly", "jester", "jetty", "jewel", "jigsaw",
+    "jitter", "job", "jockey", "jog", "join", "joke", "jolly", "journal",
+    "journey", "joy", "jubilee", "judge", "juggle", "juice", "jukebox", "jumbo",
+    "jump", "junction", "jungle", "junior", "jury", "justice", "kale", "kangaroo",
+    "kayak", "keep", "kennel", "kernel", "ketchup", "kettle", "key", "keystone",
+    "kick", "kid", "kidney", "kilowatt", "kind", "kindle", "king", "kingdom",
+    "kiosk", "kitchen", "kite", "kitten", "kiwi", "knack", "knee", "knife",
+    "knight", "knit", "knob", "knot", "knuckle", "koala", "label", "lace",
+    "ladder", "lady", "ladybug", "lagoon", "lake", "lamp", "land", "lane",
+    "lantern", "laptop", "large", "lasagna", "laser", "latch", "lattice", "laugh",
+    "launch", "laundry", "lava", "lawn", "lawyer", "layer", "leader", "leaf",
+    "lean", "leapfrog", "learn", "leather", "ledge", "legal", "legend", "leisure",
+    "lemming", "lemon", "lemonade", "lens", "leopard", "lesson", "letter", "level",
+    "lever", "liberty", "library", "lid", "lifeline", "light", "lilac", "lily",
+    "limber", "lime", "limerick", "limit", "linen", "lion", "liquid", "listen",
+    "lizard", "llama", "load", "lobby", "lobster", "local", "lock", "locket",
+    "locust", "lodge", "lofty", "logic", "lollipop", "lookout", "lottery", "lotus",
+    "loud", "lounge", "love", "loyal", "lucid", "lucky", "lullaby", "lumber",
+    "lunar", "lunch", "luster", "lyric", "macaw", "machine", "magenta", "magic",
+    "magnet", "magpie", "maid", "mail", "major", "mallard", "mammal", "manager",
+    "manatee", "mandolin", "mango", "mansion", "maple", "marble", "march", "marina",
+    "marker", "market", "marshal", "mascot", "mask", "mason", "match", "meadow",
+    "measure", "medal", "medium", "mellow", "melon", "memo", "mental", "mentor",
+    "menu", "meringue", "merit", "mermaid", "mesa", "message", "metal", "meteor",
+    "method", "midday", "middle", "migrate", "mild", "mile", "milk", "mill",
+    "million", "mimic", "mind", "minnow", "mint", "minute", "miracle", "mirror",
+    "mission", "mist", "mitten", "mixer", "mixture", "model", "modem", "modern",
+    "modest", "mohair", "moment", "monarch", "monkey", "month", "moon", "moose",
+    "morning", "mortar", "mosaic", "mosquito", "moss", "motel", "moth", "motor",
+    "mound", "mount", "mouse", "mouth", "movie", "mudslide", "muffin", "muffler",
+    "mule", "mural", "muse", "museum", "music", "mustang", "mustard", "mystic",
+    "myth", "nail", "name", "napkin", "narrow", "narwhal", "nation", "native",
+    "natural", "nature", "navy", "near", "neat", "nebula", "nectar", "needle",
+    "neon", "nephew", "nerve", "nest", "net", "neutral", "never", "next",
+    "nibble", "nickel", "night", "nimble", "ninja", "noble", "noise", "nomad",
+    "noodle", "normal", "north", "nose", "notable", "notch", "note", "nothing",
+    "nougat", "novel", "nucleus", "nugget", "number", "nurse", "nutmeg", "nutshell",
+    "nylon", "oak", "oasis", "oath", "oatmeal", "oats", "obey", "object",
+    "oblong", "observe", "obtain", "ocean", "octagon", "octave", "octopus", "odor",
+    "odyssey", "offer", "office", "olive", "olympic", "omega", "omelet", "onion",
+    "onward", "opal", "open", "opera", "optic", "option", "oracle", "orange",
+    "orbit", "orbiter", "orchard", "orchid", "order", "organ", "origin", "ostrich",
+    "otter", "ounce", "outdoor", "outfit", "outline", "outlook", "outpost", "oval",
+    "oven", "overt", "owl", "owner", "oxygen", "oyster", "pacific", "package",
+    "paddle", "paddock", "padlock", "page", "pageant", "paint", "pajamas", "palace",
+    "palette", "palm", "pancake", "panda", "panel", "panic", "panther", "pants",
+    "papaya", "paper", "parade", "paragon", "parakeet", "parcel", "park", "parlor",
+    "parrot", "parsley", "partner", "party", "passage", "pasta", "pastry", "patch",
+    "path", "patient", "patio", "patrol", "pattern", "pause", "payment", "peach",
+    "peacock", "peak", "peanut", "pear", "peasant", "pebble", "pedal", "pedestal",
+    "pelican", "pencil", "pendant", "penguin", "penny", "pepper", "percent", "perfect",
+    "perfume", "period", "permit", "person", "pewter", "phoenix", "photo", "physics",
+    "piano", "pickle", "picnic", "piece", "pier", "pigeon", "pilgrim", "pillow",
+    "pilot", "pine", "pink", "pinnacle", "pinwheel", "pioneer", "pipe", "pirate",
+    "pitch", "pixel", "pizza", "place", "plain", "planet", "plant", "planter",
+    "plaster", "plate", "plaza", "plenty", "plum", "plumber", "plush", "plywood",
+    "pocket", "podium", "poem", "poet", "point", "polar", "polish", "pond",
+    "pony", "popcorn", "poppy", "popular", "porch", "portal", "portion", "postcard",
+    "poster", "potato", "pottery", "pouch", "poultry", "powder", "power", "prairie",
+    "precise", "premium", "present", "press", "pretzel", "price", "primary", "prince",
+    "printer", "prism", "private", "prize", "problem", "produce", "profit", "program",
+    "promise", "proof", "prosper", "protect", "proud", "provide", "prune", "public",
+    "pudding", "pulse", "puma", "pump", "pumpkin", "punch", "pupil", "puppy",
+    "purple", "pursuit", "puzzle", "pyramid", "quail", "quaint", "quake", "quarter",
+    "quartz", "quasar", "queen", "quench", "quest", "quibble", "quick", "quiet",
+    "quilt", "quiver", "quorum", "quota", "quote", "rabbit", "raccoon", "radar",
+    "radiant", "radio", "radish", "raft", "ragtime", "railway", "rain", "rainbow",
+    "raindrop", "raisin", "rally", "ramp", "rampart", "ranch", "range", "rapid",
+    "rapport", "ratio", "rattle", "raven", "razor", "reader", "ready", "real",
+    "reason", "recess", "recipe", "recital", "record", "redwood", "reef", "reform",
+    "region", "regular", "relax", "relay", "relic", "remedy", "remote", "render",
+    "rental", "repair", "reply", "reptile", "request", "rescue", "reserve", "resort",
+    "retina", "reunion", "revenue", "reward", "rhino", "rhubarb", "rhyme", "ribbon",
+    "rice", "ridge", "ring", "ringlet", "ripen", "ripple", "ritual", "river",
+    "rivet", "road", "roadway", "robin", "robot", "robust", "rock", "rocket",
+    "rodeo", "roof", "rooftop", "room", "root", "rope", "rose", "rosebud",
+    "rosemary", "roster", "rotate", "rotor", "round", "route", "rowboat", "royal",
+    "rubber", "ruby", "rug", "ruler", "rumble", "rumor", "runner", "runway",
+    "rural", "rust", "saddle", "safari", "saffron", "saga", "sage", "sail",
+    "sailboat", "salad", "salmon", "salon", "salsa", "salt", "sample", "sand",
+    "sandal", "sandbox", "sapling", "sardine", "satchel", "satin", "sauce", "saucer",
+    "sauna", "savanna", "scale", "scallop", "scarf", "scene", "scenic", "scholar",
+    "school", "science", "scoop", "scooter", "scout", "scratch", "screen", "script",
+    "scroll", "sculpt", "seagull", "seahorse", "seal", "season", "seat", "seaweed",
+    "second", "secret", "seed", "segment", "select", "senior", "sense", "sensor",
+    "sequel", "serene", "serpent", "serve", "session", "settle", "shade", "shadow",
+    "shake", "shampoo", "shark", "sheepdog", "shell", "shelter", "shield", "shimmer",
+    "shine", "ship", "shipyard", "shirt", "shoe", "shore", "shovel", "shrimp",
+    "shrub", "shuttle", "sidewalk", "siesta", "signal", "silence", "silk", "silver",
+    "simple", "sincere", "siren", "sister", "sketch", "skill", "skillet", "skirt",
+    "sky", "skylark", "slate", "sled", "sleep", "slender", "slice", "slipper",
+    "slope", "smile", "smoke", "smooth", "snack", "snail", "snake", "sneeze",
+    "snorkel", "snow", "snowball", "soap", "soccer", "society", "socket", "soda",
+    "sofa", "solar", "solid", "sonic", "soprano", "sorbet", "soup", "south",
+    "space", "spark", "sparrow", "speaker", "sphere", "spice", "spider", "spinach",
+    "spirit", "splash", "sponge", "spoon", "sport", "sporty", "spray", "spring",
+    "sprocket", "sprout", "spruce", "square", "squash", "squid", "stable", "stadium",
+    "stage", "stairs", "stamp", "star", "stardust", "station", "statue", "steam",
+    "steel", "stellar", "stem", "step", "stereo", "sterling", "stick", "stone",
+    "stool", "storm", "story", "stove", "straw", "stream", "street", "stripe",
+    "studio", "sturdy", "style", "subtle", "subway", "success", "sugar", "suggest",
+    "suit", "summer", "summit", "sun", "sunrise", "sunset", "super", "support",
+    "surf", "surface", "surplus", "survey", "swamp", "swan", "sweater", "sweet",
+    "swift", "swimmer", "swing", "switch", "symbol", "sympathy", "syrup", "system",
+    "table", "tablet", "tackle", "taco", "tadpole", "tail", "tailor", "talent",
+    "tandem", "tangent", "tango", "tank", "tape", "target", "task", "tavern",
+    "taxi", "tea", "teacher", "team", "teapot", "teardrop", "temple", "tempo",
+    "tenant", "tennis", "tent", "term", "terrace", "test", "texture", "thaw",
+    "theme", "thermos", "thimble", "thistle", "thread", "thrifty", "thriller", "thumb",
+    "thunder", "ticket", "tide", "tiger", "timber", "time", "timely", "tiny",
+    "title", "toast", "toboggan", "today", "toddler", "token", "tomato", "tone",
+    "tonic", "tool", "topaz", "topic", "torch", "tornado", "total", "totem",
+    "toucan", "tower", "town", "toy", "track", "tractor", "trade", "traffic",
+    "trail", "train", "trapeze", "travel", "tray", "treat", "tree", "treetop",
+    "trend", "trial", "triangle", "tribe", "trick", "tricycle", "trident", "trinket",
+    "trophy", "trouble", "trowel", "truck", "trumpet", "trunk", "trust", "truth",
+    "tugboat", "tulip", "tumbler", "tuna", "tundra", "tunnel", "turbine", "turkey",
+    "turnip", "turtle", "tutor", "tuxedo", "twelve", "twig", "twilight", "twin",
+    "typhoon", "umbrella", "uncle", "unicorn", "uniform", "union", "unique", "unit",
+    "unlock", "unpack", "upbeat", "update", "uphill", "upper", "upright", "uptown",
+    "urban", "usage", "useful", "utensil", "utmost", "vacant", "vacuum", "vagabond",
+    "valley", "value", "valve", "vanilla", "vantage", "vapor", "variety", "various",
+    "vault", "vector", "velvet", "vendor", "venue", "veranda", "verb", "verse",
+    "version", "vertex", "vessel", "vest", "veteran", "vibrant", "victory", "video",
+    "view", "viking", "village", "vine", "vinegar", "vintage", "violet", "violin",
+    "virtue", "visa", "visible", "vision", "visit", "visor", "vital", "vitamin",
+    "vivid", "vocal", "voice", "volcano", "voltage", "volume", "voter", "voyage",
+    "wafer", "waffle", "wagon", "waist", "walkway", "wallet", "walnut", "walrus",
+    "wander", "warden", "warm", "warrior", "wash", "washer", "wasp", "watch",
+    "water", "waterbed", "wave", "wax", "wealth", "weasel", "weather", "weave",
+    "webcam", "wedge", "weekday", "welcome", "western", "wetland", "whale", "wheat",
+    "wheel", "whisk", "whisper", "whistle", "wicket", "widget", "width", "wildcat",
+    "wildlife", "willow", "wind", "window", "wing", "wingspan", "winter", "wire",
+    "wireless", "wisdom", "wish", "without", "witty", "wizard", "wolf", "wombat",
+    "wonder", "wood", "wool", "word", "work", "workshop", "world", "worm",
+    "wrangler", "wrap", "wreath", "wrist", "writer", "yacht", "yak", "yard",
+    "yarn", "year", "yeast", "yellow", "yodel", "yodeler", "yoga", "yogurt",
+    "yonder", "young", "youth", "zealous", "zebra", "zeppelin", "zero", "zest",
+    "zigzag", "zinc", "zinnia", "zipper", "zodiac", "zone", "zoom", "zucchini"
+};
+
+/* Most common passwords of leaked lists, most common first. Used by
+ * the strength audit, a match costs about log2 of its rank guesses.
+ */
+const char *const common_passwords[COMMON_PASSWORDS_SIZE] =
+{
+    "123456", "password", "12345678", "qwerty", "123456789", "12345", "1234",
+    "111111", "1234567", "dragon", "123123", "baseball", "abc123", "football",
+    "monkey", "letmein", "696969", "shadow", "master", "666666", "qwertyuiop",
+    "123321", "mustang", "1234567890", "michael", "654321", "superman",
+    "1qaz2wsx", "7777777", "121212", "000000", "qazwsx", "123qwe", "killer",
+    "trustno1", "jordan", "jennifer", "zxcvbnm", "asdfgh", "hunter", "buster",
+    "soccer", "harley", "batman", "andrew", "tigger", "sunshine", "iloveyou",
+    "2000", "charlie", "robert", "thomas", "hockey", "ranger", "daniel",
+    "starwars", "klaster", "112233", "george", "computer", "michelle",
+    "jessica", "pepper", "1111", "zxcvbn", "555555", "11111111", "131313",
+    "freedom", "777777", "pass", "maggie", "159753", "aaaaaa", "ginger",
+    "princess", "joshua", "cheese", "amanda", "summer", "love", "ashley",
+    "6969", "nicole", "chelsea", "biteme", "matthew", "access", "yankees",
+    "987654321", "dallas", "austin", "thunder", "taylor", "matrix", "william",
+    "corvette", "hello", "martin", "heather", "secret", "merlin", "diamond",
+    "1234qwer", "gfhjkm", "hammer", "silver", "222222", "88888888", "anthony",
+    "justin", "test", "bailey", "q1w2e3r4t5", "patrick", "internet",
+    "scooter", "orange", "11111", "golfer", "cookie", "richard", "samantha",
+    "bigdog", "guitar", "jackson", "whatever", "mickey", "chicken", "sparky",
+    "snoopy", "maverick", "phoenix", "camaro", "peanut", "morgan", "welcome",
+    "falcon", "cowboy", "ferrari", "samsung", "andrea", "smokey", "steelers",
+    "joseph", "mercedes", "dakota", "arsenal", "eagles", "melissa", "boomer",
+    "booboo", "spider", "nascar", "monster", "tigers", "yellow", "xxxxxx",
+    "123123123", "gateway", "marina", "diablo", "bulldog", "qwer1234",
+    "compaq", "purple", "banana", "junior", "hannah", "123654", "porsche",
+    "lakers", "iceman", "money", "cowboys", "987654", "london", "tennis",
+    "999999", "ncc1701", "coffee", "scooby", "0000", "miller", "boston",
+    "q1w2e3r4", "brandon", "yamaha", "chester", "mother", "forever", "johnny",
+    "edward", "333333", "oliver", "redsox", "player", "nikita", "knight",
+    "fender", "barney", "midnight", "please", "brandy", "chicago", "badboy",
+    "slayer", "rangers", "charles", "angel", "flower", "bigdaddy", "rabbit",
+    "wizard", "jasper", "enter", "rachel", "chris", "steven", "winner",
+    "adidas", "victoria", "natasha", "1q2w3e4r", "jasmine", "winter",
+    "prince", "marine", "ghbdtn", "fishing", "cocacola", "casper", "james",
+    "232323", "raiders", "888888", "marlboro", "gandalf", "asdfasdf",
+    "crystal", "87654321", "12344321", "golden", "8675309", "hunter2",
+    "welcome1", "password1", "password123", "admin", "admin123", "root",
+    "toor", "changeme", "letmein1", "qwerty123", "abc12345", "iloveyou1",
+    "princess1", "monkey1", "dragon1", "sunshine1", "football1", "baseball1",
+    "superman1", "passw0rd", "p@ssw0rd", "qwe123", "zaq12wsx", "1q2w3e",
+    "123abc", "a123456", "123456a", "qwertyui", "asdfghjkl", "zxcvbnm1",
+    "aa123456", "default", "guest", "login", "master1", "secret1", "test123",
+    "user", "pa55word"
+};
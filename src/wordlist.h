@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+ */
+
+#ifndef __WORDLIST_H
+#define __WORDLIST_H
+
+#define WORDLIST_SIZE 2048
+#define COMMON_PASSWORDS_SIZE 284
+
+extern const char *const wordlist[WORDLIST_SIZE];
+extern const char *const common_passwords[COMMON_PASSWORDS_SIZE];
+
+#endif
@@ -13,14 +13,67 @@
 #include "utils.h"
 #include "pwd-gen.h"
 #include "crypto.h"
+#include "render.h"
+#include "qr.h"
+#include "batch.h"
+#include "shell.h"
+#include "audit.h"
+#include "lock.h"
+#include "securemem.h"
 
 static int show_password = 0;
 static int force = 0;
 static int auto_encrypt = 0;
 static int show_as_qrcode = 0;
+static int ignore_case = 0;
+static int output_format = OUTPUT_HUMAN;
+static const char *qr_format = "svg";
+static const char *qr_ecc = "medium";
+static const char *qr_fields = "title,user,url,password,notes";
+static long count = 1;
+static const char *separator = "-";
+static int capitalize = 0;
+static int add_digit = 0;
+static int similar = 0;
+static int min_score = 3;
+static const char *field = "password";
 
 static double v = 1.7;
 
+/* Codes for the options that don't have a short option */
+enum
+{
+    OPT_PICK = 256,
+    OPT_QUERY,
+    OPT_OUTPUT,
+    OPT_EXPORT_QR,
+    OPT_QR_FORMAT,
+    OPT_QR_ECC,
+    OPT_QR_FIELDS,
+    OPT_BATCH,
+    OPT_SHELL,
+    OPT_COUNT,
+    OPT_GEN_PASSPHRASE,
+    OPT_SEPARATOR,
+    OPT_AUDIT_BREACHED,
+    OPT_BUILD_BLOOM,
+    OPT_AUDIT_REUSE,
+    OPT_AUDIT_STRENGTH,
+    OPT_MIN_SCORE,
+    OPT_HISTORY,
+    OPT_GET,
+    OPT_FIELD,
+    OPT_PROFILE,
+    OPT_PROFILES,
+    OPT_BACKUP,
+    OPT_RESTORE,
+    OPT_ONLY,
+    OPT_SNAPSHOT,
+    OPT_RESTORE_SNAPSHOT,
+    OPT_AT,
+    OPT_SYNC
+};
+
 static void version()
 {
     printf("Ylva version %.1f\n", v);
@@ -43,16 +96,46 @@ OPTIONS\n\
     -r --remove              <id>     Remove entry pointed by id\n\
     -p --show-db-path                 Show current database path\n\
     -u --use-db              <path>   Switch using another database\n\
+       --profile             <name>   Use the active database of profile name\n\
+       --profiles                     List profiles with an active database\n\
+       --backup              <file>   Write encrypted backup of the database\n\
+       --restore             <file>   Restore entries from a backup\n\
+       --only                <query>  Restore only entries matching query\n\
+       --snapshot            <dir>    Write changes since the last snapshot to dir\n\
+       --restore-snapshot    <dir>    Restore the database from snapshots in dir\n\
+       --at                  <time>   Restore the snapshot taken at or before time\n\
+       --sync                <path>   Merge with another encrypted database\n\
     -f --find                <search> Search entries\n\
     -F --regex               <search> Search entries with regular expressions\n\
+       --query               <query>  Search entries with a query, for example\n\
+                                      \"title:git* user:ops modified:>2024-01-01\"\n\
     -e --edit                <id>     Edit entry pointed by id\n\
     -l --list-entry          <id>     List entry pointed by id\n\
+       --history             <id>     Show earlier values of entry\n\
+       --get                 <name>   Print one field of the entry with exact\n\
+                                      title or url name, for scripts\n\
+       --field               <field>  Field --get prints: password, user, url,\n\
+                                      notes or title, default password\n\
     -t --show-latest         [count]  Show latest entries, count is optional\n\
     -A --list-all                     List all entries\n\
     -h --help                         Show short help and exit. This page\n\
     -g --gen-password        <length> Generate password\n\
+       --gen-passphrase      <words>  Generate passphrase of random words\n\
     -q --quick               <search> This is the same as running\n\
                                       --show-passwords -f\n\
+       --pick                         Pick an entry interactively\n\
+       --export-qr           <dir>    Write QR codes of all entries, or the\n\
+                             [query]  ones matching the query, to files\n\
+       --batch               <file>   Run add, edit, remove, get and find\n\
+                                      commands from file, - reads stdin\n\
+       --shell               [path]   Unlock the database once and run\n\
+                                      commands interactively\n\
+       --audit-breached      <file>   Find passwords that are in a sorted\n\
+                                      file of SHA1 hashes of breached ones\n\
+       --build-bloom         <file>   Write bloom filter of the hash file to\n\
+                                      speed up --audit-breached\n\
+       --audit-reuse                  Find passwords used by many entries\n\
+       --audit-strength               Find weak passwords\n\
 \n\
     -v --version                      Show version number of program\n\
 \n\
@@ -61,8 +144,27 @@ FLAGS\n\
     --auto-encrypt                    Automatically encrypt after exit\n\
     --show-passwords                  Show passwords in listings\n\
     --show-qrcode                     Show data as QR code in --list-entry\n\
+    --show-qrcode-classic             Same as --show-qrcode, but draw each\n\
+                                      module row on its own line\n\
+    --ignore-case                     Ignore case and accents in --regex\n\
     --force                           Ignore everything and force operation\n\
                                       --force only works with --init option\n\
+    --output                 <format> Output format of listings and searches:\n\
+                                      human (default), jsonl, tsv or nul\n\
+    --qr-format              <format> File format of --export-qr, svg or png\n\
+    --qr-ecc                 <level>  Error correction of --export-qr: low,\n\
+                                      medium (default), quartile or high\n\
+    --qr-fields              <fields> Comma separated fields to encode, default\n\
+                                      is title,user,url,password,notes\n\
+    --count                  <n>      Number of passwords --gen-password\n\
+                                      or --gen-passphrase generates, default\n\
+                                      is 1\n\
+    --separator              <sep>    Separator of passphrase words, default -\n\
+    --capitalize                      Capitalize passphrase words\n\
+    --digit                           Add a digit to passphrases\n\
+    --similar                         Group similar passwords in --audit-reuse\n\
+    --min-score              <score>  Passwords scoring below this are weak in\n\
+                                      --audit-strength, 1 to 5, default 3\n\
 \n\
 For more information and examples see man ylva(1).\n\
 \n\
@@ -75,6 +177,20 @@ AUTHORS\n\
 int main(int argc, char *argv[])
 {
     int c;
+    bool failed = false;
+    bool encrypt_at_exit = false;
+    bool gen_passwords = false;
+    int password_length = 0;
+    int passphrase_words = 0;
+    bool reuse_audit = false;
+    bool strength_audit = false;
+    const char *get_name = NULL;
+    const char *restore_path = NULL;
+    const char *restore_query = NULL;
+    const char *snapshot_dir = NULL;
+    const char *snapshot_at = NULL;
+    const char *export_dir = NULL;
+    const char *export_query = NULL;
 
     if(argc == 1)
     {
@@ -82,7 +198,17 @@ int main(int argc, char *argv[])
         return 0;
     }
 
-    while(true)
+    /* Options of one invocation are one unit of work. Their changes are
+     * committed together at exit and with --auto-encrypt the database
+     * is encrypted only once, after everything else is done.
+     */
+    db_unit_begin();
+
+    /* --profile overrides this */
+    if(getenv("YLVA_PROFILE") && !use_profile(getenv("YLVA_PROFILE")))
+        return 1;
+
+    while(!failed)
     {
         static struct option long_options[] =
         {
@@ -104,10 +230,44 @@ int main(int argc, char *argv[])
             {"show-db-path",          no_argument,       0,             'p'},
             {"show-latest",           no_argument,       0,             't'},
             {"quick",                 required_argument, 0,             'q'},
+            {"pick",                  no_argument,       0,             OPT_PICK},
+            {"query",                 required_argument, 0,             OPT_QUERY},
+            {"output",                required_argument, 0,             OPT_OUTPUT},
+            {"export-qr",             required_argument, 0,             OPT_EXPORT_QR},
+            {"qr-format",             required_argument, 0,             OPT_QR_FORMAT},
+            {"qr-ecc",                required_argument, 0,             OPT_QR_ECC},
+            {"qr-fields",             required_argument, 0,             OPT_QR_FIELDS},
+            {"batch",                 required_argument, 0,             OPT_BATCH},
+            {"shell",                 no_argument,       0,             OPT_SHELL},
+            {"count",                 required_argument, 0,             OPT_COUNT},
+            {"gen-passphrase",        required_argument, 0,             OPT_GEN_PASSPHRASE},
+            {"separator",             required_argument, 0,             OPT_SEPARATOR},
+            {"audit-breached",        required_argument, 0,             OPT_AUDIT_BREACHED},
+            {"build-bloom",           required_argument, 0,             OPT_BUILD_BLOOM},
+            {"audit-reuse",           no_argument,       0,             OPT_AUDIT_REUSE},
+            {"audit-strength",        no_argument,       0,             OPT_AUDIT_STRENGTH},
+            {"min-score",             required_argument, 0,             OPT_MIN_SCORE},
+            {"history",               required_argument, 0,             OPT_HISTORY},
+            {"get",                   required_argument, 0,             OPT_GET},
+            {"field",                 required_argument, 0,             OPT_FIELD},
+            {"profile",               required_argument, 0,             OPT_PROFILE},
+            {"profiles",              no_argument,       0,             OPT_PROFILES},
+            {"backup",                required_argument, 0,             OPT_BACKUP},
+            {"restore",               required_argument, 0,             OPT_RESTORE},
+            {"only",                  required_argument, 0,             OPT_ONLY},
+            {"snapshot",              required_argument, 0,             OPT_SNAPSHOT},
+            {"restore-snapshot",      required_argument, 0,             OPT_RESTORE_SNAPSHOT},
+            {"at",                    required_argument, 0,             OPT_AT},
+            {"sync",                  required_argument, 0,             OPT_SYNC},
             {"auto-encrypt",          no_argument,       &auto_encrypt,  1 },
             {"show-passwords",        no_argument,       &show_password, 1 },
-            {"show-qrcode",           no_argument,       &show_as_qrcode,   1 },
+            {"show-qrcode",           no_argument,       &show_as_qrcode, QR_STYLE_HALF_BLOCK },
+            {"show-qrcode-classic",   no_argument,       &show_as_qrcode, QR_STYLE_CLASSIC },
+            {"ignore-case",           no_argument,       &ignore_case,   1 },
             {"force",                 no_argument,       &force,         1 },
+            {"capitalize",            no_argument,       &capitalize,    1 },
+            {"digit",                 no_argument,       &add_digit,     1 },
+            {"similar",               no_argument,       &similar,       1 },
             {0, 0, 0, 0}
         };
 
@@ -125,47 +285,94 @@ int main(int argc, char *argv[])
             /* Handle flags here automatically */
             break;
         case 'i':
-            init_database(optarg, force, auto_encrypt);
+            failed = !db_unit_end(true);
+            init_database(optarg, force);
+            encrypt_at_exit = true;
             break;
         case 'E': //encrypt
+            failed = !db_unit_end(true);
             encrypt_database();
+            encrypt_at_exit = false;
             break;
         case 'D': //decrypt
+            failed = !db_unit_end(true);
             decrypt_database(optarg);
             break;
         case 'u':
+            failed = !db_unit_end(true);
             set_use_db(optarg);
+            break;
+        case OPT_PROFILE:
+            failed = !db_unit_end(true) || !use_profile(optarg);
+            break;
+        case OPT_PROFILES:
+            list_profiles();
+            break;
+        case OPT_BACKUP:
+            failed = !backup_database(optarg);
+            encrypt_at_exit = true;
+            break;
+        case OPT_RESTORE:
+            /* Run after all options, so --only can come after it */
+            restore_path = optarg;
+            encrypt_at_exit = true;
+            break;
+        case OPT_ONLY:
+            restore_query = optarg;
+            break;
+        case OPT_SNAPSHOT:
+            failed = !db_unit_write() || !snapshot_database(optarg);
+            encrypt_at_exit = true;
+            break;
+        case OPT_RESTORE_SNAPSHOT:
+            /* Run after all options, so --at can come after it */
+            snapshot_dir = optarg;
+            encrypt_at_exit = true;
+            break;
+        case OPT_AT:
+            snapshot_at = optarg;
+            break;
+        case OPT_SYNC:
+            failed = !db_unit_write() || !sync_database(optarg);
+            encrypt_at_exit = true;
+            break;
         case 'a':
-            add_new_entry(auto_encrypt);
+            failed = !db_unit_write() || !add_new_entry();
+            encrypt_at_exit = true;
             break;
         case 'c':
-            copy_entry(atoi(optarg));
+            failed = !db_unit_write() || !copy_entry(atoi(optarg));
+            encrypt_at_exit = true;
             break;
         case 'r':
-            remove_entry(atoi(optarg), auto_encrypt);
+            failed = !db_unit_write() || !remove_entry(atoi(optarg));
+            encrypt_at_exit = true;
             break;
         case 'f':
-            find(optarg, show_password, auto_encrypt);
+            find(optarg, show_password, output_format);
+            encrypt_at_exit = true;
             break;
         case 'F':
-            find_regex(optarg, show_password);
+            find_regex(optarg, show_password, ignore_case, output_format);
+            encrypt_at_exit = true;
             break;
         case 'e':
-            edit_entry(atoi(optarg), auto_encrypt);
+            failed = !db_unit_write() || !edit_entry(atoi(optarg));
+            encrypt_at_exit = true;
             break;
         case 'A':
-            list_all(show_password, auto_encrypt, -1);
+            list_all(show_password, -1, output_format);
+            encrypt_at_exit = true;
             break;
         case 'l':
-            list_by_id(atoi(optarg), show_password, auto_encrypt, show_as_qrcode);
+            list_by_id(atoi(optarg), show_password, show_as_qrcode, output_format);
+            encrypt_at_exit = true;
             break;
         case 'g':
-        {
-            char *pass = generate_password(atoi(optarg));
-            if(pass != NULL)
-                free(pass);
+            /* Generated after all options, so --count can come after -g */
+            password_length = atoi(optarg);
+            gen_passwords = true;
             break;
-        }
         case 'h':
             usage();
             break;
@@ -181,17 +388,182 @@ int main(int argc, char *argv[])
             if(argv[optind]) {
                 count = atoi(argv[optind]);
             }
-            show_latest_entries(show_password, auto_encrypt, count);
+            show_latest_entries(show_password, count, output_format);
+            encrypt_at_exit = true;
             break;
         }
         case 'q':
             show_password = 1;
-            find(optarg, show_password, auto_encrypt);
+            find(optarg, show_password, output_format);
+            encrypt_at_exit = true;
+            break;
+        case OPT_QUERY:
+            find_query(optarg, show_password, output_format);
+            encrypt_at_exit = true;
+            break;
+        case OPT_OUTPUT:
+            output_format = render_parse_format(optarg);
+
+            if(output_format == -1)
+            {
+                fprintf(stderr, "Unknown output format %s.\n", optarg);
+                failed = true;
+            }
+            break;
+        case OPT_EXPORT_QR:
+            /* Run after the loop, so --qr-* given after it are honoured */
+            export_dir = optarg;
+            if(argv[optind] && argv[optind][0] != '-') {
+                export_query = argv[optind];
+            }
+            encrypt_at_exit = true;
+            break;
+        case OPT_QR_FORMAT:
+            qr_format = optarg;
+            break;
+        case OPT_QR_ECC:
+            qr_ecc = optarg;
+            break;
+        case OPT_QR_FIELDS:
+            qr_fields = optarg;
+            break;
+        case OPT_BATCH:
+            failed = !db_unit_write() || !run_batch(optarg, show_password, output_format);
+            encrypt_at_exit = true;
+            break;
+        case OPT_GEN_PASSPHRASE:
+            passphrase_words = atoi(optarg);
+
+            if(passphrase_words < 1 || passphrase_words > PASSPHRASE_MAX_WORDS)
+            {
+                fprintf(stderr, "Number of words must be 1 to %d.\n",
+                        PASSPHRASE_MAX_WORDS);
+                failed = true;
+            }
+            break;
+        case OPT_AUDIT_BREACHED:
+            failed = !audit_breached(optarg);
+            encrypt_at_exit = true;
+            break;
+        case OPT_BUILD_BLOOM:
+            failed = !build_bloom(optarg);
+            break;
+        case OPT_AUDIT_REUSE:
+            /* Run after all options, so --similar can come after it */
+            reuse_audit = true;
+            encrypt_at_exit = true;
+            break;
+        case OPT_HISTORY:
+            show_history(atoi(optarg), show_password, output_format);
+            encrypt_at_exit = true;
+            break;
+        case OPT_GET:
+            /* Run after all options, so --field can come after it */
+            get_name = optarg;
+            encrypt_at_exit = true;
+            break;
+        case OPT_FIELD:
+            field = optarg;
+            break;
+        case OPT_AUDIT_STRENGTH:
+            /* Run after all options, so --min-score can come after it */
+            strength_audit = true;
+            encrypt_at_exit = true;
+            break;
+        case OPT_MIN_SCORE:
+            min_score = atoi(optarg);
+
+            if(min_score < 1 || min_score > 5)
+            {
+                fprintf(stderr, "Minimum score must be 1 to 5.\n");
+                failed = true;
+            }
+            break;
+        case OPT_SEPARATOR:
+            separator = optarg;
+            break;
+        case OPT_COUNT:
+        {
+            char *end = NULL;
+            count = strtol(optarg, &end, 10);
+
+            if(*end != '\0' || end == optarg || count < 1)
+            {
+                fprintf(stderr, "Invalid count %s.\n", optarg);
+                failed = true;
+            }
+            break;
+        }
+        case OPT_SHELL:
+        {
+            const char *path = NULL;
+            if(argv[optind] && argv[optind][0] != '-') {
+                path = argv[optind];
+            }
+            failed = !db_unit_end(true) || !run_shell(path, show_password, output_format);
+            break;
+        }
+        case OPT_PICK:
+            pick_entry(show_password, show_as_qrcode);
+            encrypt_at_exit = true;
             break;
         case '?':
             usage();
             break;
         }
     }
-    return 0;
+
+    if(!failed && restore_path)
+        failed = !db_unit_write() || !restore_database(restore_path, restore_query);
+
+    if(!failed && snapshot_dir)
+        failed = !db_unit_write() || !restore_snapshot(snapshot_dir, snapshot_at);
+
+    if(!failed && export_dir)
+        failed = !export_qr(export_dir, export_query, qr_format, qr_ecc, qr_fields);
+
+    if(!failed && get_name)
+        failed = !get_field(get_name, field);
+
+    if(!failed && reuse_audit)
+        failed = !audit_reuse(similar == 1);
+
+    if(!failed && strength_audit)
+        failed = !audit_strength(min_score);
+
+    if(!db_unit_end(!failed))
+        failed = true;
+
+    if(!failed && gen_passwords)
+    {
+        if(password_length < 1)
+        {
+            fprintf(stderr, "Invalid password length.\n");
+            failed = true;
+        }
+        else if(!generate_passwords(password_length, count, stdout))
+        {
+            failed = true;
+        }
+    }
+
+    if(!failed && passphrase_words > 0)
+    {
+        Passphrase_t options = { passphrase_words, separator, capitalize, add_digit };
+
+        failed = !generate_passphrases(&options, count, stdout);
+    }
+
+    if(auto_encrypt == 1 && encrypt_at_exit && has_active_database())
+    {
+        fprintf(stdout, "Auto encrypt enabled, type password to encrypt.\n");
+
+        if(!encrypt_database())
+            failed = true;
+    }
+
+    lock_report();
+    secure_report();
+
+    return failed ? 1 : 0;
 }
@@ -0,0 +1,95 @@
+#!/bin/sh
+#
+# Copyright (C) 2019-2021 Niko Rosvall <niko@byteptr.com>
+#
+# Runs command lines of Ylva against a throwaway vault and checks what
+# they leave behind. A temporary directory is used as HOME, so the
+# active database of the user is left alone.
+#
+# Environment:
+#   YLVA   ylva binary to test, default ../src/ylva
+
+set -e
+
+TESTS=$(cd "$(dirname "$0")" && pwd)
+YLVA=$(cd "$(dirname "${YLVA:-$TESTS/../src/ylva}")" && pwd)/$(basename "${YLVA:-ylva}")
+
+if [ ! -x "$YLVA" ]; then
+    echo "$YLVA not found, run make in src first." >&2
+    exit 1
+fi
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/ylva-tests.XXXXXX")
+trap 'rm -rf "$WORK"' EXIT INT TERM
+
+export HOME="$WORK"
+unset YLVA_PROFILE YLVA_DEFAULT_USERNAME YLVA_COLOR
+VAULT="$WORK/vault.db"
+FAILED=0
+
+fail() {
+    echo "FAIL: $1" >&2
+    FAILED=$((FAILED + 1))
+}
+
+# Starts every test from an empty active vault
+fresh() {
+    rm -f "$VAULT" "$VAULT-wal" "$VAULT-shm" "$WORK/.ylva.open_db"
+    "$YLVA" -i "$VAULT" >/dev/null
+}
+
+# Titles of all entries, one per line
+titles() {
+    "$YLVA" --output tsv -A | cut -f 2
+}
+
+# --batch after a read option runs in the same unit of work and its
+# changes must still be committed
+test_batch_after_read() {
+    fresh
+    printf 'add "title=first" "password=one"\n' | "$YLVA" --batch - >/dev/null
+    printf 'add "title=second" "password=two"\n' > "$WORK/batch"
+
+    "$YLVA" -A --batch "$WORK/batch" >/dev/null 2>&1 || fail "-A --batch exited with an error"
+
+    [ "$(titles | sort | tr '\n' ' ')" = "first second " ] ||
+        fail "-A --batch lost the batch"
+}
+
+# --get matches urls by site, whatever path the entry or the name has
+test_get_by_site() {
+    fresh
+    printf 'add "title=hub" "url=https://www.github.com/login" "password=one"\n' |
+        "$YLVA" --batch - >/dev/null
+
+    [ "$("$YLVA" --get github.com 2>/dev/null)" = "one" ] ||
+        fail "--get did not find the site of a url with a path"
+    [ "$("$YLVA" --get https://GitHub.com/other 2>/dev/null)" = "one" ] ||
+        fail "--get did not find the site of a name with a path"
+}
+
+# Dates of modified: stand for the whole day, month or year
+test_query_modified_period() {
+    fresh
+    printf 'add "title=today" "password=one"\n' | "$YLVA" --batch - >/dev/null
+    today=$(date +%Y-%m-%d)
+
+    for query in "modified:=$today" "modified:<=$today" "modified:$(date +%Y)"; do
+        [ "$("$YLVA" --output tsv --query "$query" | cut -f 2)" = "today" ] ||
+            fail "--query $query did not match an entry of today"
+    done
+
+    [ -z "$("$YLVA" --output tsv --query "modified:>$today")" ] ||
+        fail "--query modified:>$today matched an entry of today"
+}
+
+test_batch_after_read
+test_get_by_site
+test_query_modified_period
+
+if [ $FAILED -ne 0 ]; then
+    echo "$FAILED test(s) failed." >&2
+    exit 1
+fi
+
+echo "All tests passed."